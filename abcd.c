@@ -17,12 +17,11 @@
  * TODO:
  *
  * - Get large puzzles to have a lower fail ratio.
- *   I haven't currently been able to produce a valid 10x10n4 puzzle,
- *   and a 9x9n4 puzzle can take _tens of thousands_ of attempts.
+ *   A 9x9n4 puzzle almost never has a unique solution, so after a number
+ *   of attempts the generator gives away letters. Could a smarter grid
+ *   make these puzzles unique without them?
  *   + Force a 0 on a row/column for a letter, and a high number on
  *     a column/row?
- *   + Or maybe introduce immutable letters, after a certain amount
- *     of attempts...
  *
  * - Solver techniques for diagonal mode?
  */
@@ -34,9 +33,29 @@
 #include <math.h>
 
 #include "puzzles.h"
+#include "arena.h"
+#include "gentime.h"
+#ifdef DESCPOOL
+#include "descpool.h"
+#endif
+#ifdef DESC_CODEC
+#include "desccodec.h"
+#endif
 
 #ifdef STANDALONE_SOLVER
 bool solver_verbose = false;
+/* Set by --generate, so that the generator only keeps statistics */
+static bool gen_quiet = false;
+static long gen_attempts;
+#endif
+
+#ifdef STANDALONE_SOLVER
+/* Solver rounds in which each technique made progress, for --stream */
+enum { USE_SINGLES, USE_RUNS, USECOUNT };
+static long solver_uses[USECOUNT];
+#define SOLVER_USED(t) (solver_uses[t]++)
+#else
+#define SOLVER_USED(t) ((void)0)
 #endif
 
 enum {
@@ -58,6 +77,7 @@ struct game_state {
 	int w, h, n;
 	bool diag;
 	char *grid; /* size w*h */
+	bool *immutable; /* given letters, size w*h */
 	unsigned char *clues; /* remaining possibilities, size w*h*n */
 	int *numbers; /* size n*(w+h) */
 	bool completed, cheated;
@@ -287,6 +307,11 @@ static const char *validate_desc(const game_params *params, const char *desc)
 			/* Commas can be skipped over */
 			++p;
 		}
+		else if (i == l*n && isalpha((unsigned char) *p))
+		{
+			/* Given letters follow the number clues */
+			break;
+		}
 		else
 		{
 			return "Invalid character in description.";
@@ -298,6 +323,27 @@ static const char *validate_desc(const game_params *params, const char *desc)
 	else if (i > l*n)
 		return "Description contains too many clues.";
 	
+	if(*p)
+	{
+		/*
+		* Each uppercase letter is a given letter, and each lowercase
+		* letter is a run of empty squares.
+		*/
+		i = 0;
+		for(; *p; ++p)
+		{
+			if(*p >= 'a' && *p <= 'z')
+				i += *p - 'a' + 1;
+			else if(*p >= 'A' && *p < 'A' + n)
+				i++;
+			else
+				return "Invalid character in given letters.";
+		}
+		
+		if(i != w*h)
+			return "Given letters don't match the grid size.";
+	}
+	
 	return NULL;
 }
 
@@ -313,10 +359,12 @@ static game_state *blank_state(int w, int h, int n, bool diag)
 	ret->diag = diag;
 	
 	ret->grid = snewn(w * h, char);
+	ret->immutable = snewn(w * h, bool);
 	ret->clues = snewn(w * h * n, unsigned char);
 	ret->numbers = snewn(l * n, int);
 	
 	memset(ret->grid, EMPTY, w * h);
+	memset(ret->immutable, false, w * h * sizeof(bool));
 	memset(ret->clues, true, w*h*n);
 	memset(ret->numbers, 0, l*n * sizeof(int));
 	
@@ -360,7 +408,7 @@ static game_state *new_game(midend *me, const game_params *params, const char *d
 	int num;
 	int i = 0;
 	
-	while(*p)
+	while(*p && !isalpha((unsigned char) *p))
 	{
 		if(isdigit((unsigned char) *p))
 		{
@@ -376,6 +424,18 @@ static game_state *new_game(midend *me, const game_params *params, const char *d
 		else
 			++p;
 	}
+	
+	/* Given letters */
+	for(i = 0; *p; ++p)
+	{
+		if(*p >= 'a' && *p <= 'z')
+			i += *p - 'a' + 1;
+		else
+		{
+			state->grid[i] = *p - 'A';
+			state->immutable[i++] = true;
+		}
+	}
 
 	return state;
 }
@@ -392,6 +452,7 @@ static game_state *dup_game(const game_state *state)
 	game_state *ret = blank_state(w, h, n, diag);
 	
 	memcpy(ret->grid, state->grid, w * h);
+	memcpy(ret->immutable, state->immutable, w * h * sizeof(bool));
 	memcpy(ret->clues, state->clues, w * h * n);
 	memcpy(ret->numbers, state->numbers, l * n * sizeof(int));
 	
@@ -404,6 +465,7 @@ static game_state *dup_game(const game_state *state)
 static void free_game(game_state *state)
 {
 	sfree(state->grid);
+	sfree(state->immutable);
 	sfree(state->clues);
 	sfree(state->numbers);
 	
@@ -590,7 +652,8 @@ static void abcd_place_letter(game_state *state, int x, int y, char l, int *rema
 	}
 }
 
-static int abcd_solver_runs(game_state *state, int *remaining, int horizontal, char c)
+static int abcd_solver_runs(game_state *state, int *remaining, int horizontal, char c,
+				struct arena *arena)
 {
 	/*
 	* For each row and column, get the available runs of spaces where
@@ -618,13 +681,14 @@ static int abcd_solver_runs(game_state *state, int *remaining, int horizontal, c
 	int a,b,amx,bmx,i,point;
 	
 	int action = false;
+	struct arena_mark mark = arena_mark(arena);
 	int *rslen;
 	int *rspos;
 	
 	amx = (horizontal ? h : w);
 	bmx = (horizontal ? w : h);
-	rslen = snewn(bmx, int);
-	rspos = snewn(bmx, int);
+	rslen = arena_newn(arena, bmx, int);
+	rspos = arena_newn(arena, bmx, int);
 	
 	for (a = 0; a < amx; a++)
 	{
@@ -705,8 +769,7 @@ if(solver_verbose)
 		/* TODO techniques involving diagonal adjacency */
 	}
 	
-	sfree(rslen);
-	sfree(rspos);
+	arena_release(arena, mark);
 	
 	return action;
 }
@@ -830,9 +893,24 @@ static int abcd_validate_puzzle(game_state *state)
 	return 0;
 }
 
+static void abcd_place_givens(game_state *state, const game_state *puzzle)
+{
+	/* Place the given letters of a puzzle into a blank state for solving */
+	int w = state->w;
+	int h = state->h;
+	int x, y;
+	
+	for (y = 0; y < h; y++)
+		for (x = 0; x < w; x++)
+		{
+			if (puzzle->immutable[y*w+x])
+				abcd_place_letter(state, x, y, puzzle->grid[y*w+x], NULL);
+		}
+}
+
 #define MULTIPLE 126
 
-static int abcd_solve_game(int *numbers, game_state *state)
+static int abcd_solve_game(int *numbers, game_state *state, struct arena *arena)
 {
 	/*
 	* Changes the *state to contain the number clues from *numbers and the found
@@ -850,6 +928,7 @@ static int abcd_solve_game(int *numbers, game_state *state)
 	int x,y;
 	char c;
 	
+	struct arena_mark mark = arena_mark(arena);
 	int *remaining;
 	int busy = true;
 	int error = 0;
@@ -865,9 +944,22 @@ char *debug;
 	* Create an editable copy of the numbers, with the amount of
 	* remaining letters per row/column.
 	*/
-	remaining = snewn(l * n, int);	
+	remaining = arena_newn(arena, l * n, int);
 	memcpy(remaining, state->numbers, l*n * sizeof(int));
 	
+	/* Given letters which are already placed count towards the numbers */
+	for (y = 0; y < h; y++)
+		for (x = 0; x < w; x++)
+		{
+			c = state->grid[y*w+x];
+			if (c == EMPTY)
+				continue;
+			if (remaining[HOR_CLUE(y,c)] != NO_NUMBER)
+				remaining[HOR_CLUE(y,c)]--;
+			if (remaining[VER_CLUE(x,c)] != NO_NUMBER)
+				remaining[VER_CLUE(x,c)]--;
+		}
+	
 	/* Enter loop */
 	while(busy && error == 0)
 	{
@@ -949,7 +1041,10 @@ if(solver_verbose)
 		* reuse the easier techniques before continuing
 		*/
 		if(busy)
+		{
+			SOLVER_USED(USE_SINGLES);
 			continue;
+		}
 		
 		/*
 		* Try the runs techniques on all rows and columns for all letters
@@ -957,11 +1052,13 @@ if(solver_verbose)
 		for (c = 0; c < n; c++)
 		{
 			int action;
-			action = abcd_solver_runs(state, remaining, true, c);
+			action = abcd_solver_runs(state, remaining, true, c, arena);
 			busy = (action ? true : busy);
-			action = abcd_solver_runs(state, remaining, false, c);
+			action = abcd_solver_runs(state, remaining, false, c, arena);
 			busy = (action ? true : busy);
 		}
+		if(busy)
+			SOLVER_USED(USE_RUNS);
 		/* END CHECK */
 		
 	} /* while busy */
@@ -988,20 +1085,403 @@ if(solver_verbose)
 }
 #endif
 	
-	sfree(remaining);
+	arena_release(arena, mark);
 	return error;
 }
 
 #undef MULTIPLE
 
+/*
+ * Exact solution counting.
+ *
+ * The solver above gives up as soon as it runs out of deductions, so
+ * it can't tell a puzzle beyond its rules from one with several
+ * solutions. The counter below does a backtracking search, keeping one
+ * bitmask per letter for every row and column of squares where that
+ * letter is still possible. Placing a letter clears it from the
+ * neighbouring squares. A line whose number is reached loses the
+ * letter everywhere else. A line which can only just fit its number
+ * gets the squares which every maximal placement uses. The search
+ * branches on the square with the fewest remaining letters.
+ *
+ * The bitmasks limit this to grids of up to 32 squares wide and high.
+ * With many number clues missing the search can grow large, so it
+ * gives up after a fixed number of search states.
+ */
+#define COUNT_MAXSIZE 32
+#define COUNT_MAXNODES 1000
+#define COUNT_BIT(i) (1U << (i))
+
+struct abcd_count {
+	int w, h, n;
+	bool diag;
+	const int *numbers;
+	
+	/* Size of one search state, and one state per search depth */
+	int size;
+	unsigned int *stack;
+	
+	int limit, count, nodes;
+	const char *known;
+	char *other;
+	bool found;
+};
+
+/*
+ * A search state holds, for each letter, the possible and the placed
+ * squares in every row, followed by the same for every column.
+ */
+#define COUNT_ROWS(s,c) ((s) + (c)*h)
+#define COUNT_COLS(s,c) ((s) + n*h + (c)*w)
+#define COUNT_FROWS(s,c) ((s) + n*(h+w) + (c)*h)
+#define COUNT_FCOLS(s,c) ((s) + n*(h+w) + n*h + (c)*w)
+
+static int abcd_count_bits(unsigned int m)
+{
+	int ret = 0;
+	for (; m; m &= m-1)
+		ret++;
+	return ret;
+}
+
+/*
+ * Pick squares from the lowest (or highest) end of a line without
+ * letting them touch. This places the most letters that can fit, and
+ * any square picked from both ends is used by every such placement.
+ */
+static unsigned int abcd_count_pack(unsigned int m, int len, bool high)
+{
+	unsigned int ret = 0;
+	int i;
+	
+	for (i = 0; i < len; i++)
+	{
+		int b = high ? len-1-i : i;
+		if (m & COUNT_BIT(b))
+		{
+			ret |= COUNT_BIT(b);
+			m &= ~(high ? COUNT_BIT(b) >> 1 : COUNT_BIT(b) << 1);
+		}
+	}
+	
+	return ret;
+}
+
+static void abcd_count_clear(struct abcd_count *ctx, unsigned int *s, int x, int y, int c)
+{
+	int w = ctx->w, h = ctx->h, n = ctx->n;
+	
+	COUNT_ROWS(s,c)[y] &= ~COUNT_BIT(x);
+	COUNT_COLS(s,c)[x] &= ~COUNT_BIT(y);
+}
+
+static void abcd_count_place(struct abcd_count *ctx, unsigned int *s, int x, int y, int c)
+{
+	int w = ctx->w, h = ctx->h, n = ctx->n;
+	int d, dx, dy;
+	
+	for (d = 0; d < n; d++)
+		if (d != c)
+			abcd_count_clear(ctx, s, x, y, d);
+	
+	for (dy = -1; dy <= 1; dy++)
+	for (dx = -1; dx <= 1; dx++)
+	{
+		if ((!dx && !dy) || (dx && dy && !ctx->diag))
+			continue;
+		if (x+dx < 0 || x+dx >= w || y+dy < 0 || y+dy >= h)
+			continue;
+		abcd_count_clear(ctx, s, x+dx, y+dy, c);
+	}
+	
+	COUNT_FROWS(s,c)[y] |= COUNT_BIT(x);
+	COUNT_FCOLS(s,c)[x] |= COUNT_BIT(y);
+}
+
+/*
+ * Apply the number clue of one line for one letter. Returns -1 on a
+ * contradiction, or the number of changes made.
+ */
+static int abcd_count_line(struct abcd_count *ctx, unsigned int *s, int c, int a, bool horizontal)
+{
+	int w = ctx->w, h = ctx->h, n = ctx->n;
+	int len = horizontal ? w : h;
+	int num = ctx->numbers[horizontal ? HOR_CLUE(a,c) : VER_CLUE(a,c)];
+	unsigned int m, f, fit, forced;
+	int b, ret = 0;
+	
+	if (num == NO_NUMBER)
+		return 0;
+	
+	m = horizontal ? COUNT_ROWS(s,c)[a] : COUNT_COLS(s,c)[a];
+	f = horizontal ? COUNT_FROWS(s,c)[a] : COUNT_FCOLS(s,c)[a];
+	
+	b = abcd_count_bits(f);
+	if (b > num)
+		return -1;
+	if (b == num)
+	{
+		/* The number is satisfied, so rule out all other squares */
+		for (b = 0; b < len; b++)
+		{
+			if (!((m & ~f) & COUNT_BIT(b)))
+				continue;
+			if (horizontal)
+				abcd_count_clear(ctx, s, b, a, c);
+			else
+				abcd_count_clear(ctx, s, a, b, c);
+			ret++;
+		}
+		return ret;
+	}
+	
+	fit = abcd_count_pack(m, len, false);
+	b = abcd_count_bits(fit);
+	if (b < num)
+		return -1;
+	if (b > num)
+		return 0;
+	
+	forced = fit & abcd_count_pack(m, len, true) & ~f;
+	for (b = 0; b < len; b++)
+	{
+		if (!(forced & COUNT_BIT(b)))
+			continue;
+		if (horizontal)
+			abcd_count_place(ctx, s, b, a, c);
+		else
+			abcd_count_place(ctx, s, a, b, c);
+		ret++;
+	}
+	
+	return ret;
+}
+
+/*
+ * Run all deductions until nothing changes. Returns false on a
+ * contradiction.
+ */
+static bool abcd_count_propagate(struct abcd_count *ctx, unsigned int *s)
+{
+	int w = ctx->w, h = ctx->h, n = ctx->n;
+	int x, y, c, last, found, r;
+	bool busy = true;
+	
+	while (busy)
+	{
+		busy = false;
+		
+		for (c = 0; c < n; c++)
+		{
+			for (y = 0; y < h; y++)
+			{
+				r = abcd_count_line(ctx, s, c, y, true);
+				if (r < 0)
+					return false;
+				busy = busy || r;
+			}
+			for (x = 0; x < w; x++)
+			{
+				r = abcd_count_line(ctx, s, c, x, false);
+				if (r < 0)
+					return false;
+				busy = busy || r;
+			}
+		}
+		
+		/* Place letters in squares with a single possibility */
+		for (y = 0; y < h; y++)
+		{
+			unsigned int fixed = 0;
+			for (c = 0; c < n; c++)
+				fixed |= COUNT_FROWS(s,c)[y];
+			
+			for (x = 0; x < w; x++)
+			{
+				if (fixed & COUNT_BIT(x))
+					continue;
+				
+				found = 0;
+				last = 0;
+				for (c = 0; c < n; c++)
+					if (COUNT_ROWS(s,c)[y] & COUNT_BIT(x))
+						found++, last = c;
+				
+				if (!found)
+					return false;
+				if (found == 1)
+				{
+					abcd_count_place(ctx, s, x, y, last);
+					busy = true;
+				}
+			}
+		}
+	}
+	
+	return true;
+}
+
+static void abcd_count_search(struct abcd_count *ctx, int depth)
+{
+	int w = ctx->w, h = ctx->h, n = ctx->n;
+	unsigned int *s = ctx->stack + depth*ctx->size;
+	unsigned int *next = s + ctx->size;
+	int x, y, c, found;
+	int best = -1, bestfound = n+1;
+	
+	if (++ctx->nodes > COUNT_MAXNODES)
+		return;
+	if (!abcd_count_propagate(ctx, s))
+		return;
+	
+	for (y = 0; y < h; y++)
+	{
+		unsigned int fixed = 0;
+		for (c = 0; c < n; c++)
+			fixed |= COUNT_FROWS(s,c)[y];
+		
+		for (x = 0; x < w; x++)
+		{
+			if (fixed & COUNT_BIT(x))
+				continue;
+			
+			found = 0;
+			for (c = 0; c < n; c++)
+				if (COUNT_ROWS(s,c)[y] & COUNT_BIT(x))
+					found++;
+			
+			if (found < bestfound)
+			{
+				best = y*w+x;
+				bestfound = found;
+			}
+		}
+	}
+	
+	/* Every square is filled */
+	if (best < 0)
+	{
+		ctx->count++;
+		if (ctx->other && !ctx->found)
+		{
+			bool differs = !ctx->known;
+			for (c = 0; c < n; c++)
+			for (y = 0; y < h; y++)
+			for (x = 0; x < w; x++)
+			{
+				if (!(COUNT_FROWS(s,c)[y] & COUNT_BIT(x)))
+					continue;
+				ctx->other[y*w+x] = c;
+				if (ctx->known && ctx->known[y*w+x] != c)
+					differs = true;
+			}
+			ctx->found = differs;
+		}
+		return;
+	}
+	
+	x = best % w;
+	y = best / w;
+	for (c = 0; c < n && ctx->count < ctx->limit && ctx->nodes <= COUNT_MAXNODES; c++)
+	{
+		if (!(COUNT_ROWS(s,c)[y] & COUNT_BIT(x)))
+			continue;
+		
+		memcpy(next, s, ctx->size * sizeof(unsigned int));
+		abcd_count_place(ctx, next, x, y, c);
+		abcd_count_search(ctx, depth+1);
+	}
+}
+
+/*
+ * Count the solutions for a set of number clues and the immutable
+ * letters of a state, stopping once limit solutions are found.
+ * If other is not NULL, it receives a solution which differs from the
+ * letters in known, or any solution if known is NULL. Returns -1 if
+ * the grid is too large to count, or the search gave up before it
+ * could tell whether the solution is unique.
+ */
+static int abcd_count_solutions(const game_state *state, const int *numbers, int limit,
+				const char *known, char *other, struct arena *arena)
+{
+	int w = state->w, h = state->h, n = state->n;
+	struct abcd_count ctx;
+	struct arena_mark mark;
+	unsigned int *s;
+	int x, y, c;
+	
+	if (w > COUNT_MAXSIZE || h > COUNT_MAXSIZE)
+		return -1;
+	
+	ctx.w = w;
+	ctx.h = h;
+	ctx.n = n;
+	ctx.diag = state->diag;
+	ctx.numbers = numbers;
+	ctx.size = 2 * n * (w+h);
+	mark = arena_mark(arena);
+	ctx.stack = arena_newn(arena, ctx.size * (w*h + 1), unsigned int);
+	ctx.limit = limit;
+	ctx.count = 0;
+	ctx.nodes = 0;
+	ctx.known = known;
+	ctx.other = other;
+	ctx.found = false;
+	
+	s = ctx.stack;
+	memset(s, 0, ctx.size * sizeof(unsigned int));
+	for (c = 0; c < n; c++)
+	{
+		for (y = 0; y < h; y++)
+			COUNT_ROWS(s,c)[y] = (unsigned int)((1ULL << w) - 1);
+		for (x = 0; x < w; x++)
+			COUNT_COLS(s,c)[x] = (unsigned int)((1ULL << h) - 1);
+	}
+	
+	for (y = 0; y < h; y++)
+	for (x = 0; x < w; x++)
+	{
+		c = state->grid[y*w+x];
+		if (!state->immutable[y*w+x])
+			continue;
+		if (!(COUNT_ROWS(s,c)[y] & COUNT_BIT(x)))
+		{
+			arena_release(arena, mark);
+			return 0;
+		}
+		abcd_count_place(&ctx, s, x, y, c);
+	}
+	
+	abcd_count_search(&ctx, 0);
+	
+	arena_release(arena, mark);
+	if (ctx.nodes > COUNT_MAXNODES && ctx.count < 2)
+		return -1;
+	return ctx.count;
+}
+
+#undef COUNT_ROWS
+#undef COUNT_COLS
+#undef COUNT_FROWS
+#undef COUNT_FCOLS
+
 static char *solve_game(const game_state *state, const game_state *currstate,
 			const char *aux, const char **error)
 {
 	if(aux)
 		return dupstr(aux);
 	
+	struct arena *arena = arena_new();
 	game_state *solved = blank_state(state->w, state->h, state->n, state->diag);
-	int err = abcd_solve_game(state->numbers, solved);
+	abcd_place_givens(solved, state);
+	int err = abcd_solve_game(state->numbers, solved, arena);
+	
+	/* The puzzle may still have a unique solution beyond the solver's rules */
+	if(err == 1 && abcd_count_solutions(state, state->numbers, 2, NULL, solved->grid,
+					    arena) == 1)
+		err = 0;
+	arena_free(arena);
+	
 	char *ret = abcd_format_letters(solved, true);
 	free_game(solved);
 	
@@ -1021,6 +1501,216 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	return ret;
 }
 
+/*
+ * Make the letters in the grid of a state the only solution, by giving
+ * away letters where another solution differs. Afterwards, take back
+ * each given letter which turns out not to be needed. other holds a
+ * solution which differs from the grid. Returns the number of given
+ * letters, or -1 if the solutions couldn't be counted.
+ */
+static int abcd_add_givens(game_state *state, char *other, random_state *rs,
+			   struct arena *arena)
+{
+	int s = state->w * state->h;
+	struct arena_mark mark = arena_mark(arena);
+	int *spaces = arena_newn(arena, s, int);
+	int i, j, k, count;
+	int ret = 0;
+	
+	do
+	{
+		k = 0;
+		for (i = 0; i < s; i++)
+		{
+			if (other[i] != state->grid[i])
+				spaces[k++] = i;
+		}
+		assert(k > 0);
+		
+		state->immutable[spaces[random_upto(rs, k)]] = true;
+		ret++;
+		count = abcd_count_solutions(state, state->numbers, 2, state->grid, other, arena);
+	} while (count > 1);
+	
+	if (count < 0)
+	{
+		arena_release(arena, mark);
+		return -1;
+	}
+	
+	k = 0;
+	for (i = 0; i < s; i++)
+	{
+		if (state->immutable[i])
+			spaces[k++] = i;
+	}
+	shuffle(spaces, k, sizeof(*spaces), rs);
+	
+	for (j = 0; j < k; j++)
+	{
+		state->immutable[spaces[j]] = false;
+		if (abcd_count_solutions(state, state->numbers, 2, NULL, NULL, arena) == 1)
+			ret--;
+		else
+			state->immutable[spaces[j]] = true;
+	}
+	
+	arena_release(arena, mark);
+	return ret;
+}
+
+/*
+ * Number of random grids to try before giving away letters to make one
+ * unique. Smaller puzzles rarely get this far.
+ */
+#define GIVEN_ATTEMPTS 50
+
+/*
+ * The number clues in order, followed by the given letters if there are
+ * any, with runs of empty squares as lowercase letters.
+ */
+static char *abcd_encode_desc(const game_state *state)
+{
+	int w = state->w, h = state->h, n = state->n;
+	int l = w + h;
+	int i, run;
+	bool givens = false;
+	char *ret = snewn(l*n*4 + w*h + 1, char);
+	char *p = ret;
+	
+	for (i = 0; i < l*n; i++)
+	{
+		if (state->numbers[i] != NO_NUMBER)
+			p += sprintf(p, "%d", state->numbers[i]);
+		else
+			*p++ = '-';
+		
+		*p++ = ',';
+	}
+	
+	for (i = 0; i < w*h; i++)
+		givens = givens || state->immutable[i];
+	
+	if (givens)
+	{
+		run = 0;
+		for (i = 0; i < w*h; i++)
+		{
+			if (state->immutable[i])
+			{
+				if (run)
+					*p++ = 'a' - 1 + run;
+				run = 0;
+				*p++ = 'A' + state->grid[i];
+			}
+			else
+			{
+				if (run == 26)
+				{
+					*p++ = 'z';
+					run = 0;
+				}
+				run++;
+			}
+		}
+		if (run)
+			*p++ = 'a' - 1 + run;
+	}
+	
+	*p++ = '\0';
+	return sresize(ret, p - ret, char);
+}
+
+#ifdef DESC_CODEC
+/*
+ * Binary description: the parameters, then each number clue plus one in
+ * as many bits as the largest possible clue needs, so that a hidden
+ * clue is 0. One bit says whether given letters follow, in which case
+ * each square has a bit saying whether it holds one, then the letter.
+ */
+static void abcd_pack(const game_state *state, struct desc_writer *dw)
+{
+	int w = state->w, h = state->h, n = state->n;
+	int nbits = desc_bits_for(2 + max(w, h)/2), lbits = desc_bits_for(n - 1);
+	int i;
+	bool givens = false;
+	
+	desc_put_varint(dw, w);
+	desc_put_varint(dw, h);
+	desc_put_varint(dw, n);
+	desc_put_bits(dw, state->diag, 1);
+	
+	for (i = 0; i < (w+h)*n; i++)
+		desc_put_bits(dw, state->numbers[i] + 1, nbits);
+	
+	for (i = 0; i < w*h; i++)
+		givens = givens || state->immutable[i];
+	desc_put_bits(dw, givens, 1);
+	if (!givens)
+		return;
+	
+	for (i = 0; i < w*h; i++)
+	{
+		desc_put_bits(dw, state->immutable[i], 1);
+		if (state->immutable[i])
+			desc_put_bits(dw, state->grid[i], lbits);
+	}
+}
+
+static game_state *abcd_unpack(struct desc_reader *dr, game_params **params)
+{
+	game_params *ret = default_params();
+	game_state *state;
+	int w, h, n, i, num, nbits, lbits;
+	
+	*params = ret;
+	ret->w = w = desc_get_varint(dr);
+	ret->h = h = desc_get_varint(dr);
+	ret->n = n = desc_get_varint(dr);
+	ret->diag = desc_get_bits(dr, 1);
+	if (dr->error || validate_params(ret, false))
+		return NULL;
+	
+	nbits = desc_bits_for(2 + max(w, h)/2);
+	lbits = desc_bits_for(n - 1);
+	if (!desc_need_bits(dr, (double)(w+h)*n*nbits + 1))
+		return NULL;
+	
+	state = blank_state(w, h, n, ret->diag);
+	memset(state->clues, false, w*h*n);
+	
+	for (i = 0; i < (w+h)*n; i++)
+	{
+		num = (int)desc_get_bits(dr, nbits) - 1;
+		if ((i < h*n && num > 1+(w/2)) || (i >= h*n && num > 1+(h/2)))
+			dr->error = true;
+		state->numbers[i] = num;
+	}
+	
+	if (desc_get_bits(dr, 1))
+	{
+		for (i = 0; i < w*h && !dr->error; i++)
+		{
+			if (!desc_get_bits(dr, 1))
+				continue;
+			state->grid[i] = desc_get_bits(dr, lbits);
+			state->immutable[i] = true;
+			if (state->grid[i] >= n)
+				dr->error = true;
+		}
+	}
+	
+	if (dr->error)
+	{
+		free_game(state);
+		return NULL;
+	}
+	return state;
+}
+
+const struct desc_codec thecodec = { abcd_pack, abcd_unpack, abcd_encode_desc };
+#endif
+
 static char *new_game_desc(const game_params *params, random_state *rs,
 			   char **aux, bool interactive)
 {
@@ -1030,8 +1720,11 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	int l = w+h;
 	bool diag = params->diag;
 	int attempts = 0;
+	int givens = 0;
 	
 	bool valid_puzzle = false;
+	bool ruled = false;
+	struct gen_deadline dl;
 
 #ifdef STANDALONE_SOLVER
 char *debug;
@@ -1039,12 +1732,32 @@ char *debug;
 	
 	game_state *state = NULL;
 	game_state *solved = NULL;
+	struct arena *arena;
+	char *other;
 	
-	char *ret, *p, *point;
+	char *ret, *point;
 	char letters[9];
 	
 	int x, y, i;
 	
+#ifdef DESCPOOL
+	if(interactive)
+	{
+		char *pooled = descpool_take("abcd", params, encode_params, validate_desc);
+		if(pooled)
+			return pooled;
+	}
+#endif
+	
+	/*
+	 * The time budget only applies to removing clues. A random grid either
+	 * has a unique solution or it doesn't, and there is no easier puzzle
+	 * to fall back to.
+	 */
+	gen_deadline_start(&dl, GEN_BUDGET);
+	arena = arena_new();
+	other = arena_newn(arena, w*h, char);
+	
 	while(!valid_puzzle)
 	{
 	
@@ -1057,8 +1770,8 @@ char *debug;
 	* The generation method used here is the simplest one: Make a random grid
 	* with letters, and see if it's a solvable puzzle. This is adequate if at
 	* least one size parameter is odd, but can take thousands of attempts if both
-	* the width and height are even, and the puzzle is large.
-	* (see TODO at the top of this file)
+	* the width and height are even, and the puzzle is large. After a number of
+	* attempts, a grid with several solutions is made unique with given letters.
 	*/
 	
 	for (y = 0; y < h; y++)
@@ -1109,73 +1822,92 @@ if(solver_verbose)
 	
 	/* Check if the puzzle can be solved */
 	solved = blank_state(w,h,n,diag);
-	int error = abcd_solve_game(state->numbers, solved);
+	int error = abcd_solve_game(state->numbers, solved, arena);
 	free_game(solved);
 	if (error == 0)
 	{
 		/* Puzzle is valid */
-		valid_puzzle = true;
+		valid_puzzle = ruled = true;
+	}
+	else
+	{
+		/*
+		* The solver gave up, but the puzzle can still be unique. If it
+		* isn't, it may be close enough to give away a few letters.
+		*/
+		int count = abcd_count_solutions(state, state->numbers, 2, state->grid, other, arena);
+		if (count == 1)
+			valid_puzzle = true;
+		else if (count > 1 && attempts >= GIVEN_ATTEMPTS)
+		{
+			givens = abcd_add_givens(state, other, rs, arena);
+			valid_puzzle = givens >= 0;
+		}
 	}
 	
 	} /* while !valid_puzzle */
 
 #ifdef STANDALONE_SOLVER
-printf("Valid puzzle generated after %i attempt(s) \n", attempts);
+gen_attempts = attempts;
+if(!gen_quiet)
+	printf("Valid puzzle generated after %i attempt(s), with %i given letter(s) \n", attempts, givens);
 #endif
 	
 	if(params->removenums)
 	{
 		/* Create an array with a randomized order of each clue */
-		int *indices = snewn(l*n, int);
+		int *indices = arena_newn(arena, l*n, int);
 		for(i = 0; i < l*n; i++) indices[i] = i;
 		shuffle(indices, l*n, sizeof(*indices), rs);
 		
 		for (i = 0; i < l*n; i++)
 		{
+			/* When out of time, keep the remaining clues */
+			if (gen_deadline_fallback(&dl, "more clues"))
+				break;
+			
 			int clue = state->numbers[indices[i]];
 			state->numbers[indices[i]] = NO_NUMBER;
 			
-			/* Check if it's still solvable */
-			solved = blank_state(w,h,n,diag);
-			int error = abcd_solve_game(state->numbers, solved);
-			free_game(solved);
+			/*
+			* Check if it's still solvable. Puzzles beyond the solver's
+			* rules only need to stay unique.
+			*/
+			int error = 0;
+			if (ruled)
+			{
+				solved = blank_state(w,h,n,diag);
+				error = abcd_solve_game(state->numbers, solved, arena);
+				free_game(solved);
+			}
+			else if (abcd_count_solutions(state, state->numbers, 2, NULL, NULL, arena) != 1)
+				error = 1;
 			
 			/* Not solvable anymore, put the clue back */
 			if (error != 0)
 				state->numbers[indices[i]] = clue;
 		}
-		sfree(indices);
 	}
 	
 	/* We have a valid puzzle. Create game description */
-	
-	ret = snewn(l*n*4 + 1,char);
-	p = ret;
-	
-	for (i = 0; i < l*n; i++)
-	{
-		if (state->numbers[i] != NO_NUMBER)
-			p += sprintf(p, "%d", state->numbers[i]);
-		else
-			*p++ = '-';
-		
-		*p++ = ',';
-	}
+	ret = abcd_encode_desc(state);
 	
 	/* Save aux data */
 	*aux = abcd_format_letters(state, true);
-	
-	*p++ = '\0';
 
 #ifdef STANDALONE_SOLVER
-debug = game_text_format(state);
-printf("%s", debug);
-sfree(debug);
+if(!gen_quiet)
+{
+	debug = game_text_format(state);
+	printf("%s", debug);
+	sfree(debug);
+}
 #endif
 		
 	free_game(state);
+	arena_free(arena);
 	
-	ret = sresize(ret, p - ret, char);
+	GEN_REPORT(&dl);
 
 	return ret;
 }
@@ -1307,6 +2039,10 @@ static char *interpret_move(const game_state *state, game_ui *ui, const game_dra
 				ui->hshow = false;
 			}
 			
+			/* Given letters can't be selected */
+			if(state->immutable[gy*w+gx])
+				ui->hshow = false;
+			
 			ui->hcursor = false;
 			return MOVE_UI_UPDATE;
 		}
@@ -1373,6 +2109,10 @@ static char *interpret_move(const game_state *state, game_ui *ui, const game_dra
 		if (ui->hpencil && state->grid[hy*w+hx] != EMPTY)
 			return MOVE_NO_EFFECT;
 		
+		/* Given letters cannot be changed either */
+		if (state->immutable[hy*w+hx])
+			return MOVE_NO_EFFECT;
+		
 		/* TODO Prevent operations which do nothing */
 		
 		sprintf(buf, "%c%d,%d,%c",
@@ -1449,6 +2189,9 @@ static game_state *execute_move(const game_state *state, const char *move)
 			(c == '-' || (c-'A' >= 0 && c-'A' < n))
 			)
 	{
+		if (state->immutable[y*w+x])
+			return NULL;
+		
 		ret = dup_game(state);
 		
 		if (c == '-')
@@ -1926,7 +2669,8 @@ static void game_redraw(drawing *dr, game_drawstate *ds, const game_state *oldst
 				
 				draw_text(dr, tx + TILE_SIZE/2, ty + TILE_SIZE/2,
 						FONT_VARIABLE, TILE_SIZE/2, ALIGN_HCENTRE|ALIGN_VCENTRE,
-						(fs & FD_ERRMASK ? COL_ERROR : COL_GUESS),
+						(fs & FD_ERRMASK ? COL_ERROR :
+						state->immutable[y*w+x] ? COL_TEXT : COL_GUESS),
 						buf);
 			}
 			else
@@ -2138,6 +2882,9 @@ const struct game thegame = {
 #include <time.h>
 #include <stdarg.h>
 
+#include "genbatch.h"
+#include "solvestream.h"
+
 /* Most of the standalone solver code was copied from unequal.c and singles.c */
 
 const char *quis;
@@ -2146,14 +2893,82 @@ static void usage_exit(const char *msg)
 {
 	if (msg)
 		fprintf(stderr, "%s: %s\n", quis, msg);
-	fprintf(stderr, "Usage: %s [-v] [--seed SEED] <params> | [game_id [game_id ...]]\n", quis);
+	fprintf(stderr, "Usage: %s [-v] [--seed SEED] [--budget MSEC] [--generate COUNT] [--stream] <params> | [game_id [game_id ...]]\n", quis);
 	exit(1);
 }
 
+/*
+ * How a generated puzzle can be solved, for --generate. ABCD has no
+ * difficulty levels, but a puzzle may need the exact solution counter
+ * instead of the solver's rules.
+ */
+static const char *abcd_grade(const game_params *params, const char *desc)
+{
+	game_state *state = new_game(NULL, params, desc);
+	game_state *solved = blank_state(state->w, state->h, state->n, state->diag);
+	struct arena *arena = arena_new();
+	const char *ret = "Rules";
+	
+	abcd_place_givens(solved, state);
+	if (abcd_solve_game(state->numbers, solved, arena) != 0)
+	{
+		if (abcd_count_solutions(state, state->numbers, 2, NULL, NULL, arena) == 1)
+			ret = "Search";
+		else
+			ret = "Unsolved";
+	}
+	
+	arena_free(arena);
+	free_game(solved);
+	free_game(state);
+	return ret;
+}
+
+static const char *const abcd_usenames[] = { "singles", "runs" };
+
+/*
+ * Solve one puzzle for --stream, using the arena in ctx. As for --generate,
+ * a puzzle the rules cannot finish is searched for a unique solution.
+ */
+static void abcd_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+	struct arena *arena = ctx;
+	game_state *solved = blank_state(state->w, state->h, state->n, state->diag);
+	
+	memset(solver_uses, 0, sizeof(solver_uses));
+	abcd_place_givens(solved, state);
+	if (abcd_solve_game(state->numbers, solved, arena) == 0)
+	{
+		res->status = "Solved";
+		res->diff = "Rules";
+	}
+	else
+	{
+		switch (abcd_count_solutions(state, state->numbers, 2, NULL, NULL, arena))
+		{
+		case 0:
+			res->status = "Invalid";
+			break;
+		case 1:
+			res->status = "Solved";
+			res->diff = "Search";
+			break;
+		case 2:
+			res->status = "Ambiguous";
+			break;
+		}
+	}
+	solvestream_counts(res, abcd_usenames, solver_uses, USECOUNT);
+	
+	free_game(solved);
+}
+
 int main(int argc, char *argv[])
 {
 	random_state *rs;
 	time_t seed = time(NULL);
+	int generate = 0;
+	bool stream = false;
 	
 	game_params *params = NULL;
 	
@@ -2172,6 +2987,29 @@ int main(int argc, char *argv[])
 			seed = (time_t)atoi(*++argv);
 			argc--;
 		}
+		else if (!strcmp(p, "--budget"))
+		{
+			if (argc == 0)
+				usage_exit("--budget needs an argument");
+			gen_budget = atol(*++argv);
+			argc--;
+		}
+		else if (!strcmp(p, "--generate"))
+		{
+			if (argc == 0)
+				usage_exit("--generate needs an argument");
+			generate = atoi(*++argv);
+			argc--;
+		}
+		else if (!strcmp(p, "--params"))
+		{
+			if (argc == 0)
+				usage_exit("--params needs an argument");
+			id = *++argv;
+			argc--;
+		}
+		else if (!strcmp(p, "--stream"))
+			stream = true;
 		else if(!strcmp(p, "-v"))
 			solver_verbose = true;
 		else if (*p == '-')
@@ -2196,14 +3034,34 @@ int main(int argc, char *argv[])
 		}
 	}
 	
-	if (!desc)
+	if (stream)
+	{
+		if (id)
+			usage_exit("--stream reads game IDs from stdin");
+		struct arena *arena = arena_new();
+		solvestream_run(stdin, abcd_stream_solve, arena);
+		arena_free(arena);
+	}
+	else if (generate)
+	{
+		if (desc)
+			usage_exit("--generate needs parameters, not a game ID");
+		if(!params) params = default_params();
+		gen_quiet = true;
+		genbatch_run(params, (unsigned long)seed, generate, &gen_attempts, abcd_grade);
+	}
+	else if (!desc)
 	{
 		rs = random_new((void*)&seed, sizeof(time_t));
 		if(!params) params = default_params();
 		char *desc_gen, *aux;
 		printf("Generating puzzle with parameters %s\n", encode_params(params, true));
 		desc_gen = new_game_desc(params, rs, &aux, false);
-		printf("Game ID: %s",desc_gen);
+		printf("Game ID: %s\n",desc_gen);
+		if (gen_fallback)
+			printf("Fallback: %s\n", gen_fallback);
+		printf("Scratch: %lu allocations from %lu heap blocks\n",
+			arena_total_allocs, arena_total_blocks);
 	}
 	else
 	{
@@ -2217,17 +3075,32 @@ int main(int argc, char *argv[])
 		
 		game_state *input = new_game(NULL, params, desc);
 		
+		struct arena *arena = arena_new();
 		game_state *solved = blank_state(params->w, params->h, params->n, params->diag);
-		int errcode = abcd_solve_game(input->numbers, solved);
+		abcd_place_givens(solved, input);
+		int errcode = abcd_solve_game(input->numbers, solved, arena);
+		
+		/* As in solve_game, search when the rules are not enough */
+		if (errcode == 1 && abcd_count_solutions(input, input->numbers, 2, NULL,
+							solved->grid, arena) == 1)
+			errcode = 0;
+		arena_free(arena);
+		
 		if (errcode == 0)
 		{
 			char *fmt = game_text_format(solved);
 			printf("%s", fmt);
 			sfree(fmt);
 		}
+		else
+			fprintf(stderr, "%s\n", errcode == -1 ?
+				"No solution exists for this puzzle." :
+				"Solver could not find a unique solution.");
 		
 		free_game(input);
 		free_game(solved);
+		if (errcode != 0)
+			return 1;
 	}
 	
 	return 0;
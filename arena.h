@@ -0,0 +1,141 @@
+/*
+ * arena.h: Bump-pointer allocator for solver and generator scratch.
+ * See LICENCE for licence details
+ *
+ * A generator which retries until it finds a good puzzle allocates the
+ * same scratch arrays on every attempt, and its solver allocates more
+ * on every step. An arena hands this memory out of a few large blocks
+ * instead. arena_mark records the current position, and arena_release
+ * drops everything allocated since, so a function can take its scratch
+ * at the top and give it all back before returning. Released blocks
+ * are kept for the next allocations, and only go back to the heap when
+ * the arena is freed.
+ *
+ * Memory from an arena is not zeroed, and must not be passed to sfree.
+ */
+
+#ifndef PUZZLES_ARENA_H
+#define PUZZLES_ARENA_H
+
+/* Every allocation is rounded up to a multiple of this */
+#define ARENA_ALIGN 16
+/* Size of the first block. Each later block is twice the size. */
+#define ARENA_BLOCK 4096
+
+struct arena_block {
+	struct arena_block *next;
+	size_t size, used;
+};
+
+/* Room for the block header, keeping the data aligned */
+#define ARENA_HEADER ((sizeof(struct arena_block) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct arena {
+	/* Blocks in the order they are used; those after cur are spare */
+	struct arena_block *first, *cur;
+	size_t nextsize;
+
+	/* Number of allocations made, and heap blocks needed for them */
+	unsigned long allocs, blocks;
+};
+
+struct arena_mark {
+	struct arena_block *block;
+	size_t used;
+};
+
+#ifdef STANDALONE_SOLVER
+/* Totals over every arena freed so far, for the standalone solvers */
+static unsigned long arena_total_allocs, arena_total_blocks;
+#endif
+
+static inline struct arena *arena_new(void)
+{
+	struct arena *arena = snew(struct arena);
+	arena->first = arena->cur = NULL;
+	arena->nextsize = ARENA_BLOCK;
+	arena->allocs = arena->blocks = 0;
+	return arena;
+}
+
+static inline void arena_free(struct arena *arena)
+{
+	struct arena_block *b, *next;
+
+	if(!arena)
+		return;
+#ifdef STANDALONE_SOLVER
+	arena_total_allocs += arena->allocs;
+	arena_total_blocks += arena->blocks;
+#endif
+	for(b = arena->first; b; b = next)
+	{
+		next = b->next;
+		sfree(b);
+	}
+	sfree(arena);
+}
+
+static inline struct arena_mark arena_mark(const struct arena *arena)
+{
+	struct arena_mark mark;
+	mark.block = arena->cur;
+	mark.used = arena->cur ? arena->cur->used : 0;
+	return mark;
+}
+
+/* Drop every allocation made since the mark was taken. */
+static inline void arena_release(struct arena *arena, struct arena_mark mark)
+{
+	arena->cur = mark.block ? mark.block : arena->first;
+	if(arena->cur)
+		arena->cur->used = mark.used;
+}
+
+/* Start a new block, or reuse a spare one, which can hold size bytes */
+static void arena_next_block(struct arena *arena, size_t size)
+{
+	struct arena_block *b = arena->cur, *next;
+
+	next = b ? b->next : arena->first;
+	if(!next || next->size < size)
+	{
+		while(arena->nextsize < size)
+			arena->nextsize *= 2;
+		next = smalloc(ARENA_HEADER + arena->nextsize);
+		next->size = arena->nextsize;
+		next->next = b ? b->next : arena->first;
+		if(b)
+			b->next = next;
+		else
+			arena->first = next;
+		arena->nextsize *= 2;
+		arena->blocks++;
+	}
+	next->used = 0;
+	arena->cur = next;
+}
+
+static inline void *arena_alloc(struct arena *arena, size_t size)
+{
+	struct arena_block *b = arena->cur;
+	void *ret;
+
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	arena->allocs++;
+
+	if(!b || b->used + size > b->size)
+	{
+		arena_next_block(arena, size);
+		b = arena->cur;
+	}
+
+	ret = (char *)b + ARENA_HEADER + b->used;
+	b->used += size;
+	return ret;
+}
+
+#define arena_newn(arena, number, type) \
+	( (type *)arena_alloc((arena), (number)*sizeof(type)) )
+
+#endif
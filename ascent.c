@@ -20,6 +20,10 @@
 
 #include "puzzles.h"
 #include "matching.h"
+#include "gentime.h"
+#ifdef DESCPOOL
+#include "descpool.h"
+#endif
 
 #ifdef STANDALONE_SOLVER
 int solver_verbose = false;
@@ -673,7 +677,13 @@ static int backbite(ascent_step step, int n, cell *path, int w, int h, random_st
 }
 
 #define MAX_ATTEMPTS 1000
-static number *generate_hamiltonian_path(int w, int h, random_state *rs, const game_params *params)
+/*
+ * Generate a random path through the grid. If partial is set, a path which
+ * doesn't cover the entire grid is accepted, and the remaining cells become
+ * walls.
+ */
+static number *generate_hamiltonian_path(int w, int h, random_state *rs,
+                                         const game_params *params, bool partial)
 {
 	cell *path = snewn(w*h, cell);
 	bitmap *walls = NULL;
@@ -759,7 +769,7 @@ static number *generate_hamiltonian_path(int w, int h, random_state *rs, const g
 	}
 
 	/* Build the grid of numbers if the algorithm succeeds. */
-	if (n + wallcount == w*h)
+	if (n + wallcount == w*h || (partial && n > 1))
 	{
 		ret = snewn(w*h, number);
 		for (i = 0; i < w*h; i++)
@@ -952,12 +962,25 @@ static int solver_single_number(struct solver_scratch *scratch, bool simple)
 	return ret;
 }
 
+/* The number of steps needed to move a given distance */
+static int ascent_distance(int hdist, int vdist, int mode)
+{
+	if (mode == MODE_ORTHOGONAL ||
+	   (IS_HEXAGONAL(mode) && ((hdist < 0 && vdist < 0) || (hdist > 0 && vdist > 0))))
+	{
+		/* Manhattan distance */
+		return abs(hdist) + abs(vdist);
+	}
+
+	/* Chebyshev distance */
+	return max(abs(hdist), abs(vdist));
+}
+
 static int solver_near(struct solver_scratch *scratch, cell near, number num, int distance)
 {
 	/* Remove marks which are too far away from a given cell */
 	
 	int w = scratch->w, s = scratch->h*w;
-	int hdist, vdist;
 	int ret = 0;
 	cell i;
 	
@@ -966,19 +989,8 @@ static int solver_near(struct solver_scratch *scratch, cell near, number num, in
 	for(i = 0; i < s; i++)
 	{
 		if(!GET_BIT(scratch->marks, i*s+num)) continue;
-		hdist = (i%w) - (near%w);
-		vdist = (i/w) - (near/w);
-		if (scratch->mode == MODE_ORTHOGONAL ||
-		   (IS_HEXAGONAL(scratch->mode) && ((hdist < 0 && vdist < 0) || (hdist > 0 && vdist > 0))))
-		{
-			/* Manhattan distance */
-			if ((abs(hdist) + abs(vdist)) <= distance) continue;
-		}
-		else
-		{
-			/* Chebyshev distance */
-			if (max(abs(hdist), abs(vdist)) <= distance) continue;
-		}
+		if(ascent_distance((i%w) - (near%w), (i/w) - (near/w), scratch->mode) <= distance)
+			continue;
 		CLR_BIT(scratch->marks, i*s+num);
 		ret++;
 	}
@@ -1016,29 +1028,66 @@ static int solver_proximity_simple(struct solver_scratch *scratch)
 
 static int solver_proximity_full(struct solver_scratch *scratch)
 {
-	/* Remove marks which are too far away from given sequential numbers */
-	
-	int end = scratch->end;
-	cell i; number n, n2;
-	int ret = 0;
-	
-	for(n = 0; n <= end; n++)
+	/*
+	 * Remove marks which are too far away from given sequential numbers.
+	 *
+	 * Each run of unplaced numbers lies between up to two placed numbers.
+	 * A cell at distance d from the placed number before the run can only
+	 * hold numbers at least d after it, and likewise for the placed number
+	 * after the run. This gives each cell a band of numbers it can hold,
+	 * and the marks of the run outside that band are removed.
+	 */
+	int w = scratch->w, h = scratch->h, s = w*h, end = scratch->end;
+	int x, y, xa = 0, ya = 0, xb = 0, yb = 0, ret = 0, count;
+	cell i, ia, ib; number lo, hi, a, b, n, first, last;
+
+	for(lo = 0; lo <= end; lo = hi + 1)
 	{
-		i = scratch->positions[n];
-		if(i < 0) continue;
-		
-		n2 = n-1;
-		while(n2 >= 0 && scratch->positions[n2] == CELL_NONE)
+		hi = lo;
+		if(scratch->positions[lo] != CELL_NONE)
+			continue;
+		while(hi < end && scratch->positions[hi+1] == CELL_NONE)
+			hi++;
+
+		a = lo - 1;
+		b = hi + 1;
+		ia = a >= 0 ? scratch->positions[a] : CELL_NONE;
+		ib = b <= end ? scratch->positions[b] : CELL_NONE;
+		if(ia < 0 && ib < 0)
+			continue;
+
+		if(ia >= 0) { xa = ia%w; ya = ia/w; }
+		if(ib >= 0) { xb = ib%w; yb = ib/w; }
+
+		count = 0;
+		for(y = 0; y < h; y++)
+		for(x = 0; x < w; x++)
 		{
-			ret += solver_near(scratch, i, n2, abs(n-n2));
-			n2--;
+			i = y*w+x;
+			for(n = lo; n <= hi && !GET_BIT(scratch->marks, i*s+n); n++);
+			if(n > hi)
+				continue;
+
+			/* The last number is never bounded by the numbers before it */
+			first = ia >= 0 ? a + ascent_distance(x - xa, y - ya, scratch->mode) : lo;
+			last = ib >= 0 ? b - ascent_distance(x - xb, y - yb, scratch->mode) : hi;
+
+			for(; n <= hi; n++)
+			{
+				if(!GET_BIT(scratch->marks, i*s+n)) continue;
+				if((n >= first || n == end) && n <= last) continue;
+
+				CLR_BIT(scratch->marks, i*s+n);
+				count++;
+			}
 		}
-		n2 = n+1;
-		while(n2 <= end-1 && scratch->positions[n2] == CELL_NONE)
+
+		if(count)
 		{
-			ret += solver_near(scratch, i, n2, abs(n-n2));
-			n2++;
+			solver_printf("Removed %d mark%s of %d-%d for being too far away from the numbers around them\n",
+				count, count != 1 ? "s" : "", lo+1, hi+1);
 		}
+		ret += count;
 	}
 	
 	return ret;
@@ -1379,6 +1428,37 @@ static int solver_remove_blocks(struct solver_scratch *scratch)
 	return ret;
 }
 
+/*
+ * Set the bit at offset+i2 for every cell i2 which is near a mark of
+ * number n. This is the same relation as is_near, found by expanding
+ * each mark through the movement directions.
+ */
+static void solver_dilate(struct solver_scratch *scratch, number n, bitmap *bmp, int offset)
+{
+	int w = scratch->w, h = scratch->h, s = w*h;
+	const ascent_movement *movement = scratch->movement;
+	int x, y, x2, y2, dir;
+	cell i;
+
+	for(i = 0; i < s; i++)
+	{
+		if(!GET_BIT(scratch->marks, i*s+n))
+			continue;
+
+		x = i%w;
+		y = i/w;
+		for(dir = 0; dir < movement->dircount; dir++)
+		{
+			x2 = x + movement->dirs[dir].dx;
+			y2 = y + movement->dirs[dir].dy;
+			if(x2 < 0 || x2 >= w || y2 < 0 || y2 >= h)
+				continue;
+
+			SET_BIT(bmp, offset + y2*w+x2);
+		}
+	}
+}
+
 static int solver_overlap(struct solver_scratch *scratch)
 {
 	/*
@@ -1387,7 +1467,7 @@ static int solver_overlap(struct solver_scratch *scratch)
 	 */
 	int ret = 0;
 	int w = scratch->w, h = scratch->h, s = w*h;
-	cell i1, i2; number n;
+	cell i1; number n;
 
 	for(n = 0; n < scratch->end; n++)
 	{
@@ -1397,34 +1477,10 @@ static int solver_overlap(struct solver_scratch *scratch)
 		memset(scratch->overlap, 0, BITMAP_SIZE(s*2));
 
 		if(n > 0)
-		{
-			for(i1 = 0; i1 < s; i1++)
-			{
-				if(GET_BIT(scratch->marks, i1*s+(n-1)))
-				{
-					for(i2 = 0; i2 < s; i2++)
-					{
-						if(is_near(i1, i2, scratch->w, scratch->mode))
-							SET_BIT(scratch->overlap, i2);
-					}
-				}
-			}
-		}
+			solver_dilate(scratch, n-1, scratch->overlap, 0);
 
 		if(n < scratch->end - 1)
-		{
-			for(i1 = 0; i1 < s; i1++)
-			{
-				if(GET_BIT(scratch->marks, i1*s+(n+1)))
-				{
-					for(i2 = 0; i2 < s; i2++)
-					{
-						if(is_near(i1, i2, w, scratch->mode))
-							SET_BIT(scratch->overlap, i2 + s);
-					}
-				}
-			}
-		}
+			solver_dilate(scratch, n+1, scratch->overlap, s);
 
 		for(i1 = 0; i1 < s; i1++)
 		{
@@ -1554,8 +1610,30 @@ static void ascent_grid_size(const game_params *params, int *w, int *h)
 	}
 }
 
+static void ascent_place_edges(number *puzzle, const number *grid,
+                               const int *match, int w, int h)
+{
+	int i, x, y;
+	int aw = w-2, ah = h-2;
+
+	memcpy(puzzle, grid, w*h*sizeof(number));
+
+	for(i = 0; i < aw*ah; i++)
+	{
+		if(match[i] == -1)
+			continue;
+
+		x = i%aw + 1;
+		y = i/aw + 1;
+
+		puzzle[match[i]] = NUMBER_EDGE(grid[y*w+x]);
+		puzzle[y*w+x] = NUMBER_EMPTY;
+	}
+}
+
 static char ascent_add_edges(struct solver_scratch *scratch, number *grid,
-                             const game_params *params, random_state *rs)
+                             const game_params *params, random_state *rs,
+                             struct gen_deadline *dl)
 {
 	/*
 	 * Randomly move grid numbers to the edges. This is done by creating a
@@ -1621,23 +1699,32 @@ static char ascent_add_edges(struct solver_scratch *scratch, number *grid,
 		int total = matching_with_scratch(mscratch, aw*ah, w*h, adjlists, adjsizes, rs, match, NULL);
 		assert(total > 0);
 
-		memcpy(scratch->grid, grid, w*h*sizeof(number));
-		
-		for(i = 0; i < aw*ah; i++)
-		{
-			if(match[i] == -1)
-				continue;
-			
-			x = i%aw + 1;
-			y = i/aw + 1;
-
-			scratch->grid[match[i]] = NUMBER_EDGE(grid[y*w+x]);
-			scratch->grid[y*w+x] = NUMBER_EMPTY;
-		}
+		ascent_place_edges(scratch->grid, grid, match, w, h);
 
 		ascent_solve(scratch->grid, params->diff, scratch);
 		if (check_completion(scratch->grid, w, h, params->mode))
 			break;
+
+		/*
+		 * When out of time, move numbers back from the edges one at a
+		 * time until the puzzle can be solved. With every number back in
+		 * the grid, it is always solvable.
+		 */
+		if (gen_deadline_fallback(dl, "fewer edge clues"))
+		{
+			for(i = 0; i < aw*ah; i++)
+			{
+				if(match[i] == -1)
+					continue;
+
+				match[i] = -1;
+				ascent_place_edges(scratch->grid, grid, match, w, h);
+				ascent_solve(scratch->grid, params->diff, scratch);
+				if (check_completion(scratch->grid, w, h, params->mode))
+					break;
+			}
+			break;
+		}
 		
 		attempts++;
 	}
@@ -1665,7 +1752,7 @@ static char ascent_add_edges(struct solver_scratch *scratch, number *grid,
 }
 
 static char ascent_remove_numbers(struct solver_scratch *scratch, number *grid,
-	const game_params *params, random_state *rs)
+	const game_params *params, random_state *rs, struct gen_deadline *dl)
 {
 	int w = scratch->w, h = scratch->h;
 	cell *spaces = snewn(w*h, cell);
@@ -1678,6 +1765,10 @@ static char ascent_remove_numbers(struct solver_scratch *scratch, number *grid,
 	shuffle(spaces, w*h, sizeof(*spaces), rs);
 	for(j = 0; j < w*h; j++)
 	{
+		/* When out of time, keep the remaining numbers */
+		if (gen_deadline_fallback(dl, "more clues"))
+			break;
+
 		i1 = spaces[j];
 		i2 = (w*h) - (i1 + 1);
 		temp1 = grid[i1];
@@ -1705,36 +1796,68 @@ static char ascent_remove_numbers(struct solver_scratch *scratch, number *grid,
 	return true;
 }
 
+#ifdef DESCPOOL
+static const char *validate_desc(const game_params *params, const char *desc);
+#endif
+
+#ifdef STANDALONE_SOLVER
+/* Generator attempts, reported by --generate */
+static long gen_attempts;
+#endif
+
 static char *new_game_desc(const game_params *params, random_state *rs,
                            char **aux, bool interactive)
 {
+#ifdef DESCPOOL
+	if(interactive)
+	{
+		char *pooled = descpool_take("ascent", params, encode_params, validate_desc);
+		if(pooled)
+			return pooled;
+	}
+#endif
+
 	int w, h;
 	ascent_grid_size(params, &w, &h);
 
-	bool success;
+	bool success, partial;
 	cell i;
 	struct solver_scratch *scratch = new_scratch(w, h, params->mode, (w*h)-1);
 	number n;
 	number *grid = NULL;
+	struct gen_deadline dl;
+
+	gen_deadline_start(&dl, GEN_BUDGET);
 
 	do
 	{
+#ifdef STANDALONE_SOLVER
+		gen_attempts++;
+#endif
 		scratch->end = (w*h)-1;
 
 		sfree(grid);
 		grid = NULL;
+		partial = false;
 		while (!grid)
 		{
-			grid = generate_hamiltonian_path(w, h, rs, params);
+			grid = generate_hamiltonian_path(w, h, rs, params, partial);
+
+			/*
+			 * When out of time, settle for a path which leaves some cells
+			 * uncovered. This isn't possible with edge clues.
+			 */
+			if (!grid && params->mode != MODE_EDGES)
+				partial = gen_deadline_fallback(&dl, "extra walls");
 		}
 
 		for (i = 0; i < w*h; i++)
 			if (IS_OBSTACLE(grid[i])) scratch->end--;
 
 		if (params->mode == MODE_EDGES)
-			success = ascent_add_edges(scratch, grid, params, rs);
+			success = ascent_add_edges(scratch, grid, params, rs, &dl);
 		else
-			success = ascent_remove_numbers(scratch, grid, params, rs);
+			success = ascent_remove_numbers(scratch, grid, params, rs, &dl);
 	} while (!success);
 
 	char *ret = snewn(w*h*4, char);
@@ -1794,6 +1917,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	ret = sresize(ret, p - ret, char);
 	free_scratch(scratch);
 	sfree(grid);
+	GEN_REPORT(&dl);
 	return ret;
 }
 
@@ -4024,6 +4148,9 @@ const struct game thegame = {
 #ifdef STANDALONE_SOLVER
 #include <time.h>
 
+#include "genbatch.h"
+#include "solvestream.h"
+
 /* Most of the standalone solver code was copied from unequal.c and singles.c */
 
 const char *quis;
@@ -4033,17 +4160,322 @@ static void usage_exit(const char *msg)
 	if (msg)
 		fprintf(stderr, "%s: %s\n", quis, msg);
 	fprintf(stderr,
-			"Usage: %s [-v] [--seed SEED] <params> | [game_id [game_id ...]]\n",
+			"Usage: %s [-v] [--seed SEED] [--budget MSEC] [--check COUNT] [--bench COUNT] [--generate COUNT] [--stream] <params> | [game_id [game_id ...]]\n",
 			quis);
 	exit(1);
 }
 
+/* The pairwise version of solver_overlap, kept to check against */
+static int solver_overlap_pairs(struct solver_scratch *scratch)
+{
+	int ret = 0;
+	int w = scratch->w, h = scratch->h, s = w*h;
+	cell i1, i2; number n;
+
+	for(n = 0; n < scratch->end; n++)
+	{
+		if(scratch->positions[n] != CELL_NONE)
+			continue;
+
+		memset(scratch->overlap, 0, BITMAP_SIZE(s*2));
+
+		if(n > 0)
+		{
+			for(i1 = 0; i1 < s; i1++)
+			{
+				if(GET_BIT(scratch->marks, i1*s+(n-1)))
+				{
+					for(i2 = 0; i2 < s; i2++)
+					{
+						if(is_near(i1, i2, scratch->w, scratch->mode))
+							SET_BIT(scratch->overlap, i2);
+					}
+				}
+			}
+		}
+
+		if(n < scratch->end - 1)
+		{
+			for(i1 = 0; i1 < s; i1++)
+			{
+				if(GET_BIT(scratch->marks, i1*s+(n+1)))
+				{
+					for(i2 = 0; i2 < s; i2++)
+					{
+						if(is_near(i1, i2, w, scratch->mode))
+							SET_BIT(scratch->overlap, i2 + s);
+					}
+				}
+			}
+		}
+
+		for(i1 = 0; i1 < s; i1++)
+		{
+			if(!GET_BIT(scratch->marks, i1*s+n))
+				continue;
+
+			if((n == 0 || GET_BIT(scratch->overlap, i1)) &&
+				(n == scratch->end-1 || GET_BIT(scratch->overlap, i1+s)))
+				continue;
+
+			CLR_BIT(scratch->marks, i1*s+n);
+			ret++;
+		}
+	}
+
+	return ret;
+}
+
+static struct solver_scratch *ascent_copy_scratch(const struct solver_scratch *scratch)
+{
+	int s = scratch->w*scratch->h;
+	struct solver_scratch *ret = new_scratch(scratch->w, scratch->h, scratch->mode, scratch->end);
+
+	memcpy(ret->grid, scratch->grid, s*sizeof(number));
+	memcpy(ret->positions, scratch->positions, s*sizeof(cell));
+	memcpy(ret->marks, scratch->marks, BITMAP_SIZE(s*s));
+
+	return ret;
+}
+
+/* The version of solver_proximity_full which calls solver_near for each number */
+static int solver_proximity_pairs(struct solver_scratch *scratch)
+{	
+	int end = scratch->end;
+	cell i; number n, n2;
+	int ret = 0;
+	
+	for(n = 0; n <= end; n++)
+	{
+		i = scratch->positions[n];
+		if(i < 0) continue;
+		
+		n2 = n-1;
+		while(n2 >= 0 && scratch->positions[n2] == CELL_NONE)
+		{
+			ret += solver_near(scratch, i, n2, abs(n-n2));
+			n2--;
+		}
+		n2 = n+1;
+		while(n2 <= end-1 && scratch->positions[n2] == CELL_NONE)
+		{
+			ret += solver_near(scratch, i, n2, abs(n-n2));
+			n2++;
+		}
+	}
+	
+	return ret;
+}
+
+/*
+ * Fill a scratch space with random placed numbers and marks, and check
+ * that solver_overlap and solver_proximity_full leave the same marks
+ * behind as the pairwise versions they replace.
+ */
+static void ascent_check(random_state *rs, int count)
+{
+	struct solver_scratch *a, *b;
+	int i, w, h, s, mode, density, pass, ra, rb;
+	long removed[2] = { 0, 0 };
+	cell c; number n;
+
+	for(i = 0; i < count; i++)
+	{
+		mode = i % MODECOUNT;
+		w = 2 + random_upto(rs, 11);
+		h = 2 + random_upto(rs, 11);
+		s = w*h;
+		density = 1 + random_upto(rs, 8);
+
+		for(pass = 0; pass < 2; pass++)
+		{
+			a = new_scratch(w, h, mode, s - 1);
+
+			/* Place a few numbers, and mark the rest randomly */
+			for(n = 0; n < s; n++)
+			{
+				c = random_upto(rs, s);
+				if(!random_upto(rs, 8) && a->grid[c] == NUMBER_EMPTY)
+				{
+					a->grid[c] = n;
+					a->positions[n] = c;
+					SET_BIT(a->marks, c*s+n);
+					continue;
+				}
+				for(c = 0; c < s; c++)
+				{
+					if(a->grid[c] == NUMBER_EMPTY && random_upto(rs, 10) < density)
+						SET_BIT(a->marks, c*s+n);
+				}
+			}
+			b = ascent_copy_scratch(a);
+
+			ra = pass ? solver_proximity_full(a) : solver_overlap(a);
+			rb = pass ? solver_proximity_pairs(b) : solver_overlap_pairs(b);
+			if(ra != rb || memcmp(a->marks, b->marks, BITMAP_SIZE(s*s)))
+			{
+				printf("Mismatch in %s on %dx%d grid type %c: removed %d and %d marks\n",
+					pass ? "solver_proximity_full" : "solver_overlap",
+					w, h, ascent_modechars[mode], ra, rb);
+				exit(1);
+			}
+			removed[pass] += ra;
+
+			free_scratch(a);
+			free_scratch(b);
+		}
+	}
+
+	printf("%d grids checked, %ld marks removed by overlap and %ld by proximity\n",
+		count, removed[0], removed[1]);
+}
+
+/*
+ * Generate a number of puzzles, and time one pass of solver_proximity_full
+ * straight after the Easy techniques, and one pass of solver_overlap after
+ * the Normal techniques. Both are compared with the pairwise versions.
+ * solver_proximity_full is also timed on random paths with every tenth
+ * number given, which leaves long runs of unplaced numbers.
+ */
+static void ascent_bench(const game_params *params, random_state *rs, int count)
+{
+	struct solver_scratch *scratch, *copy;
+	game_state *input;
+	char *desc, *aux;
+	clock_t start, times[4] = { 0, 0, 0, 0 };
+	int i, pass;
+
+	for(i = 0; i < count; i++)
+	{
+		desc = new_game_desc(params, rs, &aux, false);
+		input = new_game(NULL, params, desc);
+		scratch = new_scratch(input->w, input->h, input->mode, input->last);
+
+		for(pass = 0; pass < 2; pass++)
+		{
+			ascent_solve(input->grid, pass ? DIFF_NORMAL : DIFF_EASY, scratch);
+
+			copy = ascent_copy_scratch(scratch);
+			start = clock();
+			if(pass) solver_overlap(copy); else solver_proximity_full(copy);
+			times[pass*2] += clock() - start;
+			free_scratch(copy);
+
+			copy = ascent_copy_scratch(scratch);
+			start = clock();
+			if(pass) solver_overlap_pairs(copy); else solver_proximity_pairs(copy);
+			times[pass*2+1] += clock() - start;
+			free_scratch(copy);
+		}
+
+		free_scratch(scratch);
+		free_game(input);
+		sfree(desc);
+	}
+
+	printf("Proximity pass: %.3f ms by runs, %.3f ms by pairs\n",
+		times[0] * 1000.0 / CLOCKS_PER_SEC / count, times[1] * 1000.0 / CLOCKS_PER_SEC / count);
+	printf("Overlap pass: %.3f ms with dilation, %.3f ms with pairs\n",
+		times[2] * 1000.0 / CLOCKS_PER_SEC / count, times[3] * 1000.0 / CLOCKS_PER_SEC / count);
+
+	memset(times, 0, sizeof(times));
+	for(i = 0; i < count; i++)
+	{
+		number *grid = NULL;
+		int w, h;
+		cell c;
+
+		ascent_grid_size(params, &w, &h);
+		while(!grid)
+			grid = generate_hamiltonian_path(w, h, rs, params, false);
+		scratch = new_scratch(w, h, params->mode, w*h-1);
+		for(c = 0; c < w*h; c++)
+		{
+			if(IS_OBSTACLE(grid[c]))
+				scratch->end--;
+			else if(grid[c] % 10)
+				grid[c] = NUMBER_EMPTY;
+		}
+		ascent_solve(grid, DIFF_EASY, scratch);
+
+		copy = ascent_copy_scratch(scratch);
+		start = clock();
+		solver_proximity_full(copy);
+		times[0] += clock() - start;
+		free_scratch(copy);
+
+		copy = ascent_copy_scratch(scratch);
+		start = clock();
+		solver_proximity_pairs(copy);
+		times[1] += clock() - start;
+		free_scratch(copy);
+
+		free_scratch(scratch);
+		sfree(grid);
+	}
+
+	printf("Proximity pass with every tenth number: %.3f ms by runs, %.3f ms by pairs\n",
+		times[0] * 1000.0 / CLOCKS_PER_SEC / count, times[1] * 1000.0 / CLOCKS_PER_SEC / count);
+}
+
+/* Lowest difficulty level which solves a generated puzzle, for --generate */
+static const char *ascent_grade(const game_params *params, const char *desc)
+{
+	game_state *input = new_game(NULL, params, desc);
+	struct solver_scratch *scratch = new_scratch(input->w, input->h, input->mode, input->last);
+	int diff;
+
+	for(diff = 0; diff < DIFFCOUNT; diff++)
+	{
+		ascent_solve(input->grid, diff, scratch);
+		if(check_completion(scratch->grid, input->w, input->h, input->mode))
+			break;
+	}
+
+	free_scratch(scratch);
+	free_game(input);
+	return diff < DIFFCOUNT ? ascent_diffnames[diff] : "Unsolved";
+}
+
+/*
+ * Solve one puzzle for --stream at each difficulty in turn, as for
+ * --generate. ctx holds the solver scratch, which is kept for as long
+ * as the puzzles have the same shape.
+ */
+static void ascent_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+	struct solver_scratch **scratch = ctx;
+	struct solver_scratch *s = *scratch;
+	int diff;
+
+	if(s && (s->w != state->w || s->h != state->h || s->mode != state->mode || s->end != state->last))
+	{
+		free_scratch(s);
+		s = NULL;
+	}
+	if(!s)
+		s = *scratch = new_scratch(state->w, state->h, state->mode, state->last);
+
+	for(diff = 0; diff < DIFFCOUNT; diff++)
+	{
+		ascent_solve(state->grid, diff, s);
+		if(check_completion(s->grid, state->w, state->h, state->mode))
+		{
+			res->status = "Solved";
+			res->diff = ascent_diffnames[diff];
+			break;
+		}
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	random_state *rs;
 	time_t seed = time(NULL);
 
 	game_params *params = NULL;
+	int check = 0, bench = 0, generate = 0;
+	bool stream = false;
 
 	char *id = NULL, *desc = NULL;
 	const char *err;
@@ -4057,7 +4489,34 @@ int main(int argc, char *argv[])
 				usage_exit("--seed needs an argument");
 			seed = (time_t) atoi(*++argv);
 			argc--;
-		} else if (!strcmp(p, "-v"))
+		} else if (!strcmp(p, "--budget")) {
+			if (argc == 0)
+				usage_exit("--budget needs an argument");
+			gen_budget = atol(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--check")) {
+			if (argc == 0)
+				usage_exit("--check needs an argument");
+			check = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--bench")) {
+			if (argc == 0)
+				usage_exit("--bench needs an argument");
+			bench = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--generate")) {
+			if (argc == 0)
+				usage_exit("--generate needs an argument");
+			generate = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--params")) {
+			if (argc == 0)
+				usage_exit("--params needs an argument");
+			id = *++argv;
+			argc--;
+		} else if (!strcmp(p, "--stream"))
+			stream = true;
+		else if (!strcmp(p, "-v"))
 			solver_verbose = true;
 		else if (*p == '-')
 			usage_exit("unrecognised option");
@@ -4080,7 +4539,31 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	if (!desc) {
+	if (stream) {
+		struct solver_scratch *scratch = NULL;
+		if (id)
+			usage_exit("--stream reads game IDs from stdin");
+		solvestream_run(stdin, ascent_stream_solve, &scratch);
+		if (scratch)
+			free_scratch(scratch);
+	} else if (check) {
+		rs = random_new((void *) &seed, sizeof(time_t));
+		ascent_check(rs, check);
+	} else if (generate) {
+		if (desc)
+			usage_exit("--generate needs parameters, not a game ID");
+		if (!params)
+			params = default_params();
+		genbatch_run(params, (unsigned long)seed, generate, &gen_attempts,
+			ascent_grade);
+	} else if (bench) {
+		rs = random_new((void *) &seed, sizeof(time_t));
+		if (!params)
+			params = default_params();
+		printf("Generating %d puzzles with parameters %s\n", bench,
+			encode_params(params, true));
+		ascent_bench(params, rs, bench);
+	} else if (!desc) {
 		char *desc_gen, *aux;
 		rs = random_new((void *) &seed, sizeof(time_t));
 		if (!params)
@@ -4096,6 +4579,8 @@ int main(int argc, char *argv[])
 		}
 
 		printf("Game ID: %s\n", desc_gen);
+		if (gen_fallback)
+			printf("Fallback: %s\n", gen_fallback);
 	} else {
 		game_state *input;
 		struct solver_scratch *scratch;
@@ -37,6 +37,14 @@
 #include <math.h>
 
 #include "puzzles.h"
+#include "gentime.h"
+#include "trail.h"
+#ifdef DESCPOOL
+#include "descpool.h"
+#endif
+#ifdef DESC_CODEC
+#include "desccodec.h"
+#endif
 
 #ifdef STANDALONE_SOLVER
 bool solver_verbose = false;
@@ -770,7 +778,7 @@ static int boats_count_ships(const game_state *state, int *blankcounts, int *shi
 	return ret;
 }
 
-static int boats_adjust_ships(game_state *state)
+static int boats_adjust_ships(game_state *state, struct trail *trail)
 {	
 	int w = state->w;
 	int h = state->h;
@@ -779,7 +787,7 @@ static int boats_adjust_ships(game_state *state)
 	int shipsum = 0;
 	int watersum = 0;
 	int ret = STATUS_COMPLETE;
-	char sleft, sright, sup, sdown;
+	char sleft, sright, sup, sdown, ship;
 	bool edge;
 	
 	/* Count the current and required amount of ships */
@@ -831,20 +839,22 @@ static int boats_adjust_ships(game_state *state)
 		
 		if(sleft == WATER && sright == WATER && 
 			sup == WATER && sdown == WATER)
-			state->grid[y*w+x] = SHIP_SINGLE;
+			ship = SHIP_SINGLE;
 		else if((IS_SHIP(sleft) && IS_SHIP(sright)) || 
 			(IS_SHIP(sup) && IS_SHIP(sdown)))
-			state->grid[y*w+x] = SHIP_CENTER;
+			ship = SHIP_CENTER;
 		else if((edge || sleft == WATER) && IS_SHIP(sright))
-			state->grid[y*w+x] = SHIP_LEFT;
+			ship = SHIP_LEFT;
 		else if((edge || sright == WATER) && IS_SHIP(sleft))
-			state->grid[y*w+x] = SHIP_RIGHT;
+			ship = SHIP_RIGHT;
 		else if((edge || sup == WATER) && IS_SHIP(sdown))
-			state->grid[y*w+x] = SHIP_TOP;
+			ship = SHIP_TOP;
 		else if((edge || sdown == WATER) && IS_SHIP(sup))
-			state->grid[y*w+x] = SHIP_BOTTOM;
+			ship = SHIP_BOTTOM;
 		else
-			state->grid[y*w+x] = SHIP_VAGUE;
+			ship = SHIP_VAGUE;
+		
+		trail_set_char(trail, &state->grid[y*w+x], ship);
 	}
 	
 	return ret;
@@ -1263,7 +1273,8 @@ static char boats_check_dsf(game_state *state, DSF *dsf, int *fleetcount)
 	return ret;
 }
 
-static char boats_validate_full_state(game_state *state, int *blankcounts, int *shipcounts, int *fleetcount, DSF *dsf)
+static char boats_validate_full_state(game_state *state, int *blankcounts, int *shipcounts, int *fleetcount, DSF *dsf,
+	struct trail *trail)
 {
 	/*
 	 * Check if the current state is complete, incomplete, or contains errors.
@@ -1281,7 +1292,7 @@ static char boats_validate_full_state(game_state *state, int *blankcounts, int *
 		return STATUS_INVALID;
 	}
 	
-	adjuststatus = boats_adjust_ships(state);
+	adjuststatus = boats_adjust_ships(state, trail);
 	
 	status = max(status, boats_check_fleet(state, fleetcount, NULL));
 	status = max(status, boats_validate_gridclues(state, NULL));
@@ -1297,20 +1308,23 @@ static char boats_validate_full_state(game_state *state, int *blankcounts, int *
 	return status;
 }
 
-static char boats_validate_state(game_state *state)
+static char boats_validate_state(game_state *state, struct trail *trail)
 {
 	/* Short version of boats_validate_full_state */
-	return boats_validate_full_state(state, NULL, NULL, NULL, NULL);
+	return boats_validate_full_state(state, NULL, NULL, NULL, NULL, trail);
 }
 
 /* ****** *
  * Solver *
  * ****** */
-static int boats_solver_place_water(game_state *state, int x, int y)
+static int boats_solver_place_water(game_state *state, int x, int y, struct trail *trail)
 {
 	/*
 	 * Place water in a square. If the square is out of bounds,
 	 * or already contains water, this function returns 0.
+	 * The solver helpers write through a trail, so that the trial
+	 * moves of the Hard techniques can be undone. Outside those
+	 * trials the trail is NULL.
 	 */
 	
 	int w = state->w;
@@ -1323,19 +1337,19 @@ static int boats_solver_place_water(game_state *state, int x, int y)
 	if(IS_SHIP(state->grid[y*w+x]))
 	{
 		ret++;
-		state->grid[y*w+x] = CORRUPT;
+		trail_set_char(trail, &state->grid[y*w+x], CORRUPT);
 	}
 	else if(state->grid[y*w+x] == EMPTY)
 	{
 		ret++;
-		state->grid[y*w+x] = WATER;
+		trail_set_char(trail, &state->grid[y*w+x], WATER);
 		solver_printf("Place water at %i,%i\n", x, y);
 	}
 	
 	return ret;
 }
  
-static int boats_solver_place_ship(game_state *state, int x, int y)
+static int boats_solver_place_ship(game_state *state, int x, int y, struct trail *trail)
 {
 	/*
 	 * Place a ship in a square, and place water in the diagonally
@@ -1352,18 +1366,18 @@ static int boats_solver_place_ship(game_state *state, int x, int y)
 	if(state->grid[y*w+x] == WATER)
 	{
 		ret++;
-		state->grid[y*w+x] = CORRUPT;
+		trail_set_char(trail, &state->grid[y*w+x], CORRUPT);
 	}
 	else if(state->grid[y*w+x] == EMPTY)
 	{
 		ret++;
-		state->grid[y*w+x] = SHIP_VAGUE;
+		trail_set_char(trail, &state->grid[y*w+x], SHIP_VAGUE);
 		solver_printf("Place ship at %i,%i\n", x, y);
 		
-		ret += boats_solver_place_water(state, x-1, y-1);
-		ret += boats_solver_place_water(state, x+1, y-1);
-		ret += boats_solver_place_water(state, x-1, y+1);
-		ret += boats_solver_place_water(state, x+1, y+1);
+		ret += boats_solver_place_water(state, x-1, y-1, trail);
+		ret += boats_solver_place_water(state, x+1, y-1, trail);
+		ret += boats_solver_place_water(state, x-1, y+1, trail);
+		ret += boats_solver_place_water(state, x+1, y+1, trail);
 	}
 	
 	return ret;
@@ -1391,38 +1405,38 @@ static int boats_solver_initial(game_state *state)
 		switch(state->gridclues[y*w+x])
 		{
 			case WATER:
-				ret += boats_solver_place_water(state, x, y);
+				ret += boats_solver_place_water(state, x, y, NULL);
 				break;
 			case SHIP_VAGUE:
 			case SHIP_CENTER:
-				ret += boats_solver_place_ship(state, x, y);
+				ret += boats_solver_place_ship(state, x, y, NULL);
 				break;
 			case SHIP_TOP:
-				ret += boats_solver_place_ship(state, x, y);
-				ret += boats_solver_place_ship(state, x, y+1);
-				ret += boats_solver_place_water(state, x, y-1);
+				ret += boats_solver_place_ship(state, x, y, NULL);
+				ret += boats_solver_place_ship(state, x, y+1, NULL);
+				ret += boats_solver_place_water(state, x, y-1, NULL);
 				break;
 			case SHIP_BOTTOM:
-				ret += boats_solver_place_ship(state, x, y);
-				ret += boats_solver_place_ship(state, x, y-1);
-				ret += boats_solver_place_water(state, x, y+1);
+				ret += boats_solver_place_ship(state, x, y, NULL);
+				ret += boats_solver_place_ship(state, x, y-1, NULL);
+				ret += boats_solver_place_water(state, x, y+1, NULL);
 				break;
 			case SHIP_LEFT:
-				ret += boats_solver_place_ship(state, x, y);
-				ret += boats_solver_place_ship(state, x+1, y);
-				ret += boats_solver_place_water(state, x-1, y);
+				ret += boats_solver_place_ship(state, x, y, NULL);
+				ret += boats_solver_place_ship(state, x+1, y, NULL);
+				ret += boats_solver_place_water(state, x-1, y, NULL);
 				break;
 			case SHIP_RIGHT:
-				ret += boats_solver_place_ship(state, x, y);
-				ret += boats_solver_place_ship(state, x-1, y);
-				ret += boats_solver_place_water(state, x+1, y);
+				ret += boats_solver_place_ship(state, x, y, NULL);
+				ret += boats_solver_place_ship(state, x-1, y, NULL);
+				ret += boats_solver_place_water(state, x+1, y, NULL);
 				break;
 			case SHIP_SINGLE:
-				ret += boats_solver_place_ship(state, x, y);
-				ret += boats_solver_place_water(state, x+1, y);
-				ret += boats_solver_place_water(state, x-1, y);
-				ret += boats_solver_place_water(state, x, y+1);
-				ret += boats_solver_place_water(state, x, y-1);
+				ret += boats_solver_place_ship(state, x, y, NULL);
+				ret += boats_solver_place_water(state, x+1, y, NULL);
+				ret += boats_solver_place_water(state, x-1, y, NULL);
+				ret += boats_solver_place_water(state, x, y+1, NULL);
+				ret += boats_solver_place_water(state, x, y-1, NULL);
 				break;
 		}
 	}
@@ -1430,7 +1444,8 @@ static int boats_solver_initial(game_state *state)
 	return ret;
 }
 
-static int boats_solver_fill_row(game_state *state, int sx, int sy, int ex, int ey, char fill)
+static int boats_solver_fill_row(game_state *state, int sx, int sy, int ex, int ey, char fill,
+	struct trail *trail)
 {
 	/*
 	 * Fill a row or column with ships or water.
@@ -1447,11 +1462,11 @@ static int boats_solver_fill_row(game_state *state, int sx, int sy, int ex, int
 		{
 			if(IS_SHIP(fill))
 			{
-				ret += boats_solver_place_ship(state, x, y);
+				ret += boats_solver_place_ship(state, x, y, trail);
 			}
 			else if(fill == WATER)
 			{
-				ret += boats_solver_place_water(state, x, y);
+				ret += boats_solver_place_water(state, x, y, trail);
 			}
 		}
 	}
@@ -1483,7 +1498,7 @@ static int boats_solver_check_fill(game_state *state, int *blankcounts)
 		for(i = 0; i < w*h; i++)
 		{
 			if(state->grid[i] == EMPTY)
-				ret += boats_solver_place_ship(state, i%w, i/w);
+				ret += boats_solver_place_ship(state, i%w, i/w, NULL);
 		}
 	}
 	
@@ -1511,12 +1526,12 @@ static int boats_solver_check_counts(game_state *state, int *blankcounts, int *s
 		if(shipcounts[i] == state->borderclues[i] && blankcounts[i] != (h - state->borderclues[i]))
 		{
 			solver_printf("Complete column %i with water\n", i);
-			ret += boats_solver_fill_row(state, i, 0, i, h-1, WATER);
+			ret += boats_solver_fill_row(state, i, 0, i, h-1, WATER, NULL);
 		}
 		else if(shipcounts[i] != state->borderclues[i] && blankcounts[i] == (h - state->borderclues[i]))
 		{
 			solver_printf("Complete column %i with ships\n", i);
-			ret += boats_solver_fill_row(state, i, 0, i, h-1, SHIP_VAGUE);
+			ret += boats_solver_fill_row(state, i, 0, i, h-1, SHIP_VAGUE, NULL);
 		}
 	}
 	/* Check rows */
@@ -1528,12 +1543,12 @@ static int boats_solver_check_counts(game_state *state, int *blankcounts, int *s
 		if(shipcounts[i+w] == state->borderclues[i+w] && blankcounts[i+w] != (w - state->borderclues[i+w]))
 		{
 			solver_printf("Complete row %i with water\n", i);
-			ret += boats_solver_fill_row(state, 0, i, w-1, i, WATER);
+			ret += boats_solver_fill_row(state, 0, i, w-1, i, WATER, NULL);
 		}
 		else if(shipcounts[i+w] != state->borderclues[i+w] && blankcounts[i+w] == (w - state->borderclues[i+w]))
 		{
 			solver_printf("Complete row %i with ships\n", i);
-			ret += boats_solver_fill_row(state, 0, i, w-1, i, SHIP_VAGUE);
+			ret += boats_solver_fill_row(state, 0, i, w-1, i, SHIP_VAGUE, NULL);
 		}
 	}
 	
@@ -1577,7 +1592,7 @@ static int boats_solver_remove_singles(game_state *state, int *fleetcount)
 			state->grid[y*w+x] == EMPTY)
 		{
 			solver_printf("Single square at %i,%i cannot contain boat\n", x, y);
-			ret += boats_solver_place_water(state, x, y);
+			ret += boats_solver_place_water(state, x, y, NULL);
 		}
 		
 		if(state->grid[y*w+x] != SHIP_VAGUE)
@@ -1586,25 +1601,25 @@ static int boats_solver_remove_singles(game_state *state, int *fleetcount)
 		if(sleft == WATER && sright == WATER && sup == WATER && sdown == EMPTY)
 		{
 			solver_printf("Single ship at %i,%i must extend downward\n", x, y);
-			ret += boats_solver_place_ship(state, x, y+1);
+			ret += boats_solver_place_ship(state, x, y+1, NULL);
 		}
 		
 		else if(sleft == WATER && sright == WATER && sdown == WATER && sup == EMPTY)
 		{
 			solver_printf("Single ship at %i,%i must extend upward\n", x, y);
-			ret += boats_solver_place_ship(state, x, y-1);
+			ret += boats_solver_place_ship(state, x, y-1, NULL);
 		}
 		
 		else if(sdown == WATER && sright == WATER && sup == WATER && sleft == EMPTY)
 		{
 			solver_printf("Single ship at %i,%i must extend to the left\n", x, y);
-			ret += boats_solver_place_ship(state, x-1, y);
+			ret += boats_solver_place_ship(state, x-1, y, NULL);
 		}
 		
 		else if(sdown == WATER && sleft == WATER && sup == WATER && sright == EMPTY)
 		{
 			solver_printf("Single ship at %i,%i must extend to the right\n", x, y);
-			ret += boats_solver_place_ship(state, x+1, y);
+			ret += boats_solver_place_ship(state, x+1, y, NULL);
 		}
 	}
 	
@@ -1648,14 +1663,14 @@ static int boats_solver_centers_trivial(game_state *state, bool *hascenters)
 		if(sleft == WATER || sright == WATER)
 		{
 			solver_printf("Center clue at %i,%i confirmed vertical\n", x, y);
-			ret += boats_solver_place_ship(state, x, y-1);
-			ret += boats_solver_place_ship(state, x, y+1);
+			ret += boats_solver_place_ship(state, x, y-1, NULL);
+			ret += boats_solver_place_ship(state, x, y+1, NULL);
 		}
 		else if(sup == WATER || sdown == WATER)
 		{
 			solver_printf("Center clue at %i,%i confirmed horizontal\n", x, y);
-			ret += boats_solver_place_ship(state, x-1, y);
-			ret += boats_solver_place_ship(state, x+1, y);
+			ret += boats_solver_place_ship(state, x-1, y, NULL);
+			ret += boats_solver_place_ship(state, x+1, y, NULL);
 		}
 	}
 	
@@ -1698,7 +1713,7 @@ static int boats_solver_centers_normal(game_state *state, int *shipcounts)
 			if(state->borderclues[y+w] - shipcounts[y+w] < 2)
 			{
 				solver_printf("Center clue %d,%d: Horizontal ship will violate border clue\n", x, y);
-				ret += boats_solver_place_water(state, x+1, y);
+				ret += boats_solver_place_water(state, x+1, y, NULL);
 			}
 		}
 		if(state->borderclues[x] != NO_CLUE)
@@ -1707,7 +1722,7 @@ static int boats_solver_centers_normal(game_state *state, int *shipcounts)
 			if(state->borderclues[x] - shipcounts[x] < 2)
 			{
 				solver_printf("Center clue %d,%d: Vertical ship will violate border clue\n", x, y);
-				ret += boats_solver_place_water(state, x, y+1);
+				ret += boats_solver_place_water(state, x, y+1, NULL);
 			}
 		}
 	}
@@ -1745,7 +1760,7 @@ static int boats_solver_min_expand_dsf_forward(game_state *state, int *fleetcoun
 			continue;
 		
 		solver_printf("Boat of size %d must expand to %d,%d\n", s+1, x, y);
-		return boats_solver_place_ship(state, x, y);
+		return boats_solver_place_ship(state, x, y, NULL);
 	}
 	
 	return 0;
@@ -1781,7 +1796,7 @@ static int boats_solver_min_expand_dsf_back(game_state *state, int *fleetcount,
 		i2 = c1 - d;
 		
 		solver_printf("Boat of size %d must expand to %d,%d\n", s+1, i2%w, i2/w);
-		return boats_solver_place_ship(state, i2%w, i2/w);
+		return boats_solver_place_ship(state, i2%w, i2/w, NULL);
 	}
 	
 	return 0;
@@ -1857,7 +1872,7 @@ static int boats_solver_max_expand_dsf(game_state *state, int *fleetcount, DSF *
 		if(count > max+1)
 		{
 			solver_printf("Ship at %d,%d will result in boat of size %d\n", x, y, count);
-			ret += boats_solver_place_water(state, x, y);
+			ret += boats_solver_place_water(state, x, y, NULL);
 		}
 	}
 	
@@ -1958,15 +1973,15 @@ static int boats_solver_find_max_fleet(game_state *state, int *shipcounts,
 				
 				if(run->horizontal)
 				{
-					ret += boats_solver_place_ship(state, start, run->row);
-					ret += boats_solver_place_water(state, start, (run->row)-1);
-					ret += boats_solver_place_water(state, start, (run->row)+1);
+					ret += boats_solver_place_ship(state, start, run->row, NULL);
+					ret += boats_solver_place_water(state, start, (run->row)-1, NULL);
+					ret += boats_solver_place_water(state, start, (run->row)+1, NULL);
 				}
 				else
 				{
-					ret += boats_solver_place_ship(state, run->row, start);
-					ret += boats_solver_place_water(state, (run->row)-1, start);
-					ret += boats_solver_place_water(state, (run->row)+1, start);
+					ret += boats_solver_place_ship(state, run->row, start, NULL);
+					ret += boats_solver_place_water(state, (run->row)-1, start, NULL);
+					ret += boats_solver_place_water(state, (run->row)+1, start, NULL);
 				}
 			}
 			else if(end - start > 1)
@@ -1977,11 +1992,11 @@ static int boats_solver_find_max_fleet(game_state *state, int *shipcounts,
 				
 				if(run->horizontal)
 				{
-					ret += boats_solver_fill_row(state, start, run->row, end-1, run->row, SHIP_VAGUE);
+					ret += boats_solver_fill_row(state, start, run->row, end-1, run->row, SHIP_VAGUE, NULL);
 				}
 				else
 				{
-					ret += boats_solver_fill_row(state, run->row, start, run->row, end-1, SHIP_VAGUE);
+					ret += boats_solver_fill_row(state, run->row, start, run->row, end-1, SHIP_VAGUE, NULL);
 				}
 			}
 		}
@@ -2020,11 +2035,11 @@ static int boats_solver_split_runs(game_state *state, int *fleetcount,
 			
 			if(run->horizontal)
 			{
-				ret += boats_solver_fill_row(state, run->start, run->row, run->start+len-1, run->row, WATER);
+				ret += boats_solver_fill_row(state, run->start, run->row, run->start+len-1, run->row, WATER, NULL);
 			}
 			else
 			{
-				ret += boats_solver_fill_row(state, run->row, run->start, run->row, run->start+len-1, WATER);
+				ret += boats_solver_fill_row(state, run->row, run->start, run->row, run->start+len-1, WATER, NULL);
 			}
 		}
 	}
@@ -2066,8 +2081,8 @@ static int boats_solver_shared_diagonals(game_state *state, int *watercounts, in
 			
 			if(front + center + back > target)
 			{
-				ret += boats_solver_place_water(state, x, y-1);
-				ret += boats_solver_place_water(state, x, y+1);
+				ret += boats_solver_place_water(state, x, y-1, NULL);
+				ret += boats_solver_place_water(state, x, y+1, NULL);
 			}
 		}
 	}
@@ -2090,8 +2105,8 @@ static int boats_solver_shared_diagonals(game_state *state, int *watercounts, in
 			
 			if(front + center + back > target)
 			{
-				ret += boats_solver_place_water(state, x-1, y);
-				ret += boats_solver_place_water(state, x+1, y);
+				ret += boats_solver_place_water(state, x-1, y, NULL);
+				ret += boats_solver_place_water(state, x+1, y, NULL);
 			}
 		}
 	}
@@ -2105,7 +2120,7 @@ static int boats_solver_shared_diagonals(game_state *state, int *watercounts, in
 	return ret;
 }
 
-static int boats_solver_attempt_ship_rows(game_state *state, char *tmpgrid, int *watercounts)
+static int boats_solver_attempt_ship_rows(game_state *state, struct trail *trail, int *watercounts)
 {
 	/*
 	 * Look for a row/column which needs one more blank space, then
@@ -2117,14 +2132,13 @@ static int boats_solver_attempt_ship_rows(game_state *state, char *tmpgrid, int
 	int h = state->h;
 	int ret = 0;
 	int x = 0, y = 0;
+	int tmark;
 	
 #ifdef STANDALONE_SOLVER
 	bool temp_verbose = solver_verbose;
 	solver_verbose = false;
 #endif
 	
-	memcpy(tmpgrid, state->grid, w*h*sizeof(char));
-	
 	/* Rows */
 	for(y = 0; y < h; y++)
 	{
@@ -2134,26 +2148,26 @@ static int boats_solver_attempt_ship_rows(game_state *state, char *tmpgrid, int
 			{
 				if(state->grid[y*w+x] == EMPTY)
 				{
-					boats_solver_place_water(state, x, y);
-					boats_solver_fill_row(state, 0, y, w-1, y, SHIP_VAGUE);
+					tmark = trail_mark(trail);
+					boats_solver_place_water(state, x, y, trail);
+					boats_solver_fill_row(state, 0, y, w-1, y, SHIP_VAGUE, trail);
 					/* Also fill the column if this square is at an intersection */
 					if(state->borderclues[x] != NO_CLUE && (h - (state->borderclues[x] + watercounts[x])) == 1)
-						boats_solver_fill_row(state, x, 0, x, h-1, SHIP_VAGUE);
+						boats_solver_fill_row(state, x, 0, x, h-1, SHIP_VAGUE, trail);
 					
-					if(boats_validate_state(state) == STATUS_INVALID)
+					if(boats_validate_state(state, trail) == STATUS_INVALID)
 					{
 #ifdef STANDALONE_SOLVER
 						if (temp_verbose) {
 							printf("Row %i: Water at %i,%i leads to violation\n", y, x, y);
 						}
 #endif
-						memcpy(state->grid, tmpgrid, w*h*sizeof(char));
-						ret += boats_solver_place_ship(state, x, y);
-						memcpy(tmpgrid, state->grid, w*h*sizeof(char));
+						trail_rollback(trail, tmark);
+						ret += boats_solver_place_ship(state, x, y, NULL);
 					}
 					else
 					{
-						memcpy(state->grid, tmpgrid, w*h*sizeof(char));
+						trail_rollback(trail, tmark);
 					}
 				}
 			}
@@ -2173,23 +2187,23 @@ static int boats_solver_attempt_ship_rows(game_state *state, char *tmpgrid, int
 				
 				if(state->grid[y*w+x] == EMPTY)
 				{
-					boats_solver_place_water(state, x, y);
-					boats_solver_fill_row(state, x, 0, x, h-1, SHIP_VAGUE);
+					tmark = trail_mark(trail);
+					boats_solver_place_water(state, x, y, trail);
+					boats_solver_fill_row(state, x, 0, x, h-1, SHIP_VAGUE, trail);
 					
-					if(boats_validate_state(state) == STATUS_INVALID)
+					if(boats_validate_state(state, trail) == STATUS_INVALID)
 					{
 #ifdef STANDALONE_SOLVER
 						if (temp_verbose) {
 							printf("Column %i: Water at %i,%i leads to violation\n", x, x, y);
 						}
 #endif
-						memcpy(state->grid, tmpgrid, w*h*sizeof(char));
-						ret += boats_solver_place_ship(state, x, y);
-						memcpy(tmpgrid, state->grid, w*h*sizeof(char));
+						trail_rollback(trail, tmark);
+						ret += boats_solver_place_ship(state, x, y, NULL);
 					}
 					else
 					{
-						memcpy(state->grid, tmpgrid, w*h*sizeof(char));
+						trail_rollback(trail, tmark);
 					}
 				}
 			}
@@ -2200,11 +2214,10 @@ static int boats_solver_attempt_ship_rows(game_state *state, char *tmpgrid, int
 	solver_verbose = temp_verbose;
 #endif
 
-	memcpy(state->grid, tmpgrid, w*h*sizeof(char));
 	return ret;
 }
 
-static int boats_solver_attempt_water_rows(game_state *state, char *tmpgrid, int *shipcounts)
+static int boats_solver_attempt_water_rows(game_state *state, struct trail *trail, int *shipcounts)
 {
 	/*
 	 * Look for a row/column which needs one more ship, then
@@ -2216,14 +2229,13 @@ static int boats_solver_attempt_water_rows(game_state *state, char *tmpgrid, int
 	int h = state->h;
 	int ret = 0;
 	int x = 0, y = 0;
+	int tmark;
 	
 #ifdef STANDALONE_SOLVER
 	bool temp_verbose = solver_verbose;
 	solver_verbose = false;
 #endif
 	
-	memcpy(tmpgrid, state->grid, w*h*sizeof(char));
-	
 	/* Rows */
 	for(y = 0; y < h; y++)
 	{
@@ -2233,25 +2245,25 @@ static int boats_solver_attempt_water_rows(game_state *state, char *tmpgrid, int
 			{
 				if(state->grid[y*w+x] == EMPTY)
 				{
-					boats_solver_place_ship(state, x, y);
-					boats_solver_fill_row(state, 0, y, w-1, y, WATER);
+					tmark = trail_mark(trail);
+					boats_solver_place_ship(state, x, y, trail);
+					boats_solver_fill_row(state, 0, y, w-1, y, WATER, trail);
 					if(state->borderclues[x] != NO_CLUE && state->borderclues[x] - shipcounts[x] == 1)
-						boats_solver_fill_row(state, x, 0, x, h-1, WATER);
+						boats_solver_fill_row(state, x, 0, x, h-1, WATER, trail);
 					
-					if(boats_validate_state(state) == STATUS_INVALID)
+					if(boats_validate_state(state, trail) == STATUS_INVALID)
 					{
 #ifdef STANDALONE_SOLVER
 						if (temp_verbose) {
 							printf("Row %i: Ship at %i,%i leads to violation\n", y, x, y);
 						}
 #endif
-						memcpy(state->grid, tmpgrid, w*h*sizeof(char));
-						ret += boats_solver_place_water(state, x, y);
-						memcpy(tmpgrid, state->grid, w*h*sizeof(char));
+						trail_rollback(trail, tmark);
+						ret += boats_solver_place_water(state, x, y, NULL);
 					}
 					else
 					{
-						memcpy(state->grid, tmpgrid, w*h*sizeof(char));
+						trail_rollback(trail, tmark);
 					}
 				}
 			}
@@ -2270,23 +2282,23 @@ static int boats_solver_attempt_water_rows(game_state *state, char *tmpgrid, int
 				
 				if(state->grid[y*w+x] == EMPTY)
 				{
-					boats_solver_place_ship(state, x, y);
-					boats_solver_fill_row(state, x, 0, x, h-1, WATER);
+					tmark = trail_mark(trail);
+					boats_solver_place_ship(state, x, y, trail);
+					boats_solver_fill_row(state, x, 0, x, h-1, WATER, trail);
 					
-					if(boats_validate_state(state) == STATUS_INVALID)
+					if(boats_validate_state(state, trail) == STATUS_INVALID)
 					{
 #ifdef STANDALONE_SOLVER
 						if (temp_verbose) {
 							printf("Column %i: Ship at %i,%i leads to violation\n", x, x, y);
 						}
 #endif
-						memcpy(state->grid, tmpgrid, w*h*sizeof(char));
-						ret += boats_solver_place_water(state, x, y);
-						memcpy(tmpgrid, state->grid, w*h*sizeof(char));
+						trail_rollback(trail, tmark);
+						ret += boats_solver_place_water(state, x, y, NULL);
 					}
 					else
 					{
-						memcpy(state->grid, tmpgrid, w*h*sizeof(char));
+						trail_rollback(trail, tmark);
 					}
 				}
 			}
@@ -2297,11 +2309,10 @@ static int boats_solver_attempt_water_rows(game_state *state, char *tmpgrid, int
 	solver_verbose = temp_verbose;
 #endif
 
-	memcpy(state->grid, tmpgrid, w*h*sizeof(char));
 	return ret;
 }
 
-static int boats_solver_centers_attempt(game_state *state, char *tmpgrid)
+static int boats_solver_centers_attempt(game_state *state, struct trail *trail)
 {
 	/*
 	 * Attempt each possible direction on a center clue, and check if it
@@ -2311,7 +2322,7 @@ static int boats_solver_centers_attempt(game_state *state, char *tmpgrid)
 	int ret = 0;
 	int w = state->w;
 	int h = state->h;
-	int x, y;
+	int x, y, tmark;
 	
 	char sleft, sright, sup, sdown;
 
@@ -2320,8 +2331,6 @@ static int boats_solver_centers_attempt(game_state *state, char *tmpgrid)
 	solver_verbose = false;
 #endif
 	
-	memcpy(tmpgrid, state->grid, w*h*sizeof(char));
-	
 	for(x = 0; x < w; x++)
 	for(y = 0; y < h; y++)
 	{
@@ -2336,46 +2345,46 @@ static int boats_solver_centers_attempt(game_state *state, char *tmpgrid)
 		if((IS_SHIP(sleft) && IS_SHIP(sright)) || (IS_SHIP(sup) && IS_SHIP(sdown)))
 			continue;
 		
-		boats_solver_place_ship(state, x-1, y);
-		boats_solver_place_ship(state, x+1, y);
+		tmark = trail_mark(trail);
+		boats_solver_place_ship(state, x-1, y, trail);
+		boats_solver_place_ship(state, x+1, y, trail);
 		
-		if(boats_validate_state(state) == STATUS_INVALID)
+		if(boats_validate_state(state, trail) == STATUS_INVALID)
 		{
 #ifdef STANDALONE_SOLVER
 			if (temp_verbose) {
 				printf("Horizontal ship at %i,%i leads to violation\n", x, y);
 			}
 #endif
-			memcpy(state->grid, tmpgrid, w*h*sizeof(char));
-			ret += boats_solver_place_water(state, x+1, y);
-			memcpy(tmpgrid, state->grid, w*h*sizeof(char));
+			trail_rollback(trail, tmark);
+			ret += boats_solver_place_water(state, x+1, y, NULL);
 			
 			continue;
 		}
 		else
 		{
-			memcpy(state->grid, tmpgrid, w*h*sizeof(char));
+			trail_rollback(trail, tmark);
 		}
 		
-		boats_solver_place_ship(state, x, y-1);
-		boats_solver_place_ship(state, x, y+1);
+		tmark = trail_mark(trail);
+		boats_solver_place_ship(state, x, y-1, trail);
+		boats_solver_place_ship(state, x, y+1, trail);
 		
-		if(boats_validate_state(state) == STATUS_INVALID)
+		if(boats_validate_state(state, trail) == STATUS_INVALID)
 		{
 #ifdef STANDALONE_SOLVER
 			if (temp_verbose) {
 				printf("Vertical ship at %i,%i leads to violation\n", x, y);
 			}
 #endif
-			memcpy(state->grid, tmpgrid, w*h*sizeof(char));
-			ret += boats_solver_place_water(state, x, y+1);
-			memcpy(tmpgrid, state->grid, w*h*sizeof(char));
+			trail_rollback(trail, tmark);
+			ret += boats_solver_place_water(state, x, y+1, NULL);
 			
 			continue;
 		}
 		else
 		{
-			memcpy(state->grid, tmpgrid, w*h*sizeof(char));
+			trail_rollback(trail, tmark);
 		}
 	}
 	
@@ -2496,7 +2505,7 @@ static int boats_solve_game(game_state *state, int maxdiff)
 #endif
 	
 	struct boats_run *runs = NULL;
-	char *tmpgrid = NULL;
+	struct trail *trail = NULL;
 	DSF *dsf = NULL;
 	int runcount = 0;
 	int *borderclues = NULL;
@@ -2541,13 +2550,13 @@ static int boats_solve_game(game_state *state, int maxdiff)
 		memcpy(borderclues, state->borderclues, (w+h)*sizeof(int));
 	}
 	if(maxdiff >= DIFF_HARD)
-		tmpgrid = snewn(w*h, char);
+		trail = trail_new();
 	boats_solver_initial(state);
 	
 	while(true)
 	{
 		/* Validation */
-		if(boats_validate_full_state(state, blankcounts, shipcounts, fleetcount, dsf) != STATUS_INCOMPLETE)
+		if(boats_validate_full_state(state, blankcounts, shipcounts, fleetcount, dsf, NULL) != STATUS_INCOMPLETE)
 			break;
 		
 #ifdef STANDALONE_SOLVER
@@ -2623,19 +2632,19 @@ static int boats_solve_game(game_state *state, int maxdiff)
 		if(maxdiff < DIFF_HARD) break;
 		diff = max(diff, DIFF_HARD);
 		
-		if(hascenters && boats_solver_centers_attempt(state, tmpgrid))
+		if(hascenters && boats_solver_centers_attempt(state, trail))
 			continue;
 			
-		if(boats_solver_attempt_ship_rows(state, tmpgrid, blankcounts))
+		if(boats_solver_attempt_ship_rows(state, trail, blankcounts))
 			continue;
 		
-		if(boats_solver_attempt_water_rows(state, tmpgrid, shipcounts))
+		if(boats_solver_attempt_water_rows(state, trail, shipcounts))
 			continue;
 		
 		break;
 	}
 	
-	status = boats_validate_full_state(state, blankcounts, shipcounts, fleetcount, NULL);
+	status = boats_validate_full_state(state, blankcounts, shipcounts, fleetcount, NULL, NULL);
 	
 	if(status == STATUS_INCOMPLETE)
 		diff = -1;
@@ -2649,7 +2658,7 @@ static int boats_solve_game(game_state *state, int maxdiff)
 	sfree(shipcounts);
 	sfree(fleetcount);
 	sfree(runs);
-	sfree(tmpgrid);
+	trail_free(trail);
 	sfree(borderclues);
 	dsf_free(dsf);
 	
@@ -2755,32 +2764,32 @@ static bool boats_generate_fleet(game_state *state, random_state *rs, struct boa
 				
 				if(run->horizontal)
 				{
-					boats_solver_fill_row(state, pos, run->row, pos+f, run->row, SHIP_VAGUE);
+					boats_solver_fill_row(state, pos, run->row, pos+f, run->row, SHIP_VAGUE, NULL);
 					
 					/* Put water on either side */
-					boats_solver_place_water(state, pos-1, run->row);
-					boats_solver_place_water(state, pos+f+1, run->row);
+					boats_solver_place_water(state, pos-1, run->row, NULL);
+					boats_solver_place_water(state, pos+f+1, run->row, NULL);
 					
 					/* If the ship is single, surround it with water */
 					if(f == 0)
 					{
-						boats_solver_place_water(state, pos, run->row-1);
-						boats_solver_place_water(state, pos, run->row+1);
+						boats_solver_place_water(state, pos, run->row-1, NULL);
+						boats_solver_place_water(state, pos, run->row+1, NULL);
 					}
 				}
 				if(!run->horizontal)
 				{
-					boats_solver_fill_row(state, run->row, pos, run->row, pos+f, SHIP_VAGUE);
-					boats_solver_place_water(state, run->row, pos-1);
-					boats_solver_place_water(state, run->row, pos+f+1);
+					boats_solver_fill_row(state, run->row, pos, run->row, pos+f, SHIP_VAGUE, NULL);
+					boats_solver_place_water(state, run->row, pos-1, NULL);
+					boats_solver_place_water(state, run->row, pos+f+1, NULL);
 					if(f == 0)
 					{
-						boats_solver_place_water(state, run->row-1, pos);
-						boats_solver_place_water(state, run->row+1, pos);
+						boats_solver_place_water(state, run->row-1, pos, NULL);
+						boats_solver_place_water(state, run->row+1, pos, NULL);
 					}
 				}
 				
-				boats_adjust_ships(state);
+				boats_adjust_ships(state, NULL);
 				break;
 			}
 			
@@ -2880,25 +2889,201 @@ static void boats_create_borderclues(game_state *state)
 	}
 }
  
+/* Border clues, then grid clues with runs of empty squares as lowercase letters */
+static char *boats_encode_desc(const game_state *state)
+{
+	int w = state->w;
+	int h = state->h;
+	int i, run;
+	char *ret, *p;
+	
+	/* Serialize border clues */
+	ret = snewn(((w+h)*3)+(w*h)+1, char);
+	p = ret;
+	for(i = 0; i < w+h; i++)
+	{
+		if(state->borderclues[i] == NO_CLUE)
+			p += sprintf(p, "-,");
+		else
+			p += sprintf(p, "%d,", state->borderclues[i]);
+	}
+
+	/* Serialize grid clues */
+	run = 0;
+	for(i = 0; i < w*h; i++)
+	{
+		if(state->gridclues[i] == EMPTY)
+			run++;
+		if(run && (run == 26 || state->gridclues[i] != EMPTY))
+		{
+			*p++ = 'a' + (run - 1);
+			run = 0;
+		}
+	
+		switch(state->gridclues[i])
+		{
+			case WATER:
+				*p++ = 'W';
+				break;
+			case SHIP_TOP:
+				*p++ = 'T';
+				break;
+			case SHIP_BOTTOM:
+				*p++ = 'B';
+				break;
+			case SHIP_LEFT:
+				*p++ = 'L';
+				break;
+			case SHIP_RIGHT:
+				*p++ = 'R';
+				break;
+			case SHIP_VAGUE:
+				*p++ = 'V';
+				break;
+			case SHIP_CENTER:
+				*p++ = 'C';
+				break;
+			case SHIP_SINGLE:
+				*p++ = 'S';
+				break;
+		}
+	}
+	
+	*p++ = '\0';
+	return ret;
+}
+
+#ifdef DESC_CODEC
+/*
+ * Binary description: the size and fleet, then each border clue plus
+ * one so that a missing clue is 0. Grid clues are few, so they are
+ * given as a count followed by the position and type of each.
+ */
+static void boats_pack(const game_state *state, struct desc_writer *dw)
+{
+	int w = state->w;
+	int h = state->h;
+	int bbits = desc_bits_for(max(w, h) + 1), pbits = desc_bits_for(w*h - 1);
+	int i, count = 0;
+	
+	desc_put_varint(dw, w);
+	desc_put_varint(dw, h);
+	desc_put_varint(dw, state->fleet);
+	for(i = 0; i < state->fleet; i++)
+		desc_put_varint(dw, state->fleetdata[i]);
+	
+	for(i = 0; i < w+h; i++)
+		desc_put_bits(dw, state->borderclues[i] + 1, bbits);
+	
+	for(i = 0; i < w*h; i++)
+		count += state->gridclues[i] != EMPTY;
+	desc_put_varint(dw, count);
+	for(i = 0; i < w*h; i++)
+	{
+		if(state->gridclues[i] == EMPTY)
+			continue;
+		desc_put_bits(dw, i, pbits);
+		desc_put_bits(dw, state->gridclues[i] - WATER, 3);
+	}
+}
+
+static game_state *boats_unpack(struct desc_reader *dr, game_params **params)
+{
+	game_params *ret = default_params();
+	game_state *state;
+	int w, h, i, j, num, count, bbits, pbits;
+	
+	*params = ret;
+	ret->w = w = desc_get_varint(dr);
+	ret->h = h = desc_get_varint(dr);
+	ret->fleet = desc_get_varint(dr);
+	
+	/* The cheap checks from validate_params, without fitting the fleet */
+	if(dr->error || w < 2 || h < 2 || w > 99 || h > 99 || ret->fleet < 1 || ret->fleet > 9)
+		return NULL;
+	sfree(ret->fleetdata);
+	ret->fleetdata = snewn(ret->fleet, int);
+	for(i = 0; i < ret->fleet; i++)
+		ret->fleetdata[i] = desc_get_varint(dr);
+	
+	bbits = desc_bits_for(max(w, h) + 1);
+	pbits = desc_bits_for(w*h - 1);
+	if(!desc_need_bits(dr, (double)(w+h)*bbits))
+		return NULL;
+	
+	state = blank_game(w, h, ret->fleet, ret->fleetdata);
+	memset(state->gridclues, EMPTY, w*h*sizeof(char));
+	memset(state->grid, EMPTY, w*h*sizeof(char));
+	
+	for(i = 0; i < w+h; i++)
+	{
+		num = (int)desc_get_bits(dr, bbits) - 1;
+		if(num > (i < w ? h : w))
+			dr->error = true;
+		state->borderclues[i] = num;
+	}
+	
+	/* Positions must be in increasing order */
+	count = desc_get_varint(dr);
+	for(j = 0, i = -1; j < count && !dr->error; j++)
+	{
+		num = desc_get_bits(dr, pbits);
+		if(num <= i || num >= w*h)
+			dr->error = true;
+		else
+		{
+			i = num;
+			state->gridclues[i] = WATER + desc_get_bits(dr, 3);
+			state->grid[i] = IS_SHIP(state->gridclues[i]) ? SHIP_VAGUE : WATER;
+		}
+	}
+	
+	if(dr->error)
+	{
+		free_game(state);
+		return NULL;
+	}
+	return state;
+}
+
+const struct desc_codec thecodec = { boats_pack, boats_unpack, boats_encode_desc };
+#endif
+
 #define MAX_ATTEMPTS 1000
  
+#ifdef STANDALONE_SOLVER
+/* Generator attempts, reported by --generate */
+static long gen_attempts;
+#endif
+
 static char *new_game_desc(const game_params *params, random_state *rs,
 			   char **aux, bool interactive)
 {
 	game_state *state;
 	int diff = params->diff;
 	bool strip = params->strip;
-	char *ret = NULL, *p;
+	char *ret = NULL;
 	char *grid;
 	char tempg;
 	int tempb;
 	int w = params->w;
 	int h = params->h;
-	int i, j, run;
+	int i, j;
 	int *spaces;
 	int attempts = 0;
 	struct boats_run *runs = NULL;
+	struct gen_deadline dl;
 	
+#ifdef DESCPOOL
+	if(interactive)
+	{
+		char *pooled = descpool_take("boats", params, encode_params, validate_desc);
+		if(pooled)
+			return pooled;
+	}
+#endif
+	
+	gen_deadline_start(&dl, GEN_BUDGET);
 	state = blank_game(w, h, params->fleet, params->fleetdata);
 	runs = snewn(w*h*2, struct boats_run);
 	spaces = snewn(w*h*2, int);
@@ -2906,6 +3091,9 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	
 restart:	
 	attempts++;
+#ifdef STANDALONE_SOLVER
+	gen_attempts++;
+#endif
 	if(attempts > MAX_ATTEMPTS)
 	{
 		attempts = 0;
@@ -3004,74 +3192,27 @@ restart:
 			if(state->borderclues[i] == NO_CLUE)
 				break;
 		}
-		if(i == w+h) /* No empty clue found */
+		if(i == w+h && /* No empty clue found */
+			!gen_deadline_fallback(&dl, "all border clues kept"))
 			goto restart;
 	}
 	
 	/* 
 	 * Ensure difficulty by making sure the puzzle is not solvable
-	 * at a lower difficulty level. 
+	 * at a lower difficulty level. When out of time, accept the easier
+	 * puzzle, which is still uniquely solvable.
 	 */
-	if(boats_solve_game(state, diff) != diff)
+	if(boats_solve_game(state, diff) != diff &&
+		!gen_deadline_fallback(&dl, "lower difficulty"))
 		goto restart;
 	
-	/* Serialize border clues */
-	ret = snewn(((w+h)*3)+(w*h)+1, char);
-	p = ret;
-	for(i = 0; i < w+h; i++)
-	{
-		if(state->borderclues[i] == NO_CLUE)
-			p += sprintf(p, "-,");
-		else
-			p += sprintf(p, "%d,", state->borderclues[i]);
-	}
-	
-	/* Serialize grid clues */
-	run = 0;
-	for(i = 0; i < w*h; i++)
-	{
-		if(state->gridclues[i] == EMPTY)
-			run++;
-		if(run && (run == 26 || state->gridclues[i] != EMPTY))
-		{
-			*p++ = 'a' + (run - 1);
-			run = 0;
-		}
-		
-		switch(state->gridclues[i])
-		{
-			case WATER:
-				*p++ = 'W';
-				break;
-			case SHIP_TOP:
-				*p++ = 'T';
-				break;
-			case SHIP_BOTTOM:
-				*p++ = 'B';
-				break;
-			case SHIP_LEFT:
-				*p++ = 'L';
-				break;
-			case SHIP_RIGHT:
-				*p++ = 'R';
-				break;
-			case SHIP_VAGUE:
-				*p++ = 'V';
-				break;
-			case SHIP_CENTER:
-				*p++ = 'C';
-				break;
-			case SHIP_SINGLE:
-				*p++ = 'S';
-				break;
-		}
-	}
+	ret = boats_encode_desc(state);
 	
-	*p++ = '\0';
 	free_game(state);
 	sfree(runs);
 	sfree(spaces);
 	sfree(grid);
+	GEN_REPORT(&dl);
 	
 	return ret;
 }
@@ -3353,8 +3494,8 @@ static game_state *execute_move(const game_state *state, const char *move)
 			}
 		}
 		
-		boats_adjust_ships(ret);
-		if(boats_validate_state(ret) == STATUS_COMPLETE)
+		boats_adjust_ships(ret, NULL);
+		if(boats_validate_state(ret, NULL) == STATUS_COMPLETE)
 			ret->completed = true;
 		
 		return ret;
@@ -3379,9 +3520,9 @@ static game_state *execute_move(const game_state *state, const char *move)
 			p++;
 		}
 		
-		boats_adjust_ships(ret);
+		boats_adjust_ships(ret, NULL);
 		
-		if(boats_validate_state(ret) == STATUS_COMPLETE)
+		if(boats_validate_state(ret, NULL) == STATUS_COMPLETE)
 			ret->completed = true;
 		
 		/* 
@@ -4099,6 +4240,9 @@ const struct game thegame = {
 #include <time.h>
 #include <stdarg.h>
 
+#include "genbatch.h"
+#include "solvestream.h"
+
 /* Most of the standalone solver code was copied from unequal.c and singles.c */
 
 const char *quis;
@@ -4108,15 +4252,41 @@ static void usage_exit(const char *msg)
 	if (msg)
 		fprintf(stderr, "%s: %s\n", quis, msg);
 	fprintf(stderr,
-			"Usage: %s [-v | -s] [--seed SEED] <params> | [game_id [game_id ...]]\n",
+			"Usage: %s [-v | -s] [--seed SEED] [--budget MSEC] [--generate COUNT] [--stream] <params> | [game_id [game_id ...]]\n",
 			quis);
 	exit(1);
 }
 
+/* Difficulty level of a generated puzzle, for --generate */
+static const char *boats_grade(const game_params *params, const char *desc)
+{
+	game_state *state = new_game(NULL, params, desc);
+	int diff = boats_solve_game(state, DIFFCOUNT);
+
+	free_game(state);
+	return diff < 0 ? "Unsolved" : boats_diffnames[diff];
+}
+
+/* Solve one puzzle for --stream */
+static void boats_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+	int diff = boats_solve_game(state, DIFFCOUNT);
+
+	if(diff >= 0)
+	{
+		res->status = "Solved";
+		res->diff = boats_diffnames[diff];
+	}
+	else if(diff == -2)
+		res->status = "Invalid";
+}
+
 int main(int argc, char *argv[])
 {
 	random_state *rs;
 	time_t seed = time(NULL);
+	int generate = 0;
+	bool stream = false;
 
 	game_params *params = NULL;
 
@@ -4132,7 +4302,24 @@ int main(int argc, char *argv[])
 				usage_exit("--seed needs an argument");
 			seed = (time_t) atoi(*++argv);
 			argc--;
-		} else if (!strcmp(p, "-v"))
+		} else if (!strcmp(p, "--budget")) {
+			if (argc == 0)
+				usage_exit("--budget needs an argument");
+			gen_budget = atol(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--generate")) {
+			if (argc == 0)
+				usage_exit("--generate needs an argument");
+			generate = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--params")) {
+			if (argc == 0)
+				usage_exit("--params needs an argument");
+			id = *++argv;
+			argc--;
+		} else if (!strcmp(p, "--stream"))
+			stream = true;
+		else if (!strcmp(p, "-v"))
 			solver_verbose = true;
 		else if (!strcmp(p, "-s"))
 		{
@@ -4160,7 +4347,20 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	if (!desc) {
+	if (stream) {
+		if (id)
+			usage_exit("--stream reads game IDs from stdin");
+		solver_steps = false;
+		solvestream_run(stdin, boats_stream_solve, NULL);
+	} else if (generate) {
+		if (desc)
+			usage_exit("--generate needs parameters, not a game ID");
+		solver_steps = false;
+		if (!params)
+			params = default_params();
+		genbatch_run(params, (unsigned long)seed, generate, &gen_attempts,
+			boats_grade);
+	} else if (!desc) {
 		char *desc_gen, *aux, *fmt;
 		solver_steps = false;
 		rs = random_new((void *) &seed, sizeof(time_t));
@@ -4170,11 +4370,19 @@ int main(int argc, char *argv[])
 			   encode_params(params, true));
 		desc_gen = new_game_desc(params, rs, &aux, false);
 
-		fmt = game_text_format(new_game(NULL, params, desc_gen));
+		game_state *generated = new_game(NULL, params, desc_gen);
+		fmt = game_text_format(generated);
 		fputs(fmt, stdout);
 		sfree(fmt);
 
 		printf("Game ID: %s\n", desc_gen);
+		if (gen_fallback) {
+			int found = boats_solve_game(generated, DIFFCOUNT);
+			printf("Fallback: %s\n", gen_fallback);
+			if (found >= 0)
+				printf("Difficulty: %s\n", boats_diffnames[found]);
+		}
+		free_game(generated);
 	} else {
 		game_state *input;
 		int maxdiff;
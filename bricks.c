@@ -23,6 +23,9 @@
 #include <math.h>
 
 #include "puzzles.h"
+#include "arena.h"
+#include "gentime.h"
+#include "trail.h"
 
 enum {
 	COL_MIDLIGHT,
@@ -536,11 +539,12 @@ static void free_game(game_state *state)
  * Solver *
  * ****** */
 
-static int bricks_solver_try(game_state *state)
+static int bricks_solver_try(game_state *state, struct trail *trail)
 {
 	int w = state->w, h = state->h, s = w * h;
 	int i, d;
 	int ret = 0;
+	char status;
 
 	for (i = 0; i < s; i++)
 	{
@@ -551,26 +555,41 @@ static int bricks_solver_try(game_state *state)
 		{
 			/* See if this leads to an invalid state */
 			state->grid[i] = d ? F_SHADE : F_UNSHADE;
-			if (bricks_validate(w, h, state->grid, false) == STATUS_INVALID)
+			status = bricks_validate(w, h, state->grid, false);
+			state->grid[i] = F_EMPTY;
+			if (status == STATUS_INVALID)
 			{
-				state->grid[i] = d ? F_UNSHADE : F_SHADE;
+				trail_set_uint(trail, &state->grid[i], d ? F_UNSHADE : F_SHADE);
 				ret++;
 				break;
 			}
-			else
-				state->grid[i] = F_EMPTY;
 		}
 	}
 
 	return ret;
 }
 
-static int bricks_solve_game(game_state *state, int maxdiff, cell *temp, bool clear, bool strict);
+static int bricks_solve_game(game_state *state, int maxdiff, struct trail *trail,
+	bool clear, bool strict);
 
-static int bricks_solver_recurse(game_state *state, int maxdiff, cell *temp)
+#ifdef STANDALONE_SOLVER
+/* How often each technique made progress, reported by --stream */
+enum { USE_TRY, USE_RECURSE, USECOUNT };
+static long solver_uses[USECOUNT];
+#define SOLVER_USED(t) (solver_uses[t]++)
+#else
+#define SOLVER_USED(t) ((void)0)
+#endif
+
+/*
+ * Shade or unshade a square, and solve on from there at the next lower
+ * difficulty. The trial is undone by rolling back the trail. The error
+ * flags left behind are not put back, as every validation clears them.
+ */
+static int bricks_solver_recurse(game_state *state, int maxdiff, struct trail *trail)
 {
 	int s = state->w*state->h;
-	int i, d;
+	int i, d, mark;
 	int ret = 0, tempresult;
 
 	for (i = 0; i < s; i++)
@@ -581,13 +600,13 @@ static int bricks_solver_recurse(game_state *state, int maxdiff, cell *temp)
 		for (d = 0; d <= 1; d++)
 		{
 			/* See if this leads to an invalid state */
-			memcpy(temp, state->grid, s * sizeof(cell));
-			state->grid[i] = d ? F_SHADE : F_UNSHADE;
-			tempresult = bricks_solve_game(state, maxdiff - 1, NULL, false, false);
-			memcpy(state->grid, temp, s * sizeof(cell));
+			mark = trail_mark(trail);
+			trail_set_uint(trail, &state->grid[i], d ? F_SHADE : F_UNSHADE);
+			tempresult = bricks_solve_game(state, maxdiff - 1, trail, false, false);
+			trail_rollback(trail, mark);
 			if (tempresult == STATUS_INVALID)
 			{
-				state->grid[i] = d ? F_UNSHADE : F_SHADE;
+				trail_set_uint(trail, &state->grid[i], d ? F_UNSHADE : F_SHADE);
 				ret++;
 				break;
 			}
@@ -597,38 +616,50 @@ static int bricks_solver_recurse(game_state *state, int maxdiff, cell *temp)
 	return ret;
 }
 
-static int bricks_solve_game(game_state *state, int maxdiff, cell *temp, bool clear, bool strict)
+/*
+ * trail may be NULL, in which case one is made if recursion needs it.
+ * Only a caller which is making a trial itself should pass one in, or
+ * one which solves many times and commits the trail after each solve.
+ */
+static int bricks_solve_game(game_state *state, int maxdiff, struct trail *trail,
+	bool clear, bool strict)
 {
 	int i;
 	int w = state->w, h = state->h, s = w * h;
 	int ret = STATUS_UNFINISHED;
 
-	cell hastemp = temp != NULL;
-	if (!hastemp && maxdiff >= DIFF_NORMAL)
-		temp = snewn(s, cell);
+	bool hastrail = trail != NULL;
+	if (!hastrail && maxdiff >= DIFF_NORMAL)
+		trail = trail_new();
 	
 	if(clear) {
 		for(i = 0; i < s; i++) {
 			if(state->grid[i] & COL_MASK)
-				state->grid[i] = F_EMPTY;
+				trail_set_uint(trail, &state->grid[i], F_EMPTY);
 		}
 	}
 
 	while ((ret = bricks_validate(w, h, state->grid, strict)) == STATUS_UNFINISHED)
 	{
-		if (bricks_solver_try(state))
+		if (bricks_solver_try(state, trail))
+		{
+			SOLVER_USED(USE_TRY);
 			continue;
+		}
 
 		if (maxdiff < DIFF_NORMAL) break;
 
-		if (bricks_solver_recurse(state, maxdiff, temp))
+		if (bricks_solver_recurse(state, maxdiff, trail))
+		{
+			SOLVER_USED(USE_RECURSE);
 			continue;
+		}
 
 		break;
 	}
 
-	if (temp && !hastemp)
-		sfree(temp);
+	if (!hastrail)
+		trail_free(trail);
 	return ret;
 }
 
@@ -789,11 +820,17 @@ static int bricks_build_numbers(game_state *state)
 	return total;
 }
 
-static char bricks_remove_numbers(game_state *state, int maxdiff, cell *tempgrid, random_state *rs)
+/*
+ * Remove every number the puzzle can do without. Each removal takes a
+ * solve, so once the deadline expires the remaining numbers are kept.
+ */
+static char bricks_remove_numbers(game_state *state, int maxdiff, random_state *rs,
+	struct arena *arena, struct trail *trail, struct gen_deadline *dl)
 {
 	int w = state->w, h = state->h;
-	int *spaces = snewn(w*h, int);
-	int i1, j;
+	struct arena_mark mark = arena_mark(arena);
+	int *spaces = arena_newn(arena, w*h, int);
+	int i1, j, tmark;
 	cell temp;
 
 	for (j = 0; j < w*h; j++)
@@ -805,19 +842,27 @@ static char bricks_remove_numbers(game_state *state, int maxdiff, cell *tempgrid
 		i1 = spaces[j];
 		temp = state->grid[i1];
 		if (temp & F_BOUND) continue;
+		if (gen_deadline_fallback(dl, "more numbers kept")) break;
 		state->grid[i1] = F_EMPTY;
 
-		if (bricks_solve_game(state, maxdiff, tempgrid, true, true) != STATUS_COMPLETE)
+		tmark = trail_mark(trail);
+		if (bricks_solve_game(state, maxdiff, trail, true, true) != STATUS_COMPLETE)
 		{
 			state->grid[i1] = temp;
 		}
+		trail_commit(trail, tmark);
 	}
 
-	sfree(spaces);
+	arena_release(arena, mark);
 
 	return true;
 }
 
+#ifdef STANDALONE_SOLVER
+/* Generator attempts, reported by --generate */
+static long gen_attempts;
+#endif
+
 #define MINIMUM_SHADED 0.4
 static char *new_game_desc(const game_params *params, random_state *rs,
                            char **aux, bool interactive)
@@ -833,27 +878,38 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	int i;
 	cell n;
 	state->grid = snewn(w*h, cell);
-	cell *tempgrid = snewn(w*h, cell);
+
+	struct gen_deadline dl;
+	gen_deadline_start(&dl, GEN_BUDGET);
+
+	/* Scratch for the generator, and a trail which every solve reuses */
+	struct arena *arena = arena_new();
+	struct trail *trail = trail_new();
 
 	while(true)
 	{
+#ifdef STANDALONE_SOLVER
+		gen_attempts++;
+#endif
 		bricks_apply_bounds(w, h, state->grid);
 
 		bricks_fill_grid(state, rs);
 		bricks_build_numbers(state);
 
 		/* Find ambiguous areas by solving the game, then filling in all unknown squares with a number */
-		bricks_solve_game(state, DIFF_EASY, tempgrid, true, false);
+		bricks_solve_game(state, DIFF_EASY, NULL, true, false);
 		total = bricks_build_numbers(state);
 
 		/* Enforce minimum percentage of shaded squares */
-		if((total * 1.0f) / spaces < MINIMUM_SHADED)
+		if((total * 1.0f) / spaces < MINIMUM_SHADED &&
+			!gen_deadline_fallback(&dl, "fewer shaded squares"))
 			continue;
 
-		bricks_remove_numbers(state, params->diff, tempgrid, rs);
+		bricks_remove_numbers(state, params->diff, rs, arena, trail, &dl);
 
 		/* Enforce minimum difficulty */
-		if(params->diff > DIFF_EASY && spaces > 6 && bricks_solve_game(state, DIFF_EASY, tempgrid, true, true) == STATUS_COMPLETE)
+		if(params->diff > DIFF_EASY && spaces > 6 && bricks_solve_game(state, DIFF_EASY, NULL, true, true) == STATUS_COMPLETE &&
+			!gen_deadline_fallback(&dl, "lower difficulty"))
 			continue;
 
 		break;
@@ -898,7 +954,9 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	*p++ = '\0';
 	ret = sresize(ret, p - ret, char);
 	free_game(state);
-	sfree(tempgrid);
+	trail_free(trail);
+	arena_free(arena);
+	GEN_REPORT(&dl);
 	return ret;
 }
 
@@ -1671,6 +1729,9 @@ const struct game thegame = {
 #ifdef STANDALONE_SOLVER
 #include <time.h>
 
+#include "genbatch.h"
+#include "solvestream.h"
+
 /* Most of the standalone solver code was copied from unequal.c and singles.c */
 
 const char *quis;
@@ -1680,15 +1741,61 @@ static void usage_exit(const char *msg)
 	if (msg)
 		fprintf(stderr, "%s: %s\n", quis, msg);
 	fprintf(stderr,
-			"Usage: %s [-v] [--seed SEED] <params> | [game_id [game_id ...]]\n",
+			"Usage: %s [-v] [--seed SEED] [--budget MSEC] [--generate COUNT] [--stream] <params> | [game_id [game_id ...]]\n",
 			quis);
 	exit(1);
 }
 
+/* Lowest difficulty level which solves a generated puzzle, for --generate */
+static const char *bricks_grade(const game_params *params, const char *desc)
+{
+	game_state *state = new_game(NULL, params, desc);
+	int diff;
+
+	for (diff = 0; diff < DIFFCOUNT; diff++)
+	{
+		if (bricks_solve_game(state, diff, NULL, true, true) == STATUS_COMPLETE)
+			break;
+	}
+	free_game(state);
+	return diff < DIFFCOUNT ? bricks_diffnames[diff] : "Unsolved";
+}
+
+static const char *const bricks_usenames[] = { "try", "recurse" };
+
+/*
+ * Solve one puzzle for --stream at each difficulty in turn, as for
+ * --generate, using the trail in ctx. The counts are for the last try.
+ */
+static void bricks_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+	struct trail *trail = ctx;
+	int diff, mark, result = STATUS_UNFINISHED;
+
+	for (diff = 0; diff < DIFFCOUNT && result == STATUS_UNFINISHED; diff++)
+	{
+		memset(solver_uses, 0, sizeof(solver_uses));
+		mark = trail_mark(trail);
+		result = bricks_solve_game(state, diff, trail, true, true);
+		trail_commit(trail, mark);
+	}
+
+	if (result == STATUS_COMPLETE)
+	{
+		res->status = "Solved";
+		res->diff = bricks_diffnames[diff - 1];
+	}
+	else if (result == STATUS_INVALID)
+		res->status = "Invalid";
+	solvestream_counts(res, bricks_usenames, solver_uses, USECOUNT);
+}
+
 int main(int argc, char *argv[])
 {
 	random_state *rs;
 	time_t seed = time(NULL);
+	int generate = 0;
+	bool stream = false;
 
 	game_params *params = NULL;
 
@@ -1704,7 +1811,24 @@ int main(int argc, char *argv[])
 				usage_exit("--seed needs an argument");
 			seed = (time_t) atoi(*++argv);
 			argc--;
-		} else if (*p == '-')
+		} else if (!strcmp(p, "--budget")) {
+			if (argc == 0)
+				usage_exit("--budget needs an argument");
+			gen_budget = atol(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--generate")) {
+			if (argc == 0)
+				usage_exit("--generate needs an argument");
+			generate = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--params")) {
+			if (argc == 0)
+				usage_exit("--params needs an argument");
+			id = *++argv;
+			argc--;
+		} else if (!strcmp(p, "--stream"))
+			stream = true;
+		else if (*p == '-')
 			usage_exit("unrecognised option");
 		else
 			id = p;
@@ -1725,7 +1849,21 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	if (!desc) {
+	if (stream) {
+		struct trail *trail;
+		if (id)
+			usage_exit("--stream reads game IDs from stdin");
+		trail = trail_new();
+		solvestream_run(stdin, bricks_stream_solve, trail);
+		trail_free(trail);
+	} else if (generate) {
+		if (desc)
+			usage_exit("--generate needs parameters, not a game ID");
+		if (!params)
+			params = default_params();
+		genbatch_run(params, (unsigned long)seed, generate, &gen_attempts,
+			bricks_grade);
+	} else if (!desc) {
 		char *desc_gen, *aux;
 		rs = random_new((void *) &seed, sizeof(time_t));
 		if (!params)
@@ -1739,6 +1877,10 @@ int main(int argc, char *argv[])
 		sfree(fmt);
 
 		printf("Game ID: %s\n", desc_gen);
+		if (gen_fallback)
+			printf("Fallback: %s\n", gen_fallback);
+		printf("Scratch: %lu allocations from %lu heap blocks\n",
+			arena_total_allocs, arena_total_blocks);
 	} else {
 		game_state *input;
 		
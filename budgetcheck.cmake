@@ -0,0 +1,76 @@
+# budgetcheck.cmake: Check that generators out of time still make good puzzles.
+# See LICENCE for licence details
+#
+# Run as a script with
+#
+#   cmake -DSOLVER=<game>solver -DPARAMS=<params> -DCOUNT=<n> -P budgetcheck.cmake
+#
+# Generates COUNT puzzles with a 1 ms budget, so that every fallback is
+# taken, then solves each of them with --stream. Fails unless every one
+# is reported as Solved, which the standalone solvers only do for
+# puzzles with a unique solution.
+
+cmake_policy(SET CMP0007 NEW)
+
+if(NOT SOLVER OR NOT PARAMS OR NOT COUNT)
+  message(FATAL_ERROR "budgetcheck.cmake needs SOLVER, PARAMS and COUNT")
+endif()
+
+execute_process(
+  COMMAND ${SOLVER} --seed 1 --budget 1 --generate ${COUNT} --params ${PARAMS}
+  OUTPUT_VARIABLE generated
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "${SOLVER} --generate failed: ${result}")
+endif()
+
+# The description is the last column, after the header line
+string(REPLACE "\n" ";" lines "${generated}")
+list(REMOVE_AT lines 0)
+set(ids "")
+set(n 0)
+foreach(line IN LISTS lines)
+  if(line STREQUAL "")
+    continue()
+  endif()
+  string(REGEX REPLACE ".*\t" "" desc "${line}")
+  string(APPEND ids "${PARAMS}:${desc}\n")
+  math(EXPR n "${n} + 1")
+endforeach()
+if(NOT n EQUAL COUNT)
+  message(FATAL_ERROR "${SOLVER} generated ${n} puzzles, not ${COUNT}")
+endif()
+
+get_filename_component(name ${SOLVER} NAME_WE)
+set(idfile ${CMAKE_CURRENT_BINARY_DIR}/${name}-budget.txt)
+file(WRITE ${idfile} "${ids}")
+
+execute_process(
+  COMMAND ${SOLVER} --stream
+  INPUT_FILE ${idfile}
+  OUTPUT_VARIABLE solved
+  ERROR_QUIET
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "${SOLVER} --stream failed: ${result}")
+endif()
+
+string(REPLACE "\n" ";" lines "${solved}")
+list(REMOVE_AT lines 0)
+set(nbad 0)
+foreach(line IN LISTS lines)
+  if(line STREQUAL "")
+    continue()
+  endif()
+  string(REPLACE "\t" ";" fields "${line}")
+  list(GET fields 1 status)
+  if(NOT status STREQUAL "Solved")
+    list(GET fields 0 lineno)
+    message(SEND_ERROR "${PARAMS} puzzle ${lineno} is ${status}")
+    math(EXPR nbad "${nbad} + 1")
+  endif()
+endforeach()
+if(nbad GREATER 0)
+  message(FATAL_ERROR "${nbad} of ${COUNT} puzzles from ${SOLVER} were not solved")
+endif()
+message(STATUS "${PARAMS}: ${COUNT} puzzles generated within budget, all solved")
@@ -22,6 +22,8 @@
 #include <math.h>
 
 #include "puzzles.h"
+#include "gentime.h"
+#include "trail.h"
 
 enum {
 	COL_BACKGROUND,
@@ -35,8 +37,30 @@ enum {
 	NCOLOURS
 };
 
+/*
+ * Hard is a solver tier, used to solve any game ID, but no generated
+ * board has yet needed nested probes, so it cannot be generated.
+ */
+#define GENDIFFLIST(A)                          \
+	A(EASY,Easy, e)                             \
+	A(NORMAL,Normal, n)                         \
+
+#define DIFFLIST(A)                             \
+	GENDIFFLIST(A)                              \
+	A(HARD,Hard, h)                             \
+
+#define ENUM(upper,title,lower) DIFF_ ## upper,
+#define TITLE(upper,title,lower) #title,
+#define ENCODE(upper,title,lower) #lower
+#define CONFIG(upper,title,lower) ":" #title
+enum { DIFFLIST(ENUM) DIFFCOUNT };
+static char const *const clusters_diffnames[] = { DIFFLIST(TITLE) };
+
+static char const clusters_diffchars[] = DIFFLIST(ENCODE);
+#define DIFFCONFIG GENDIFFLIST(CONFIG)
+
 struct game_params {
-	int w, h;
+	int w, h, diff;
 };
 
 #define F_COLOR_0    0x01
@@ -55,10 +79,12 @@ struct game_state {
 };
 
 const static struct game_params clusters_presets[] = {
-	{ 7, 7 },
-	{ 8, 8 },
-	{ 9, 9 },
-	{ 10, 10 },
+	{ 7, 7, DIFF_EASY },
+	{ 7, 7, DIFF_NORMAL },
+	{ 8, 8, DIFF_NORMAL },
+	{ 9, 9, DIFF_NORMAL },
+	{ 10, 10, DIFF_EASY },
+	{ 10, 10, DIFF_NORMAL },
 };
 
 static game_params *default_params(void)
@@ -67,6 +93,7 @@ static game_params *default_params(void)
 
 	ret->w = 7;
 	ret->h = 7;
+	ret->diff = DIFF_NORMAL;
 
 	return ret;
 }
@@ -82,7 +109,7 @@ static bool game_fetch_preset(int i, char **name, game_params **params)
 	ret = snew(game_params);
 	*ret = clusters_presets[i]; /* structure copy */
 
-	sprintf(buf, "%dx%d", ret->w, ret->h);
+	sprintf(buf, "%dx%d %s", ret->w, ret->h, clusters_diffnames[ret->diff]);
 
 	*name = dupstr(buf);
 	*params = ret;
@@ -115,13 +142,29 @@ static void decode_params(game_params *params, char const *string)
 	else {
 		params->h = params->w;
 	}
+
+	if (*p == 'd') {
+		int i;
+		p++;
+		params->diff = DIFFCOUNT + 1;   /* ...which is invalid */
+		if (*p) {
+			for (i = 0; i < DIFFCOUNT; i++) {
+				if (*p == clusters_diffchars[i])
+					params->diff = i;
+			}
+			p++;
+		}
+	}
 }
 
 static char *encode_params(const game_params *params, bool full)
 {
 	char buf[80];
+	char *p = buf;
 
-	sprintf(buf, "%dx%d", params->w, params->h);
+	p += sprintf(p, "%dx%d", params->w, params->h);
+	if (full)
+		p += sprintf(p, "d%c", clusters_diffchars[params->diff]);
 
 	return dupstr(buf);
 }
@@ -131,7 +174,7 @@ static config_item *game_configure(const game_params *params)
 	config_item *ret;
 	char buf[64];
 
-	ret = snewn(3, config_item);
+	ret = snewn(4, config_item);
 
 	ret[0].name = "Width";
 	ret[0].type = C_STRING;
@@ -143,8 +186,13 @@ static config_item *game_configure(const game_params *params)
 	sprintf(buf, "%d", params->h);
 	ret[1].u.string.sval = dupstr(buf);
 
-	ret[2].name = NULL;
-	ret[2].type = C_END;
+	ret[2].name = "Difficulty";
+	ret[2].type = C_CHOICES;
+	ret[2].u.choices.choicenames = DIFFCONFIG;
+	ret[2].u.choices.selected = params->diff;
+
+	ret[3].name = NULL;
+	ret[3].type = C_END;
 
 	return ret;
 }
@@ -155,6 +203,7 @@ static game_params *custom_params(const config_item *cfg)
 
 	ret->w = atoi(cfg[0].u.string.sval);
 	ret->h = atoi(cfg[1].u.string.sval);
+	ret->diff = cfg[2].u.choices.selected;
 
 	return ret;
 }
@@ -167,6 +216,12 @@ static const char *validate_params(const game_params *params, bool full)
 	if (params->w * params->h < 2)
 		return "Puzzle is too small";
 
+	if (params->diff >= DIFFCOUNT)
+		return "Unknown difficulty rating";
+
+	if (full && params->diff > DIFF_NORMAL)
+		return "Hard puzzles cannot be generated";
+
 	return NULL;
 }
 
@@ -192,12 +247,36 @@ static int clusters_count(const game_state *state, int x, int y, int col,
 
 enum { STATUS_COMPLETE, STATUS_UNFINISHED, STATUS_INVALID };
 
+/*
+ * Check the rules around a coloured tile, counting empty neighbours as
+ * if they could still take its colour.
+ */
+static bool clusters_cell_error(const game_state *state, int x, int y)
+{
+	int w = state->w;
+	int col = state->grid[y*w + x] & COLMASK;
+	int count = 0, othercount = 0, emptycount = 0, maxcount = 0;
+
+	maxcount += clusters_count(state, x - 1, y, col, &count, &othercount, &emptycount);
+	maxcount += clusters_count(state, x + 1, y, col, &count, &othercount, &emptycount);
+	maxcount += clusters_count(state, x, y - 1, col, &count, &othercount, &emptycount);
+	maxcount += clusters_count(state, x, y + 1, col, &count, &othercount, &emptycount);
+
+	if (othercount == maxcount)
+		return true;
+	if (state->grid[y*w + x] & F_SINGLE && count > 1)
+		return true;
+	if (!(state->grid[y*w + x] & F_SINGLE) && othercount == maxcount - 1)
+		return true;
+
+	return false;
+}
+
 static int clusters_validate(game_state *state)
 {
 	int w = state->w;
 	int h = state->h;
-	int x, y, col, count, othercount, emptycount, maxcount;
-	bool error;
+	int x, y;
 	char ret = STATUS_COMPLETE;
 
 	for (y = 0; y < h; y++)
@@ -208,23 +287,8 @@ static int clusters_validate(game_state *state)
 				if(ret == STATUS_COMPLETE) ret = STATUS_UNFINISHED;
 				continue;
 			}
-			col = state->grid[y*w + x] & COLMASK;
-			count = othercount = emptycount = maxcount = 0;
-			error = false;
-
-			maxcount += clusters_count(state, x - 1, y, col, &count, &othercount, &emptycount);
-			maxcount += clusters_count(state, x + 1, y, col, &count, &othercount, &emptycount);
-			maxcount += clusters_count(state, x, y - 1, col, &count, &othercount, &emptycount);
-			maxcount += clusters_count(state, x, y + 1, col, &count, &othercount, &emptycount);
-
-			if (othercount == maxcount)
-				error = true;
-			else if (state->grid[y*w + x] & F_SINGLE && count > 1)
-				error = true;
-			else if (!(state->grid[y*w + x] & F_SINGLE) && othercount == maxcount - 1)
-				error = true;
 
-			if (error)
+			if (clusters_cell_error(state, x, y))
 			{
 				ret = STATUS_INVALID;
 				state->grid[y*w + x] |= F_ERROR;
@@ -367,11 +431,33 @@ static void free_game(game_state *state)
  * Solver *
  * ****** */
 
-static int clusters_solver_try(game_state *state)
+/*
+ * Colouring a tile can only break the rules for the tile itself and
+ * its neighbours, so those are the only tiles checked.
+ */
+static bool clusters_local_error(const game_state *state, int i)
+{
+	int w = state->w, h = state->h;
+	int x = i%w, y = i/w;
+
+	return clusters_cell_error(state, x, y) ||
+		(x > 0 && state->grid[i-1] && clusters_cell_error(state, x-1, y)) ||
+		(x < w-1 && state->grid[i+1] && clusters_cell_error(state, x+1, y)) ||
+		(y > 0 && state->grid[i-w] && clusters_cell_error(state, x, y-1)) ||
+		(y < h-1 && state->grid[i+w] && clusters_cell_error(state, x, y+1));
+}
+
+/*
+ * Easy: A tile must take the other colour if this colour would leave a
+ * dead end with too many neighbours of its colour, or a tile with too
+ * few neighbours that can still take its colour.
+ */
+static int clusters_solver_direct(game_state *state, struct trail *trail)
 {
 	int s = state->w*state->h;
 	int i, d;
 	int ret = 0;
+	bool error;
 
 	for (i = 0; i < s; i++)
 	{
@@ -380,28 +466,44 @@ static int clusters_solver_try(game_state *state)
 
 		for (d = 0; d <= 1; d++)
 		{
-			/* See if this leads to an invalid state */
+			/* Only the deduction needs to go on the trail */
 			state->grid[i] = d ? F_COLOR_1 : F_COLOR_0;
-			if (clusters_validate(state) == STATUS_INVALID)
+			error = clusters_local_error(state, i);
+			state->grid[i] = 0;
+			if (error)
 			{
-				state->grid[i] = d ? F_COLOR_0 : F_COLOR_1;
+				trail_set_char(trail, &state->grid[i], d ? F_COLOR_0 : F_COLOR_1);
 				ret++;
 				break;
 			}
-			else
-				state->grid[i] = 0;
 		}
 	}
 
 	return ret;
 }
 
-static int clusters_solve_game(game_state *state, int maxdiff, char *temp);
+static int clusters_solve_game(game_state *state, int maxdiff, int *diff,
+	struct trail *trail);
 
-static int clusters_solver_recurse(game_state *state, char *temp)
+#ifdef STANDALONE_SOLVER
+/* How often each technique made progress, reported by --stream */
+enum { USE_DIRECT, USE_PROBE, USECOUNT };
+static long solver_uses[USECOUNT];
+#define SOLVER_USED(t) (solver_uses[t]++)
+#else
+#define SOLVER_USED(t) ((void)0)
+#endif
+
+/*
+ * Normal and Hard: Colour a tile, and solve the grid from there at the
+ * next lower difficulty. If this leads to a contradiction, the tile
+ * takes the other colour. The trial is undone by rolling the trail back,
+ * and the nested solve makes its own trials on the same trail.
+ */
+static int clusters_solver_probe(game_state *state, int innerdiff, struct trail *trail)
 {
 	int s = state->w*state->h;
-	int i, d;
+	int i, d, mark;
 	int ret = 0, tempresult;
 
 	for (i = 0; i < s; i++)
@@ -412,13 +514,13 @@ static int clusters_solver_recurse(game_state *state, char *temp)
 		for (d = 0; d <= 1; d++)
 		{
 			/* See if this leads to an invalid state */
-			memcpy(temp, state->grid, s * sizeof(char));
-			state->grid[i] = d ? F_COLOR_1 : F_COLOR_0;
-			tempresult = clusters_solve_game(state, 0, temp);
-			memcpy(state->grid, temp, s * sizeof(char));
+			mark = trail_mark(trail);
+			trail_set_char(trail, &state->grid[i], d ? F_COLOR_1 : F_COLOR_0);
+			tempresult = clusters_solve_game(state, innerdiff, NULL, trail);
+			trail_rollback(trail, mark);
 			if (tempresult == STATUS_INVALID)
 			{
-				state->grid[i] = d ? F_COLOR_0 : F_COLOR_1;
+				trail_set_char(trail, &state->grid[i], d ? F_COLOR_0 : F_COLOR_1);
 				ret++;
 				break;
 			}
@@ -428,30 +530,49 @@ static int clusters_solver_recurse(game_state *state, char *temp)
 	return ret;
 }
 
-static int clusters_solve_game(game_state *state, int maxdiff, char *temp)
+/*
+ * Solve the grid using techniques up to maxdiff. If diff is not NULL,
+ * it receives the hardest technique which made progress. trail may be
+ * NULL, in which case one is made if the probes need it.
+ *
+ * The error flags set by clusters_validate are not put on the trail.
+ * They may be left behind on coloured tiles by a probe, but nothing
+ * reads them before the next validation sets them again.
+ */
+static int clusters_solve_game(game_state *state, int maxdiff, int *diff,
+	struct trail *trail)
 {
-	int s = state->w * state->h;
 	int ret = STATUS_UNFINISHED;
+	int d, used = DIFF_EASY;
 
-	char hastemp = temp != NULL;
-	if (!hastemp)
-		temp = snewn(s, char);
+	bool hastrail = trail != NULL;
+	if (!hastrail && maxdiff > DIFF_EASY)
+		trail = trail_new();
 
 	while ((ret = clusters_validate(state)) == STATUS_UNFINISHED)
 	{
-		if (clusters_solver_try(state))
+		if (clusters_solver_direct(state, trail))
+		{
+			SOLVER_USED(USE_DIRECT);
 			continue;
+		}
 
-		if (maxdiff < 1) break;
-
-		if (clusters_solver_recurse(state, temp))
-			continue;
+		for (d = DIFF_EASY + 1; d <= maxdiff; d++)
+		{
+			if (clusters_solver_probe(state, d - 1, trail))
+				break;
+		}
+		if (d > maxdiff)
+			break;
+		SOLVER_USED(USE_PROBE);
 
-		break;
+		used = max(used, d);
 	}
 
-	if (!hastemp)
-		sfree(temp);
+	if (diff)
+		*diff = used;
+	if (!hastrail)
+		trail_free(trail);
 	return ret;
 }
 
@@ -462,7 +583,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	char *ret = NULL;
 	int result;
 
-	clusters_solve_game(solved, 1, NULL);
+	clusters_solve_game(solved, DIFFCOUNT - 1, NULL, NULL);
 
 	result = clusters_validate(solved);
 
@@ -491,7 +612,13 @@ static char *solve_game(const game_state *state, const game_state *currstate,
  * Generator *
  * ********* */
 
-static int clusters_generate(game_state *state, char *temp, random_state *rs, bool force)
+#ifdef STANDALONE_SOLVER
+/* Generator attempts, reported by --generate */
+static long gen_attempts;
+#endif
+
+static int clusters_generate(game_state *state, char *temp, random_state *rs, bool force,
+	int maxdiff, int *diff)
 {
 	int w = state->w;
 	int h = state->h;
@@ -559,10 +686,15 @@ static int clusters_generate(game_state *state, char *temp, random_state *rs, bo
 		}
 	}
 	
-	return clusters_solve_game(state, 1, temp);
+	return clusters_solve_game(state, maxdiff, diff, NULL);
 }
 
 #define MAX_ATTEMPTS 100
+/*
+ * Boards rejected for being too easy before an easier one is accepted.
+ * Some small boards cannot be anything but Easy.
+ */
+#define MAX_EASY_BOARDS 1000
 static char *new_game_desc(const game_params *params, random_state *rs,
 			   char **aux, bool interactive)
 {
@@ -572,8 +704,9 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	game_state *state = snew(game_state);
 	char *ret, *p;
 	char *temp = snewn(w*h, char);
-	int run, i, attempts = 0;
+	int run, i, diff, result, attempts = 0, easy = 0;
 	bool force = false;
+	struct gen_deadline dl;
 
 	state->w = w;
 	state->h = h;
@@ -582,11 +715,28 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	state->grid = snewn(w*h, char);
 	memset(state->grid, 0, w*h * sizeof(char));
 	
-	while(clusters_generate(state, temp, rs, force) != STATUS_COMPLETE)
+	gen_deadline_start(&dl, GEN_BUDGET);
+
+	/* Boards which can be solved at a lower difficulty are rejected */
+	while((result = clusters_generate(state, temp, rs, force, params->diff, &diff)) != STATUS_COMPLETE
+		|| diff < params->diff)
 	{
 		attempts++;
 		force = (attempts % MAX_ATTEMPTS == 0);
+		if(result == STATUS_COMPLETE)
+		{
+			if(++easy >= MAX_EASY_BOARDS && !dl.fallback)
+				dl.fallback = "lower difficulty";
+			if(dl.fallback || gen_deadline_fallback(&dl, "lower difficulty"))
+				break;
+			/* A board which was too easy is solved, so start again from scratch */
+			force = true;
+		}
 	}
+	GEN_REPORT(&dl);
+#ifdef STANDALONE_SOLVER
+	gen_attempts = attempts + 1;
+#endif
 
 	/* Encode description */
 	ret = snewn(s + 1, char);
@@ -1159,3 +1309,210 @@ const struct game thegame = {
 	false, game_timing_state,
 	REQUIRE_RBUTTON, /* flags */
 };
+
+#ifdef STANDALONE_SOLVER
+#include <time.h>
+
+#include "genbatch.h"
+#include "solvestream.h"
+
+const char *quis;
+
+static void usage_exit(const char *msg)
+{
+	if (msg)
+		fprintf(stderr, "%s: %s\n", quis, msg);
+	fprintf(stderr,
+			"Usage: %s [--seed SEED] [--bench COUNT] [--generate COUNT] [--stream] <params> | [game_id [game_id ...]]\n",
+			quis);
+	exit(1);
+}
+
+/*
+ * Generate a number of puzzles, and report how long it takes and which
+ * difficulty each of them needs to be solved.
+ */
+static void clusters_bench(game_params *params, random_state *rs, int count)
+{
+	char *desc, *aux;
+	game_state *state;
+	clock_t start, total = 0;
+	int i, diff, grades[DIFFCOUNT];
+
+	memset(grades, 0, sizeof(grades));
+	for(i = 0; i < count; i++)
+	{
+		start = clock();
+		desc = new_game_desc(params, rs, &aux, false);
+		total += clock() - start;
+
+		state = new_game(NULL, params, desc);
+		clusters_solve_game(state, DIFFCOUNT - 1, &diff, NULL);
+		grades[diff]++;
+
+		free_game(state);
+		sfree(desc);
+	}
+
+	printf("Generation: %.2f ms per puzzle\n", total * 1000.0 / CLOCKS_PER_SEC / count);
+	for(i = 0; i < DIFFCOUNT; i++)
+		printf("%s: %d\n", clusters_diffnames[i], grades[i]);
+}
+
+/* The difficulty needed to solve a generated puzzle, for --generate */
+static const char *clusters_grade(const game_params *params, const char *desc)
+{
+	game_state *state = new_game(NULL, params, desc);
+	int diff, result;
+
+	result = clusters_solve_game(state, DIFFCOUNT - 1, &diff, NULL);
+	free_game(state);
+	return result == STATUS_COMPLETE ? clusters_diffnames[diff] : "Unsolved";
+}
+
+static const char *const clusters_usenames[] = { "direct", "probe" };
+
+/* Solve one puzzle for --stream, using the trail in ctx */
+static void clusters_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+	struct trail *trail = ctx;
+	int diff, result, mark = trail_mark(trail);
+
+	memset(solver_uses, 0, sizeof(solver_uses));
+	result = clusters_solve_game(state, DIFFCOUNT - 1, &diff, trail);
+	trail_commit(trail, mark);
+
+	if (result == STATUS_COMPLETE)
+	{
+		res->status = "Solved";
+		res->diff = clusters_diffnames[diff];
+	}
+	else if (result == STATUS_INVALID)
+		res->status = "Invalid";
+	solvestream_counts(res, clusters_usenames, solver_uses, USECOUNT);
+}
+
+int main(int argc, char *argv[])
+{
+	random_state *rs;
+	time_t seed = time(NULL);
+	int bench = 0, generate = 0;
+	bool stream = false;
+
+	game_params *params = NULL;
+
+	char *id = NULL, *desc = NULL;
+	const char *err;
+
+	quis = argv[0];
+
+	while (--argc > 0) {
+		char *p = *++argv;
+		if (!strcmp(p, "--seed")) {
+			if (argc == 0)
+				usage_exit("--seed needs an argument");
+			seed = (time_t) atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--bench")) {
+			if (argc == 0)
+				usage_exit("--bench needs an argument");
+			bench = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--generate")) {
+			if (argc == 0)
+				usage_exit("--generate needs an argument");
+			generate = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--params")) {
+			if (argc == 0)
+				usage_exit("--params needs an argument");
+			id = *++argv;
+			argc--;
+		} else if (!strcmp(p, "--stream"))
+			stream = true;
+		else if (*p == '-')
+			usage_exit("unrecognised option");
+		else
+			id = p;
+	}
+
+	if (id) {
+		desc = strchr(id, ':');
+		if (desc)
+			*desc++ = '\0';
+
+		params = default_params();
+		decode_params(params, id);
+		err = validate_params(params, desc == NULL);
+		if (err) {
+			fprintf(stderr, "Parameters are invalid\n");
+			fprintf(stderr, "%s: %s", argv[0], err);
+			exit(1);
+		}
+	}
+
+	if (stream) {
+		struct trail *trail;
+		if (id)
+			usage_exit("--stream reads game IDs from stdin");
+		trail = trail_new();
+		solvestream_run(stdin, clusters_stream_solve, trail);
+		trail_free(trail);
+	} else if (generate) {
+		if (desc)
+			usage_exit("--generate needs parameters, not a game ID");
+		if (!params)
+			params = default_params();
+		genbatch_run(params, (unsigned long)seed, generate, &gen_attempts, clusters_grade);
+	} else if (bench) {
+		rs = random_new((void *) &seed, sizeof(time_t));
+		if (!params)
+			params = default_params();
+		printf("Generating %d puzzles with parameters %s\n", bench,
+			   encode_params(params, true));
+		clusters_bench(params, rs, bench);
+	} else if (!desc) {
+		char *desc_gen, *aux;
+		rs = random_new((void *) &seed, sizeof(time_t));
+		if (!params)
+			params = default_params();
+		printf("Generating puzzle with parameters %s\n",
+			   encode_params(params, true));
+		desc_gen = new_game_desc(params, rs, &aux, false);
+
+		char *fmt = game_text_format(new_game(NULL, params, desc_gen));
+		fputs(fmt, stdout);
+		sfree(fmt);
+
+		printf("Game ID: %s\n", desc_gen);
+	} else {
+		game_state *input;
+		int diff, result;
+
+		err = validate_desc(params, desc);
+		if (err) {
+			fprintf(stderr, "Description is invalid\n");
+			fprintf(stderr, "%s", err);
+			exit(1);
+		}
+
+		input = new_game(NULL, params, desc);
+
+		result = clusters_solve_game(input, DIFFCOUNT - 1, &diff, NULL);
+
+		char *fmt = game_text_format(input);
+		fputs(fmt, stdout);
+		sfree(fmt);
+		if (result == STATUS_INVALID)
+			printf("Puzzle is invalid.\n");
+		else if (result == STATUS_UNFINISHED)
+			printf("No solution found.\n");
+		else
+			printf("Difficulty: %s\n", clusters_diffnames[diff]);
+
+		free_game(input);
+	}
+
+	return 0;
+}
+#endif
@@ -538,8 +538,35 @@ struct crossing_solver {
 	int runcount;
 	struct crossing_run *runs;
 	int *done;
+	
+	/*
+	 * The runs and numbers form a bipartite graph, with an edge between
+	 * a run and each number which still fits in it. The numbers for run i
+	 * are cands[candstart[i]] onwards, candcount[i] of them. An edge is
+	 * only ever removed, by swapping it with the last one of its run.
+	 */
+	int numcount;
+	int *numlen;
+	int *cands, *candstart, *candcount;
+	
+	/* A matching of runs to numbers, kept between passes, or -1 */
+	int *runmatch, *nummatch;
+	
+	/* Scratch for augmenting paths and strongly connected components */
+	bool *seen, *onstack;
+	int *index, *lowlink, *comp, *stack;
+	int counter, sp;
 };
 
+#ifdef STANDALONE_SOLVER
+/* How often each technique made progress, reported by --stream */
+enum { USE_MARKS, USE_MATCHING, USECOUNT };
+static long solver_uses[USECOUNT];
+#define SOLVER_USED(t) (solver_uses[t]++)
+#else
+#define SOLVER_USED(t) ((void)0)
+#endif
+
 static int crossing_collect_runs(struct crossing_puzzle *puzzle, struct crossing_run *runs)
 {
 	int w = puzzle->w;
@@ -629,7 +656,7 @@ static struct crossing_solver *crossing_solver_init(game_state *state)
 {
 	int w = state->puzzle->w;
 	int h = state->puzzle->h;
-	int i, ts;
+	int i, l, n, ts, rc;
 	for(i = 0; i < w*h; i++)
 	{
 		if(state->puzzle->walls[i])
@@ -647,6 +674,51 @@ static struct crossing_solver *crossing_solver_init(game_state *state)
 	memset(ret->done, 0, ts * sizeof(int));
 	
 	ret->runcount = crossing_collect_runs(state->puzzle, ret->runs);
+	rc = ret->runcount;
+	
+	/* Start with an edge between each run and every number of its length */
+	ret->numcount = ts;
+	ret->numlen = snewn(ts, int);
+	for(l = 0; l < ts; l++)
+		ret->numlen[l] = strlen(state->puzzle->numbers[l]);
+	
+	ret->candstart = snewn(rc, int);
+	ret->candcount = snewn(rc, int);
+	n = 0;
+	for(i = 0; i < rc; i++)
+	{
+		ret->candstart[i] = n;
+		for(l = 0; l < ts; l++)
+		{
+			if(ret->numlen[l] == ret->runs[i].len)
+				n++;
+		}
+		ret->candcount[i] = n - ret->candstart[i];
+	}
+	ret->cands = snewn(max(n, 1), int);
+	for(i = 0; i < rc; i++)
+	{
+		n = ret->candstart[i];
+		for(l = 0; l < ts; l++)
+		{
+			if(ret->numlen[l] == ret->runs[i].len)
+				ret->cands[n++] = l;
+		}
+	}
+	
+	ret->runmatch = snewn(max(rc, 1), int);
+	ret->nummatch = snewn(max(ts, 1), int);
+	for(i = 0; i < rc; i++)
+		ret->runmatch[i] = -1;
+	for(l = 0; l < ts; l++)
+		ret->nummatch[l] = -1;
+	
+	ret->seen = snewn(max(ts, 1), bool);
+	ret->onstack = snewn(max(rc, 1), bool);
+	ret->index = snewn(max(rc, 1), int);
+	ret->lowlink = snewn(max(rc, 1), int);
+	ret->comp = snewn(max(rc, 1), int);
+	ret->stack = snewn(max(rc, 1), int);
 	
 	return ret;
 }
@@ -655,9 +727,35 @@ static void free_solver(struct crossing_solver *solver)
 {
 	sfree(solver->runs);
 	sfree(solver->done);
+	sfree(solver->numlen);
+	sfree(solver->cands);
+	sfree(solver->candstart);
+	sfree(solver->candcount);
+	sfree(solver->runmatch);
+	sfree(solver->nummatch);
+	sfree(solver->seen);
+	sfree(solver->onstack);
+	sfree(solver->index);
+	sfree(solver->lowlink);
+	sfree(solver->comp);
+	sfree(solver->stack);
 	sfree(solver);
 }
 
+/* Remove the c'th edge of run i, breaking up the matching if it used it */
+static void crossing_remove_cand(struct crossing_solver *solver, int i, int c)
+{
+	int *cands = solver->cands + solver->candstart[i];
+	int l = cands[c];
+	
+	if(solver->runmatch[i] == l)
+	{
+		solver->runmatch[i] = -1;
+		solver->nummatch[l] = -1;
+	}
+	cands[c] = cands[--solver->candcount[i]];
+}
+
 enum { STATUS_VALID, STATUS_INVALID, STATUS_PROGRESS };
 
 static void crossing_iterate(struct crossing_run *run, int w, int *s, int *e, int *d)
@@ -695,14 +793,10 @@ static int crossing_validate(const game_state *state, int runcount, struct cross
 		runcount = crossing_collect_runs(state->puzzle, runs);
 	}
 	if(!hasdone)
-	{
-		int ts = state->puzzle->numcount;
-		done = snewn(ts, int);
-		memset(done, 0, ts);
-	}
+		done = snewn(state->puzzle->numcount, int);
 	
-	if(done)
-		memset(done, 0, runcount*sizeof(int));
+	/* done counts the runs holding each number */
+	memset(done, 0, state->puzzle->numcount*sizeof(int));
 	if(runerrs)
 		memset(runerrs, false, runcount*sizeof(char));
 	
@@ -748,7 +842,7 @@ static int crossing_validate(const game_state *state, int runcount, struct cross
 	
 	if(status != STATUS_INVALID)
 	{
-		for(i = 0; i < runcount; i++)
+		for(i = 0; i < state->puzzle->numcount; i++)
 		{
 			if(done[i] > 1)
 			{
@@ -768,11 +862,15 @@ static int crossing_validate(const game_state *state, int runcount, struct cross
 	return status;
 }
 
+/*
+ * Remove each number from the runs it no longer fits in, and rule out
+ * every digit which none of the numbers left for a run can put there.
+ */
 static int crossing_solver_marks(game_state *state, struct crossing_solver *solver)
 {
 	int marks[9];
 	int ret = 0;
-	int i, j, k, l, len;
+	int i, j, k, l, c, len;
 	int w = state->puzzle->w;
 	int s, e, d;
 	char n;
@@ -786,11 +884,10 @@ static int crossing_solver_marks(game_state *state, struct crossing_solver *solv
 		
 		memset(marks, 0, len*sizeof(int));	
 		
-		for (l = 0; l < state->puzzle->numcount; l++)
+		for (c = 0; c < solver->candcount[i]; c++)
 		{
+			l = solver->cands[solver->candstart[i] + c];
 			num = state->puzzle->numbers[l];
-			if(solver->done[l]) continue;
-			if(strlen(num) != len) continue;
 			
 			match = true;
 			for(j = s, k = 0; j < e; j += d, k++)
@@ -800,7 +897,12 @@ static int crossing_solver_marks(game_state *state, struct crossing_solver *solv
 					match = false;
 			}
 			
-			if(!match) continue;
+			if(!match)
+			{
+				crossing_remove_cand(solver, i, c--);
+				continue;
+			}
+			if(solver->done[l]) continue;
 			
 			for(k = 0; k < len; k++)
 			{
@@ -837,7 +939,7 @@ static int crossing_solver_confirm(game_state *state)
 		if(state->grid[i])
 			continue;
 		
-		for(j = 0; j <= 9; j++)
+		for(j = 1; j <= 9; j++)
 		{
 			if(state->marks[i] == NUM_BIT(j))
 			{
@@ -850,6 +952,127 @@ static int crossing_solver_confirm(game_state *state)
 	return ret;
 }
 
+/* Look for an augmenting path from run i, using the numbers not yet seen */
+static bool crossing_augment(struct crossing_solver *solver, int i)
+{
+	int *cands = solver->cands + solver->candstart[i];
+	int c, l;
+	
+	for(c = 0; c < solver->candcount[i]; c++)
+	{
+		l = cands[c];
+		if(solver->seen[l])
+			continue;
+		solver->seen[l] = true;
+		
+		if(solver->nummatch[l] < 0 || crossing_augment(solver, solver->nummatch[l]))
+		{
+			solver->runmatch[i] = l;
+			solver->nummatch[l] = i;
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+/*
+ * Tarjan's algorithm on the runs. Following an edge from run i to a
+ * number it is not matched with, and from there to the run which is
+ * matched with that number, gives an edge between two runs.
+ */
+static void crossing_scc(struct crossing_solver *solver, int i)
+{
+	int *cands = solver->cands + solver->candstart[i];
+	int c, j;
+	
+	solver->index[i] = solver->lowlink[i] = solver->counter++;
+	solver->stack[solver->sp++] = i;
+	solver->onstack[i] = true;
+	
+	for(c = 0; c < solver->candcount[i]; c++)
+	{
+		if(cands[c] == solver->runmatch[i])
+			continue;
+		j = solver->nummatch[cands[c]];
+		if(solver->index[j] < 0)
+		{
+			crossing_scc(solver, j);
+			solver->lowlink[i] = min(solver->lowlink[i], solver->lowlink[j]);
+		}
+		else if(solver->onstack[j])
+			solver->lowlink[i] = min(solver->lowlink[i], solver->index[j]);
+	}
+	
+	if(solver->lowlink[i] == solver->index[i])
+	{
+		do
+		{
+			j = solver->stack[--solver->sp];
+			solver->onstack[j] = false;
+			solver->comp[j] = i;
+		} while(j != i);
+	}
+}
+
+/*
+ * Every number goes in exactly one run, so a solution is a perfect
+ * matching between them. Keep such a matching, mending it where the
+ * last passes took away its edges, and remove every edge which no
+ * perfect matching can use. An edge outside the matching is in some
+ * other perfect matching exactly when it lies on an alternating cycle,
+ * which is when both its runs are in the same strongly connected
+ * component. Returns the number of edges removed, or -1 if there is
+ * no perfect matching.
+ */
+static int crossing_solver_matching(struct crossing_solver *solver)
+{
+	int rc = solver->runcount;
+	int i, c, l, ret = 0;
+	int *cands;
+	
+	if(rc != solver->numcount)
+		return 0;
+	
+	for(i = 0; i < rc; i++)
+	{
+		if(solver->runmatch[i] >= 0)
+			continue;
+		memset(solver->seen, 0, solver->numcount * sizeof(bool));
+		if(!crossing_augment(solver, i))
+			return -1;
+	}
+	
+	for(i = 0; i < rc; i++)
+	{
+		solver->index[i] = -1;
+		solver->onstack[i] = false;
+	}
+	solver->counter = solver->sp = 0;
+	for(i = 0; i < rc; i++)
+	{
+		if(solver->index[i] < 0)
+			crossing_scc(solver, i);
+	}
+	
+	for(i = 0; i < rc; i++)
+	{
+		cands = solver->cands + solver->candstart[i];
+		for(c = 0; c < solver->candcount[i]; c++)
+		{
+			l = cands[c];
+			if(l != solver->runmatch[i] &&
+					solver->comp[solver->nummatch[l]] != solver->comp[i])
+			{
+				crossing_remove_cand(solver, i, c--);
+				ret++;
+			}
+		}
+	}
+	
+	return ret;
+}
+
 static int crossing_solve_game(game_state *state)
 {
 	struct crossing_solver *solver = crossing_solver_init(state);
@@ -867,9 +1090,23 @@ static int crossing_solve_game(game_state *state)
 		done += crossing_solver_confirm(state);
 		
 		if(done)
+		{
+			SOLVER_USED(USE_MARKS);
+			continue;
+		}
+		
+		done = crossing_solver_matching(solver);
+		if(done < 0)
+		{
+			status = STATUS_INVALID;
+			break;
+		}
+		if(done)
+		{
+			SOLVER_USED(USE_MATCHING);
 			continue;
+		}
 		
-		// TODO harder techniques?
 		break;
 	}
 	
@@ -1119,6 +1356,11 @@ static bool crossing_generate(struct crossing_puzzle *puzzle, random_state *rs,
 	return crossing_gen_solve(puzzle);
 }
 
+#ifdef STANDALONE_SOLVER
+/* Generator attempts, reported by --generate */
+static long gen_attempts;
+#endif
+
 static char *new_game_desc(const game_params *params, random_state *rs,
 			   char **aux, bool interactive)
 {
@@ -1132,6 +1374,9 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	
 	do
 	{
+#ifdef STANDALONE_SOLVER
+		gen_attempts++;
+#endif
 		success = crossing_generate(puzzle, rs, params);
 		if(!success)
 		{
@@ -1932,6 +2177,9 @@ const struct game thegame = {
 #include <time.h>
 #include <stdarg.h>
 
+#include "genbatch.h"
+#include "solvestream.h"
+
 /* Most of the standalone solver code was copied from unequal.c and singles.c */
 
 const char *quis;
@@ -1941,15 +2189,46 @@ static void usage_exit(const char *msg)
 	if (msg)
 		fprintf(stderr, "%s: %s\n", quis, msg);
 	fprintf(stderr,
-			"Usage: %s [-v] [--seed SEED] <params> | [game_id [game_id ...]]\n",
+			"Usage: %s [-v] [--seed SEED] [--generate COUNT] [--stream] <params> | [game_id [game_id ...]]\n",
 			quis);
 	exit(1);
 }
 
+/*
+ * Whether the solver can finish a generated puzzle, for --generate.
+ * Crossing has no difficulty levels.
+ */
+static const char *crossing_grade(const game_params *params, const char *desc)
+{
+	game_state *state = new_game(NULL, params, desc);
+	int status = crossing_solve_game(state);
+
+	free_game(state);
+	return status == STATUS_VALID ? "Solved" : "Unsolved";
+}
+
+static const char *const crossing_usenames[] = { "marks", "matching" };
+
+/* Solve one puzzle for --stream. Crossing has no difficulty levels. */
+static void crossing_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+	int status;
+
+	memset(solver_uses, 0, sizeof(solver_uses));
+	status = crossing_solve_game(state);
+	if(status == STATUS_VALID)
+		res->status = "Solved";
+	else if(status == STATUS_INVALID)
+		res->status = "Invalid";
+	solvestream_counts(res, crossing_usenames, solver_uses, USECOUNT);
+}
+
 int main(int argc, char *argv[])
 {
 	random_state *rs;
 	time_t seed = time(NULL);
+	int generate = 0;
+	bool stream = false;
 
 	game_params *params = NULL;
 
@@ -1965,7 +2244,19 @@ int main(int argc, char *argv[])
 				usage_exit("--seed needs an argument");
 			seed = (time_t) atoi(*++argv);
 			argc--;
-		} else if (!strcmp(p, "-v"))
+		} else if (!strcmp(p, "--generate")) {
+			if (argc == 0)
+				usage_exit("--generate needs an argument");
+			generate = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--params")) {
+			if (argc == 0)
+				usage_exit("--params needs an argument");
+			id = *++argv;
+			argc--;
+		} else if (!strcmp(p, "--stream"))
+			stream = true;
+		else if (!strcmp(p, "-v"))
 			solver_verbose = true;
 		else if (*p == '-')
 			usage_exit("unrecognised option");
@@ -1988,7 +2279,18 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	if (!desc) {
+	if (stream) {
+		if (id)
+			usage_exit("--stream reads game IDs from stdin");
+		solvestream_run(stdin, crossing_stream_solve, NULL);
+	} else if (generate) {
+		if (desc)
+			usage_exit("--generate needs parameters, not a game ID");
+		if (!params)
+			params = default_params();
+		genbatch_run(params, (unsigned long)seed, generate, &gen_attempts,
+			crossing_grade);
+	} else if (!desc) {
 		char *desc_gen, *aux;
 		rs = random_new((void *) &seed, sizeof(time_t));
 		if (!params)
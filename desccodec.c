@@ -0,0 +1,133 @@
+/*
+ * desccodec.c: Compact binary encoding of game descriptions.
+ * See LICENCE for licence details
+ *
+ * Text descriptions are meant to be typed and pasted. For corpora of
+ * many puzzles, a game can also write its description as a bit stream:
+ * a few varints holding the parameters, then each cell in as few bits
+ * as its range of values needs. Reading this back skips the parsing of
+ * run lengths and clue numbers, and gives a state directly.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "puzzles.h"
+#include "desccodec.h"
+
+void desc_writer_init(struct desc_writer *dw)
+{
+	dw->data = NULL;
+	dw->nbits = dw->size = 0;
+}
+
+void desc_put_bits(struct desc_writer *dw, unsigned int value, int nbits)
+{
+	int byte, shift, n;
+
+	assert(nbits >= 0 && nbits <= 32);
+	if((dw->nbits + nbits + 7) / 8 > dw->size)
+	{
+		dw->size = dw->size * 2 + 16;
+		dw->data = sresize(dw->data, dw->size, unsigned char);
+	}
+
+	while(nbits > 0)
+	{
+		byte = dw->nbits / 8;
+		shift = dw->nbits % 8;
+		if(!shift)
+			dw->data[byte] = 0;
+		n = min(8 - shift, nbits);
+		dw->data[byte] |= (value & ((1U << n) - 1)) << shift;
+		value >>= n;
+		nbits -= n;
+		dw->nbits += n;
+	}
+}
+
+void desc_put_varint(struct desc_writer *dw, unsigned int value)
+{
+	while(value >= 0x80)
+	{
+		desc_put_bits(dw, (value & 0x7F) | 0x80, 8);
+		value >>= 7;
+	}
+	desc_put_bits(dw, value, 8);
+}
+
+int desc_writer_len(const struct desc_writer *dw)
+{
+	return (dw->nbits + 7) / 8;
+}
+
+void desc_reader_init(struct desc_reader *dr, const unsigned char *data, int len)
+{
+	dr->data = data;
+	dr->nbits = len * 8;
+	dr->pos = 0;
+	dr->error = false;
+}
+
+unsigned int desc_get_bits(struct desc_reader *dr, int nbits)
+{
+	const unsigned char *p;
+	unsigned long long acc = 0;
+	int shift, nbytes, i;
+
+	if(dr->pos + nbits > dr->nbits)
+	{
+		dr->error = true;
+		dr->pos = dr->nbits;
+		return 0;
+	}
+
+	/* Gather the bytes holding these bits, at most 5 of them */
+	p = dr->data + dr->pos / 8;
+	shift = dr->pos % 8;
+	nbytes = (shift + nbits + 7) / 8;
+	for(i = 0; i < nbytes; i++)
+		acc |= (unsigned long long)p[i] << (8 * i);
+	dr->pos += nbits;
+
+	return (unsigned int)((acc >> shift) & ((1ULL << nbits) - 1));
+}
+
+unsigned int desc_get_varint(struct desc_reader *dr)
+{
+	unsigned int ret = 0, b;
+	int shift = 0;
+
+	do
+	{
+		b = desc_get_bits(dr, 8);
+		if(shift > 28)
+			dr->error = true;
+		if(dr->error)
+			return 0;
+		ret |= (b & 0x7F) << shift;
+		shift += 7;
+	} while(b & 0x80);
+
+	return ret;
+}
+
+bool desc_need_bits(struct desc_reader *dr, double nbits)
+{
+	if(dr->error || nbits > dr->nbits - dr->pos)
+		dr->error = true;
+	return !dr->error;
+}
+
+int desc_bits_for(unsigned int max)
+{
+	int ret = 0;
+	while(max)
+	{
+		ret++;
+		max >>= 1;
+	}
+	return ret;
+}
@@ -0,0 +1,66 @@
+/*
+ * desccodec.h: Compact binary encoding of game descriptions.
+ * See LICENCE for licence details
+ */
+
+#ifndef PUZZLES_DESCCODEC_H
+#define PUZZLES_DESCCODEC_H
+
+#include "puzzles.h"
+
+#define DESCCODEC_VERSION 1
+
+/*
+ * Bits are packed least significant first. Varints are written through
+ * the same bit stream, in groups of 7 bits with a continuation bit.
+ */
+struct desc_writer {
+	unsigned char *data;
+	int nbits, size;
+};
+
+struct desc_reader {
+	const unsigned char *data;
+	int nbits, pos;
+
+	/* Set when reading past the end, or by a codec on a bad value */
+	bool error;
+};
+
+void desc_writer_init(struct desc_writer *dw);
+void desc_put_bits(struct desc_writer *dw, unsigned int value, int nbits);
+void desc_put_varint(struct desc_writer *dw, unsigned int value);
+/* Number of bytes written, padded with zero bits */
+int desc_writer_len(const struct desc_writer *dw);
+
+void desc_reader_init(struct desc_reader *dr, const unsigned char *data, int len);
+unsigned int desc_get_bits(struct desc_reader *dr, int nbits);
+unsigned int desc_get_varint(struct desc_reader *dr);
+/*
+ * Check that at least nbits are left, and set the error flag if not.
+ * Codecs call this before allocating a state whose size they have just
+ * read, so that a damaged record can't ask for a huge grid.
+ */
+bool desc_need_bits(struct desc_reader *dr, double nbits);
+
+/* Number of bits needed to hold any value from 0 to max */
+int desc_bits_for(unsigned int max);
+
+/*
+ * A game which supports the binary encoding defines thecodec when
+ * compiled with DESC_CODEC. pack writes the parameters the description
+ * depends on as varints, followed by the cell contents. unpack reads
+ * them back into a new state, and returns NULL if the data is cut short
+ * or holds a value out of range; it does not replace validate_desc.
+ * encode returns the text description of a state, exactly as
+ * new_game_desc would have written it.
+ */
+struct desc_codec {
+	void (*pack)(const game_state *state, struct desc_writer *dw);
+	game_state *(*unpack)(struct desc_reader *dr, game_params **params);
+	char *(*encode)(const game_state *state);
+};
+
+extern const struct desc_codec thecodec;
+
+#endif
@@ -0,0 +1,395 @@
+/*
+ * descpool.c: On-disk pools of pre-generated game descriptions.
+ * See LICENCE for licence details
+ *
+ * Some generators can take several seconds for large or difficult
+ * parameters. A pool holds descriptions generated ahead of time, one
+ * file per game and parameter string, so that these puzzles can be
+ * handed out immediately.
+ *
+ * Pool files are plain text, so they can be built offline and copied
+ * around. The first line is a header:
+ *
+ *   puzzles-descpool <version> <game> <nextseed> <params>
+ *
+ * Every following line is one entry:
+ *
+ *   <checksum> <seed> <desc>
+ *
+ * where the checksum is an 8-digit hex FNV-1a hash of the parameters,
+ * seed and description. Entries which fail the checksum are ignored.
+ *
+ * Numeric seeds are never reused. nextseed is above every seed which
+ * was ever in the pool, including those of entries already taken, and
+ * is brought up to date whenever the pool is rewritten. Version 1 pools
+ * have no nextseed, and are upgraded by the next take.
+ *
+ * On POSIX systems, adding and taking entries hold a lock on a separate
+ * <pool>.lock file, so that an entry added while another process takes
+ * one is not lost when the pool is rewritten.
+ */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _DEFAULT_SOURCE
+#define DESCPOOL_LOCKING
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ctype.h>
+
+#ifdef DESCPOOL_LOCKING
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "puzzles.h"
+#include "descpool.h"
+
+const char *descpool_dir = NULL;
+
+static unsigned long descpool_hash(unsigned long h, const char *s)
+{
+	for(; *s; s++)
+	{
+		h ^= (unsigned char)*s;
+		h = (h * 16777619UL) & 0xFFFFFFFFUL;
+	}
+	return h;
+}
+
+unsigned long descpool_checksum(const char *params, const char *seed, const char *desc)
+{
+	unsigned long h = 2166136261UL;
+
+	h = descpool_hash(h, params);
+	h = descpool_hash(h, " ");
+	h = descpool_hash(h, seed);
+	h = descpool_hash(h, " ");
+	h = descpool_hash(h, desc);
+
+	return h;
+}
+
+char *descpool_filename(const char *game, const char *params)
+{
+	char *ret, *p;
+	const char *q;
+
+	if(!descpool_dir)
+		descpool_dir = getenv("PUZZLES_DESCPOOL_DIR");
+	if(!descpool_dir || !*descpool_dir)
+		return NULL;
+
+	ret = snewn(strlen(descpool_dir) + strlen(game) + strlen(params) + 8, char);
+	p = ret + sprintf(ret, "%s/", descpool_dir);
+
+	/* Game names and parameters are reduced to safe file name characters */
+	for(q = game; *q; q++)
+	{
+		if(isalnum((unsigned char)*q))
+			*p++ = tolower((unsigned char)*q);
+	}
+	*p++ = '-';
+	for(q = params; *q; q++)
+		*p++ = isalnum((unsigned char)*q) ? *q : '_';
+	strcpy(p, ".pool");
+
+	return ret;
+}
+
+/*
+ * Wait for the lock on a pool. Returns false if the lock file cannot be
+ * created, in which case the pool cannot be written either.
+ */
+static bool descpool_lock(const char *filename, int *fd)
+{
+#ifdef DESCPOOL_LOCKING
+	char *lockname = snewn(strlen(filename) + 6, char);
+	struct flock fl;
+
+	sprintf(lockname, "%s.lock", filename);
+	*fd = open(lockname, O_RDWR | O_CREAT, 0666);
+	sfree(lockname);
+	if(*fd < 0)
+		return false;
+
+	memset(&fl, 0, sizeof(fl));
+	fl.l_type = F_WRLCK;
+	fl.l_whence = SEEK_SET;
+	if(fcntl(*fd, F_SETLKW, &fl) != 0)
+	{
+		close(*fd);
+		return false;
+	}
+#else
+	*fd = -1;
+#endif
+	return true;
+}
+
+static void descpool_unlock(int fd)
+{
+#ifdef DESCPOOL_LOCKING
+	/* Closing the file releases the lock */
+	close(fd);
+#endif
+}
+
+/* The seed after this one, if it is a number, or 0 */
+static unsigned long descpool_seed_after(const char *seed)
+{
+	char *end;
+	unsigned long n;
+
+	if(!isdigit((unsigned char)*seed))
+		return 0;
+	n = strtoul(seed, &end, 10);
+	return *end ? 0 : n + 1;
+}
+
+static char *descpool_chomp(char *line)
+{
+	int len = strlen(line);
+
+	while(len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
+		line[--len] = '\0';
+	return line;
+}
+
+struct descpool_entry *descpool_read(const char *filename, const char *params,
+	int *nentries, int *nbad, unsigned long *nextseed, const char **error)
+{
+	struct descpool_entry *ret = NULL;
+	int n = 0, size = 0;
+	int version;
+	char *line, *seed, *desc;
+	unsigned long checksum, next;
+	FILE *fp;
+
+	*nentries = *nbad = 0;
+	*nextseed = 0;
+	*error = NULL;
+
+	fp = fopen(filename, "r");
+	if(!fp)
+		return snewn(1, struct descpool_entry);
+
+	line = fgetline(fp);
+	if(!line || sscanf(line, "puzzles-descpool %d", &version) != 1)
+	{
+		*error = "File is not a description pool";
+		goto fail;
+	}
+	if(version != 1 && version != DESCPOOL_VERSION)
+	{
+		*error = "Description pool has an unsupported version";
+		goto fail;
+	}
+	/* The parameters are the last word of the header */
+	descpool_chomp(line);
+	seed = strrchr(line, ' ');
+	if(!seed || strcmp(seed+1, params))
+	{
+		*error = "Description pool is for different parameters";
+		goto fail;
+	}
+	/* and the next seed is the word before them */
+	if(version >= 2)
+	{
+		*seed = '\0';
+		seed = strrchr(line, ' ');
+		if(!seed)
+		{
+			*error = "File is not a description pool";
+			goto fail;
+		}
+		*nextseed = strtoul(seed+1, NULL, 10);
+	}
+	sfree(line);
+
+	while((line = fgetline(fp)) != NULL)
+	{
+		descpool_chomp(line);
+
+		checksum = strtoul(line, &seed, 16);
+		desc = NULL;
+		if(seed != line && *seed == ' ')
+			desc = strchr(++seed, ' ');
+		if(!desc)
+		{
+			(*nbad)++;
+			sfree(line);
+			continue;
+		}
+		*desc++ = '\0';
+
+		if(checksum != descpool_checksum(params, seed, desc))
+		{
+			(*nbad)++;
+			sfree(line);
+			continue;
+		}
+
+		if(n >= size)
+		{
+			size = size * 2 + 16;
+			ret = sresize(ret, size, struct descpool_entry);
+		}
+		ret[n].seed = dupstr(seed);
+		ret[n].desc = dupstr(desc);
+		n++;
+		next = descpool_seed_after(seed);
+		if(next > *nextseed)
+			*nextseed = next;
+		sfree(line);
+	}
+
+	fclose(fp);
+	*nentries = n;
+	return ret ? ret : snewn(1, struct descpool_entry);
+
+fail:
+	sfree(line);
+	fclose(fp);
+	return NULL;
+}
+
+void descpool_free_entries(struct descpool_entry *entries, int nentries)
+{
+	int i;
+
+	for(i = 0; i < nentries; i++)
+	{
+		sfree(entries[i].seed);
+		sfree(entries[i].desc);
+	}
+	sfree(entries);
+}
+
+static void descpool_write_header(FILE *fp, const char *game, const char *params,
+	unsigned long nextseed)
+{
+	fprintf(fp, "puzzles-descpool %d %s %lu %s\n", DESCPOOL_VERSION, game,
+		nextseed, params);
+}
+
+static void descpool_write_entry(FILE *fp, const char *params, const char *seed,
+	const char *desc)
+{
+	fprintf(fp, "%08lx %s %s\n", descpool_checksum(params, seed, desc), seed, desc);
+}
+
+bool descpool_add(const char *game, const char *params, const char *seed,
+	const char *desc)
+{
+	char *filename = descpool_filename(game, params);
+	const char *p;
+	FILE *fp;
+	bool exists;
+	int lock;
+
+	if(!filename)
+		return false;
+
+	/* Spaces and line breaks would corrupt the pool */
+	for(p = seed; *p; p++)
+		if(isspace((unsigned char)*p)) goto fail;
+	for(p = desc; *p; p++)
+		if(isspace((unsigned char)*p)) goto fail;
+
+	if(!descpool_lock(filename, &lock))
+		goto fail;
+
+	fp = fopen(filename, "r");
+	exists = fp != NULL;
+	if(fp)
+		fclose(fp);
+
+	fp = fopen(filename, "a");
+	if(!fp)
+	{
+		descpool_unlock(lock);
+		goto fail;
+	}
+	if(!exists)
+		descpool_write_header(fp, game, params, descpool_seed_after(seed));
+	descpool_write_entry(fp, params, seed, desc);
+	fclose(fp);
+	descpool_unlock(lock);
+
+	sfree(filename);
+	return true;
+
+fail:
+	sfree(filename);
+	return false;
+}
+
+char *descpool_take(const char *game, const game_params *params,
+	char *(*encode)(const game_params *, bool),
+	const char *(*validate)(const game_params *, const char *))
+{
+	char *key, *filename, *tmpname, *ret = NULL;
+	struct descpool_entry *entries;
+	int i, n, nbad, lock;
+	unsigned long nextseed;
+	const char *error;
+	FILE *fp;
+
+	key = encode(params, true);
+	filename = descpool_filename(game, key);
+	if(!filename)
+	{
+		sfree(key);
+		return NULL;
+	}
+
+	if(!descpool_lock(filename, &lock))
+	{
+		sfree(filename);
+		sfree(key);
+		return NULL;
+	}
+
+	entries = descpool_read(filename, key, &n, &nbad, &nextseed, &error);
+	if(!entries || n == 0)
+		goto done;
+
+	/* Skip entries which were built by an incompatible generator */
+	for(i = 0; i < n; i++)
+	{
+		if(!validate(params, entries[i].desc))
+			break;
+	}
+
+	/* Write the remaining entries to a new file, then replace the pool */
+	tmpname = snewn(strlen(filename) + 5, char);
+	sprintf(tmpname, "%s.tmp", filename);
+	fp = fopen(tmpname, "w");
+	if(fp)
+	{
+		int taken = i;
+		descpool_write_header(fp, game, key, nextseed);
+		for(i = taken + 1; i < n; i++)
+			descpool_write_entry(fp, key, entries[i].seed, entries[i].desc);
+		if(fclose(fp) == 0 && rename(tmpname, filename) == 0 && taken < n)
+		{
+			ret = entries[taken].desc;
+			entries[taken].desc = NULL;
+		}
+		else
+			remove(tmpname);
+	}
+	sfree(tmpname);
+
+done:
+	descpool_unlock(lock);
+	if(entries)
+		descpool_free_entries(entries, n);
+	sfree(filename);
+	sfree(key);
+	return ret;
+}
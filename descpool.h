@@ -0,0 +1,56 @@
+/*
+ * descpool.h: On-disk pools of pre-generated game descriptions.
+ * See LICENCE for licence details
+ */
+
+#ifndef PUZZLES_DESCPOOL_H
+#define PUZZLES_DESCPOOL_H
+
+#include "puzzles.h"
+
+#define DESCPOOL_VERSION 2
+
+/*
+ * Directory containing the pool files. Initialised from the
+ * PUZZLES_DESCPOOL_DIR environment variable on first use. If neither
+ * is set, pools are disabled and descpool_take always returns NULL.
+ */
+extern const char *descpool_dir;
+
+struct descpool_entry {
+	char *seed;
+	char *desc;
+};
+
+/* Checksum of one pool entry, as stored in the pool file */
+unsigned long descpool_checksum(const char *params, const char *seed, const char *desc);
+
+/* Pool file for a game and encode_params(params, true), or NULL if disabled */
+char *descpool_filename(const char *game, const char *params);
+
+/*
+ * Read all entries of a pool. Entries with a bad checksum are skipped
+ * and counted in *nbad. *nextseed is set above every numeric seed the
+ * pool has held, so that new entries do not repeat old ones. Returns
+ * NULL and sets *error if the file is not a pool for these parameters.
+ * A missing file is an empty pool.
+ */
+struct descpool_entry *descpool_read(const char *filename, const char *params,
+	int *nentries, int *nbad, unsigned long *nextseed, const char **error);
+void descpool_free_entries(struct descpool_entry *entries, int nentries);
+
+/* Append one entry to a pool, creating the file if necessary */
+bool descpool_add(const char *game, const char *params, const char *seed,
+	const char *desc);
+
+/*
+ * Remove the first entry from the pool for these parameters, and
+ * return its description if validate_desc accepts it. Entries which
+ * fail validation are dropped. Returns NULL if the pool is empty or
+ * disabled.
+ */
+char *descpool_take(const char *game, const game_params *params,
+	char *(*encode)(const game_params *, bool),
+	const char *(*validate)(const game_params *, const char *));
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * drawcount.c: Headless drawing backend which counts drawing calls
+ * instead of rendering anything.
+ * See LICENCE for licence details
+ *
+ * Every primitive is tallied by type. Calls to draw_update are clipped
+ * to the drawing area, and are recorded both as a plain sum of areas
+ * and as a bitmap of dirty pixels, so that overlapping updates can be
+ * told apart from large ones.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "puzzles.h"
+#include "drawcount.h"
+
+struct blitter {
+	int w, h;
+};
+
+struct drawcount *drawcount_new(void)
+{
+	struct drawcount *dc = snew(struct drawcount);
+
+	dc->w = dc->h = 0;
+	dc->dirty = NULL;
+	drawcount_reset(dc);
+
+	return dc;
+}
+
+void drawcount_free(struct drawcount *dc)
+{
+	sfree(dc->dirty);
+	sfree(dc);
+}
+
+void drawcount_set_size(struct drawcount *dc, int w, int h)
+{
+	dc->w = w;
+	dc->h = h;
+	sfree(dc->dirty);
+	dc->dirty = snewn(w*h, unsigned char);
+	drawcount_reset(dc);
+}
+
+void drawcount_reset(struct drawcount *dc)
+{
+	dc->texts = dc->rects = dc->lines = 0;
+	dc->polygons = dc->circles = dc->thicklines = 0;
+	dc->clips = dc->updates = dc->blits = 0;
+	dc->updatearea = dc->dirtypixels = 0;
+
+	if(dc->dirty)
+		memset(dc->dirty, 0, dc->w*dc->h*sizeof(unsigned char));
+}
+
+long drawcount_calls(const struct drawcount *dc)
+{
+	return dc->texts + dc->rects + dc->lines + dc->polygons +
+		dc->circles + dc->thicklines + dc->blits;
+}
+
+static void drawcount_draw_text(drawing *dr, int x, int y, int fonttype,
+	int fontsize, int align, int colour, const char *text)
+{
+	GET_HANDLE_AS_TYPE(dr, struct drawcount)->texts++;
+}
+
+static void drawcount_draw_rect(drawing *dr, int x, int y, int w, int h, int colour)
+{
+	GET_HANDLE_AS_TYPE(dr, struct drawcount)->rects++;
+}
+
+static void drawcount_draw_line(drawing *dr, int x1, int y1, int x2, int y2, int colour)
+{
+	GET_HANDLE_AS_TYPE(dr, struct drawcount)->lines++;
+}
+
+static void drawcount_draw_polygon(drawing *dr, const int *coords, int npoints,
+	int fillcolour, int outlinecolour)
+{
+	GET_HANDLE_AS_TYPE(dr, struct drawcount)->polygons++;
+}
+
+static void drawcount_draw_circle(drawing *dr, int cx, int cy, int radius,
+	int fillcolour, int outlinecolour)
+{
+	GET_HANDLE_AS_TYPE(dr, struct drawcount)->circles++;
+}
+
+static void drawcount_draw_thick_line(drawing *dr, float thickness,
+	float x1, float y1, float x2, float y2, int colour)
+{
+	GET_HANDLE_AS_TYPE(dr, struct drawcount)->thicklines++;
+}
+
+static void drawcount_draw_update(drawing *dr, int x, int y, int w, int h)
+{
+	struct drawcount *dc = GET_HANDLE_AS_TYPE(dr, struct drawcount);
+	int x2 = x + w, y2 = y + h;
+	int i, j;
+
+	dc->updates++;
+
+	if(x < 0) x = 0;
+	if(y < 0) y = 0;
+	if(x2 > dc->w) x2 = dc->w;
+	if(y2 > dc->h) y2 = dc->h;
+	if(x2 <= x || y2 <= y)
+		return;
+
+	dc->updatearea += (long)(x2 - x) * (y2 - y);
+
+	if(!dc->dirty)
+		return;
+	for(j = y; j < y2; j++)
+	for(i = x; i < x2; i++)
+	{
+		if(!dc->dirty[j*dc->w+i])
+		{
+			dc->dirty[j*dc->w+i] = 1;
+			dc->dirtypixels++;
+		}
+	}
+}
+
+static void drawcount_clip(drawing *dr, int x, int y, int w, int h)
+{
+	GET_HANDLE_AS_TYPE(dr, struct drawcount)->clips++;
+}
+
+static void drawcount_unclip(drawing *dr)
+{
+}
+
+static void drawcount_start_draw(drawing *dr)
+{
+}
+
+static void drawcount_end_draw(drawing *dr)
+{
+}
+
+static blitter *drawcount_blitter_new(drawing *dr, int w, int h)
+{
+	blitter *bl = snew(blitter);
+	bl->w = w;
+	bl->h = h;
+	return bl;
+}
+
+static void drawcount_blitter_free(drawing *dr, blitter *bl)
+{
+	sfree(bl);
+}
+
+static void drawcount_blitter_save(drawing *dr, blitter *bl, int x, int y)
+{
+	GET_HANDLE_AS_TYPE(dr, struct drawcount)->blits++;
+}
+
+static void drawcount_blitter_load(drawing *dr, blitter *bl, int x, int y)
+{
+	GET_HANDLE_AS_TYPE(dr, struct drawcount)->blits++;
+}
+
+const drawing_api drawcount_drawing = {
+	1,
+	drawcount_draw_text,
+	drawcount_draw_rect,
+	drawcount_draw_line,
+	drawcount_draw_polygon,
+	drawcount_draw_circle,
+	drawcount_draw_update,
+	drawcount_clip,
+	drawcount_unclip,
+	drawcount_start_draw,
+	drawcount_end_draw,
+	NULL, /* status_bar */
+	drawcount_blitter_new,
+	drawcount_blitter_free,
+	drawcount_blitter_save,
+	drawcount_blitter_load,
+	NULL, NULL, NULL, NULL, NULL, NULL, /* {begin,end}_{doc,page,puzzle} */
+	NULL, NULL,			       /* line_width, line_dotted */
+	NULL, /* text_fallback */
+	drawcount_draw_thick_line,
+};
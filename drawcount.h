@@ -0,0 +1,40 @@
+/*
+ * drawcount.h: Headless drawing backend which counts drawing calls
+ * instead of rendering anything.
+ * See LICENCE for licence details
+ */
+
+#ifndef PUZZLES_DRAWCOUNT_H
+#define PUZZLES_DRAWCOUNT_H
+
+#include "puzzles.h"
+
+struct drawcount {
+	/* Size of the drawing area, as returned by midend_size */
+	int w, h;
+
+	long texts, rects, lines, polygons, circles, thicklines;
+	long clips, updates, blits;
+
+	/* Sum of all draw_update areas, clipped to the drawing area */
+	long updatearea;
+	/* Number of distinct pixels covered by draw_update calls */
+	long dirtypixels;
+
+	/* One byte per pixel, set when a draw_update covers it */
+	unsigned char *dirty;
+};
+
+extern const drawing_api drawcount_drawing;
+
+struct drawcount *drawcount_new(void);
+void drawcount_free(struct drawcount *dc);
+
+/* Set the size of the drawing area. This also resets all counters. */
+void drawcount_set_size(struct drawcount *dc, int w, int h);
+void drawcount_reset(struct drawcount *dc);
+
+/* Total number of drawing primitives issued since the last reset */
+long drawcount_calls(const struct drawcount *dc);
+
+#endif
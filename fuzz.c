@@ -0,0 +1,464 @@
+/*
+ * fuzz.c: Standalone harness for a game's description parser.
+ * See LICENCE for licence details
+ *
+ * This file is linked together with a single game. It feeds game IDs
+ * through validate_desc, first as they are and then with random edits
+ * to the description, and passes any that validate_desc accepts on to
+ * new_game. Game IDs are read one per line from stdin, as for pack.c,
+ * or generated with --generate. The parameters are never mutated, so
+ * the size of the grids stays that of the corpus.
+ *
+ * Each description is copied to the very end of its buffer. On POSIX
+ * systems the buffer is followed by an inaccessible page, so a parser
+ * which reads past the terminating NUL faults, and the harness prints
+ * the game ID it was parsing. Elsewhere, or to get a stack trace, build
+ * with NO_GUARD_PAGE and AddressSanitizer to catch the same reads.
+ *
+ * Built with FUZZER, this file provides LLVMFuzzerTestOneInput instead
+ * of main. Each input is one game ID, so the files written by --corpus
+ * can seed a coverage-guided run.
+ */
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(NO_GUARD_PAGE)
+#define _DEFAULT_SOURCE
+#define GUARD_PAGE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ctype.h>
+#include <time.h>
+#include <signal.h>
+
+#ifdef GUARD_PAGE
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "puzzles.h"
+#include "genbatch.h"
+
+/* Number of mutated descriptions made from each game ID */
+#define DEFAULT_MUTATIONS 1000
+
+/* Largest number the fuzzer entry point accepts in the parameters */
+#define FUZZ_MAX_PARAM 30
+
+const char *quis;
+
+/* Load a description the way the midend does. Returns true if valid. */
+static bool parse_desc(const game_params *params, const char *desc)
+{
+	game_state *state;
+
+	if(thegame.validate_desc(params, desc))
+		return false;
+
+	state = thegame.new_game(NULL, params, desc);
+	thegame.free_game(state);
+	return true;
+}
+
+#ifdef FUZZER
+
+/*
+ * Reject parameters with large numbers, so that the fuzzer doesn't
+ * spend its time allocating huge grids.
+ */
+static bool params_small(const char *id)
+{
+	while(*id)
+	{
+		if(isdigit((unsigned char)*id))
+		{
+			if(atoi(id) > FUZZ_MAX_PARAM)
+				return false;
+			while(isdigit((unsigned char)*id))
+				id++;
+		}
+		else
+			id++;
+	}
+	return true;
+}
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size)
+{
+	char *id = snewn(size + 1, char), *desc;
+	game_params *params;
+
+	memcpy(id, data, size);
+	id[size] = '\0';
+	desc = strchr(id, ':');
+	if(strlen(id) != size || !desc || !params_small(id))
+	{
+		sfree(id);
+		return 0;
+	}
+	*desc++ = '\0';
+
+	params = thegame.default_params();
+	thegame.decode_params(params, id);
+	if(!thegame.validate_params(params, false))
+		parse_desc(params, desc);
+	thegame.free_params(params);
+	sfree(id);
+	return 0;
+}
+
+#else
+
+struct guard {
+	char *base;
+	size_t size, pagesize;
+};
+
+/* The game ID being parsed, for the fault handler */
+static const char *current_key, *current_desc;
+
+static void usage_exit(const char *msg)
+{
+	if (msg)
+		fprintf(stderr, "%s: %s\n", quis, msg);
+	fprintf(stderr,
+		"Usage: %s [--seed SEED] [--mutations N] [--corpus DIR] < input\n"
+		"       %s [--seed SEED] [--mutations N] [--corpus DIR] --generate COUNT <params>\n",
+		quis, quis);
+	exit(1);
+}
+
+#ifdef GUARD_PAGE
+static void fault_handler(int sig)
+{
+	static const char msg[] = ": fault while parsing ";
+
+	if(current_desc)
+	{
+		if(write(2, quis, strlen(quis)) < 0 ||
+			write(2, msg, sizeof(msg) - 1) < 0 ||
+			write(2, current_key, strlen(current_key)) < 0 ||
+			write(2, ":", 1) < 0 ||
+			write(2, current_desc, strlen(current_desc)) < 0 ||
+			write(2, "\n", 1) < 0)
+			_exit(3);
+	}
+	_exit(2);
+}
+#endif
+
+/*
+ * Copy a description to the end of the guarded buffer, so that the
+ * byte after its NUL cannot be read.
+ */
+static char *guard_copy(struct guard *g, const char *desc)
+{
+	size_t len = strlen(desc) + 1, need;
+
+#ifdef GUARD_PAGE
+	need = (len + g->pagesize - 1) / g->pagesize * g->pagesize + g->pagesize;
+	if(need > g->size)
+	{
+		if(g->base)
+			munmap(g->base, g->size);
+		g->base = mmap(NULL, need, PROT_READ|PROT_WRITE,
+			MAP_PRIVATE|MAP_ANON, -1, 0);
+		if(g->base == MAP_FAILED || mprotect(g->base + need - g->pagesize,
+			g->pagesize, PROT_NONE))
+		{
+			fprintf(stderr, "%s: unable to map guard page\n", quis);
+			exit(1);
+		}
+		g->size = need;
+	}
+	memcpy(g->base + g->size - g->pagesize - len, desc, len);
+	return g->base + g->size - g->pagesize - len;
+#else
+	need = len;
+	sfree(g->base);
+	g->base = snewn(need, char);
+	g->size = need;
+	memcpy(g->base, desc, len);
+	return g->base;
+#endif
+}
+
+/* A byte a description might hold, or one it shouldn't */
+static char mutate_char(const char *desc, int len, random_state *rs)
+{
+	static const char extra[] = "0123456789,_-+:";
+
+	switch(random_upto(rs, 3))
+	{
+	case 0:
+		if(len > 0)
+			return desc[random_upto(rs, len)];
+		/* fall through */
+	case 1:
+		return extra[random_upto(rs, sizeof(extra) - 1)];
+	default:
+		return 1 + random_upto(rs, 255);
+	}
+}
+
+/*
+ * Apply up to three random edits to a description. The result is never
+ * longer than twice the original plus 16 bytes.
+ */
+static void mutate(const char *desc, char *out, random_state *rs)
+{
+	int len = strlen(desc), max = len * 2 + 16;
+	int edits = 1 + random_upto(rs, 3), i, pos, n;
+
+	strcpy(out, desc);
+	while(edits--)
+	{
+		pos = len ? random_upto(rs, len) : 0;
+		switch(random_upto(rs, 6))
+		{
+		case 0: /* Replace a byte */
+			if(len)
+				out[pos] = mutate_char(out, len, rs);
+			break;
+		case 1: /* Delete a byte */
+			if(len)
+				memmove(out + pos, out + pos + 1, len-- - pos);
+			break;
+		case 2: /* Insert a byte */
+			if(len >= max)
+				break;
+			memmove(out + pos + 1, out + pos, ++len - pos);
+			out[pos] = mutate_char(out, len, rs);
+			break;
+		case 3: /* Cut the description short */
+			out[len = pos] = '\0';
+			break;
+		case 4: /* Repeat a stretch */
+			n = len ? 1 + random_upto(rs, min(len - pos, 8)) : 0;
+			n = min(n, max - len);
+			memmove(out + pos + n, out + pos, len - pos + 1);
+			len += n;
+			break;
+		default: /* Make a number very large, or add one */
+			n = min(10, max - len);
+			memmove(out + pos + n, out + pos, len - pos + 1);
+			for(i = 0; i < n; i++)
+				out[pos + i] = '9';
+			len += n;
+			break;
+		}
+	}
+}
+
+static void write_corpus(const char *dir, int n, const char *key, const char *desc)
+{
+	char *filename = snewn(strlen(dir) + 40, char);
+	FILE *fp;
+
+	sprintf(filename, "%s/%d", dir, n);
+	fp = fopen(filename, "w");
+	if(!fp)
+	{
+		fprintf(stderr, "%s: unable to write %s\n", quis, filename);
+		exit(1);
+	}
+	fprintf(fp, "%s:%s", key, desc);
+	fclose(fp);
+	sfree(filename);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long seed = (unsigned long)time(NULL);
+	int i, j, n = 0, size = 0, count = 0, mutations = DEFAULT_MUTATIONS;
+	int nbad = 0, naccepted = 0, lineno = 0;
+	clock_t tvalid, tmutated = 0, start;
+	char *id = NULL, *corpus = NULL, *line, *key, *desc, *copy;
+	char **keys = NULL, **descs = NULL, **batch;
+	char seedbuf[40];
+	game_params **params = NULL, *genparams = NULL;
+	struct guard g;
+	random_state *rs;
+	const char *err;
+#ifdef GUARD_PAGE
+	struct rusage ru;
+#endif
+
+	quis = argv[0];
+
+	while (--argc > 0)
+	{
+		char *p = *++argv;
+		if (!strcmp(p, "--seed") || !strcmp(p, "--generate") ||
+			!strcmp(p, "--mutations") || !strcmp(p, "--corpus"))
+		{
+			if (argc <= 1)
+				usage_exit("option needs an argument");
+			argc--;
+			if (!strcmp(p, "--seed"))
+				seed = strtoul(*++argv, NULL, 10);
+			else if (!strcmp(p, "--generate"))
+				count = atoi(*++argv);
+			else if (!strcmp(p, "--mutations"))
+				mutations = atoi(*++argv);
+			else
+				corpus = *++argv;
+		}
+		else if (*p == '-')
+			usage_exit("unrecognised option");
+		else
+			id = p;
+	}
+
+	if ((count > 0) != (id != NULL) || mutations < 0)
+		usage_exit(NULL);
+
+	if (id)
+	{
+		genparams = thegame.default_params();
+		thegame.decode_params(genparams, id);
+		err = thegame.validate_params(genparams, true);
+		if (err)
+		{
+			fprintf(stderr, "%s: %s\n", quis, err);
+			exit(1);
+		}
+	}
+
+	/* Gather the game IDs */
+	while (genparams ? n < count : true)
+	{
+		if (genparams)
+		{
+			key = thegame.encode_params(genparams, false);
+			desc = genbatch_new_desc(genparams, seed + n);
+		}
+		else
+		{
+			if ((line = fgetline(stdin)) == NULL)
+				break;
+			line[strcspn(line, "\r\n")] = '\0';
+			lineno++;
+			key = strrchr(line, '\t');
+			key = key ? key + 1 : line;
+			desc = strchr(key, ':');
+			if (!*key || !desc)
+			{
+				if (*key)
+					fprintf(stderr, "%s: line %d: missing ':'\n", quis, lineno);
+				sfree(line);
+				continue;
+			}
+			*desc++ = '\0';
+			key = dupstr(key);
+			desc = dupstr(desc);
+			sfree(line);
+		}
+
+		if (n == size)
+		{
+			size = size * 2 + 64;
+			keys = sresize(keys, size, char *);
+			descs = sresize(descs, size, char *);
+			params = sresize(params, size, game_params *);
+		}
+		keys[n] = key;
+		descs[n] = desc;
+		params[n] = thegame.default_params();
+		thegame.decode_params(params[n], key);
+		n++;
+	}
+
+	g.base = NULL;
+	g.size = 0;
+#ifdef GUARD_PAGE
+	g.pagesize = sysconf(_SC_PAGESIZE);
+	signal(SIGSEGV, fault_handler);
+#ifdef SIGBUS
+	signal(SIGBUS, fault_handler);
+#endif
+#endif
+
+	/* Every description as given must be accepted */
+	start = clock();
+	for (i = 0; i < n; i++)
+	{
+		current_key = keys[i];
+		current_desc = copy = guard_copy(&g, descs[i]);
+		if (!parse_desc(params[i], copy))
+		{
+			fprintf(stderr, "%s: %s:%s: %s\n", quis, keys[i], descs[i],
+				thegame.validate_desc(params[i], copy));
+			nbad++;
+		}
+	}
+	tvalid = clock() - start;
+
+	if (corpus)
+		for (i = 0; i < n; i++)
+			write_corpus(corpus, i + 1, keys[i], descs[i]);
+
+	/* Then a batch of mutations of each */
+	sprintf(seedbuf, "%lu", seed);
+	rs = random_new(seedbuf, strlen(seedbuf));
+	batch = snewn(mutations, char *);
+	for (i = 0; i < n; i++)
+	{
+		current_key = keys[i];
+		for (j = 0; j < mutations; j++)
+		{
+			batch[j] = snewn(strlen(descs[i]) * 2 + 17, char);
+			mutate(descs[i], batch[j], rs);
+		}
+
+		start = clock();
+		for (j = 0; j < mutations; j++)
+		{
+			current_desc = copy = guard_copy(&g, batch[j]);
+			if (parse_desc(params[i], copy))
+				naccepted++;
+		}
+		tmutated += clock() - start;
+
+		for (j = 0; j < mutations; j++)
+			sfree(batch[j]);
+	}
+	current_desc = NULL;
+	sfree(batch);
+	random_free(rs);
+
+	printf("Valid:   %d descriptions, %.0f per second, %d rejected\n", n,
+		tvalid ? n / ((double)tvalid / CLOCKS_PER_SEC) : 0.0, nbad);
+	printf("Mutated: %d descriptions, %.0f per second, %d accepted\n", n * mutations,
+		tmutated ? (double)n * mutations / ((double)tmutated / CLOCKS_PER_SEC) : 0.0,
+		naccepted);
+#ifdef GUARD_PAGE
+	getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+	ru.ru_maxrss /= 1024;
+#endif
+	printf("Peak resident size: %ld kB\n", (long)ru.ru_maxrss);
+	munmap(g.base, g.size);
+#else
+	sfree(g.base);
+#endif
+
+	for (i = 0; i < n; i++)
+	{
+		sfree(keys[i]);
+		sfree(descs[i]);
+		thegame.free_params(params[i]);
+	}
+	sfree(keys);
+	sfree(descs);
+	sfree(params);
+	if (genparams)
+		thegame.free_params(genparams);
+
+	return nbad ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * genbatch.h: Bulk generation for the standalone solvers.
+ * See LICENCE for licence details
+ *
+ * With --generate N, a standalone solver generates N puzzles and writes
+ * one line of tab-separated values for each: the seed, the processor
+ * time taken, the number of attempts the generator made, the difficulty
+ * the puzzle turned out to have, any fallback taken when the time
+ * budget ran out, and the description.
+ *
+ * Puzzle i gets the seed S+i, written out in decimal, as the pool tool
+ * does. Any puzzle can be made again with --generate 1 --seed S+i, and
+ * a run can be split across processes by giving each a range of seeds.
+ * A summary of the times is written to stderr, leaving stdout as TSV.
+ *
+ * This file is included by the standalone code at the end of a game,
+ * after thegame has been defined. The tools linked with a game use
+ * genbatch_new_desc to generate puzzles from the same seeds.
+ */
+
+#ifndef PUZZLES_GENBATCH_H
+#define PUZZLES_GENBATCH_H
+
+/* Generate the puzzle for one seed, written out in decimal */
+static inline char *genbatch_new_desc(const game_params *params, unsigned long seed)
+{
+	char seedbuf[40];
+	char *desc, *aux = NULL;
+	random_state *rs;
+
+	sprintf(seedbuf, "%lu", seed);
+	rs = random_new(seedbuf, strlen(seedbuf));
+	desc = thegame.new_desc(params, rs, &aux, false);
+	sfree(aux);
+	random_free(rs);
+	return desc;
+}
+
+#ifdef STANDALONE_SOLVER
+#include "gentime.h"
+
+static int genbatch_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/*
+ * attempts points at the generator's attempt counter, which is reset
+ * before each puzzle, or is NULL if the generator does not count them.
+ * grade returns the name of the difficulty level needed to solve a
+ * description, or NULL if it is not known.
+ */
+static void genbatch_run(const game_params *params, unsigned long seed, int count,
+	long *attempts, const char *(*grade)(const game_params *, const char *))
+{
+	char *desc;
+	const char *diff;
+	double *times = snewn(count > 0 ? count : 1, double);
+	double total = 0;
+	clock_t start;
+	int i;
+
+	printf("seed\tmsec\tattempts\tdifficulty\tfallback\tdesc\n");
+	for(i = 0; i < count; i++)
+	{
+		if(attempts)
+			*attempts = 0;
+		gen_fallback = NULL;
+
+		start = clock();
+		desc = genbatch_new_desc(params, seed + i);
+		times[i] = (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+		total += times[i];
+
+		diff = grade ? grade(params, desc) : NULL;
+		printf("%lu\t%.3f\t", seed + i, times[i]);
+		if(attempts)
+			printf("%ld", *attempts);
+		else
+			printf("-");
+		printf("\t%s\t%s\t%s\n", diff ? diff : "-",
+			gen_fallback ? gen_fallback : "-", desc);
+		fflush(stdout);
+
+		sfree(desc);
+	}
+
+	if(count > 0)
+	{
+		qsort(times, count, sizeof(double), genbatch_cmp);
+		fprintf(stderr, "%d puzzles in %.2f s, %.1f per second\n",
+			count, total / 1000, total > 0 ? count * 1000.0 / total : 0.0);
+		fprintf(stderr, "msec: mean %.3f, median %.3f, 90%% %.3f, 99%% %.3f, max %.3f\n",
+			total / count, times[count / 2], times[count * 9 / 10],
+			times[count * 99 / 100], times[count - 1]);
+	}
+	sfree(times);
+}
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * gentime.h: Time budget for puzzle generators.
+ * See LICENCE for licence details
+ *
+ * Generators which retry until they get a suitable puzzle can check a
+ * deadline in their retry loops. Once it has expired, they should stop
+ * rejecting candidates and settle for a valid puzzle which is easier or
+ * has more clues than requested, recording what they gave up on.
+ *
+ * The budget is given in milliseconds of processor time. If it is
+ * negative, it is read from the PUZZLES_GEN_BUDGET environment variable.
+ * A budget of 0 means no limit.
+ */
+
+#ifndef PUZZLES_GENTIME_H
+#define PUZZLES_GENTIME_H
+
+#include <stdlib.h>
+#include <time.h>
+
+struct gen_deadline {
+	bool limited;
+	clock_t end;
+
+	/* Description of the first fallback taken, or NULL */
+	const char *fallback;
+};
+
+#ifdef STANDALONE_SOLVER
+/* Set with --budget, and reported after each generated puzzle */
+long gen_budget = -1;
+const char *gen_fallback = NULL;
+#define GEN_BUDGET gen_budget
+#define GEN_REPORT(dl) (gen_fallback = (dl)->fallback)
+#else
+#define GEN_BUDGET (-1)
+#define GEN_REPORT(dl) ((void)0)
+#endif
+
+static inline void gen_deadline_start(struct gen_deadline *dl, long msec)
+{
+	if(msec < 0)
+	{
+		const char *env = getenv("PUZZLES_GEN_BUDGET");
+		msec = env ? atol(env) : 0;
+	}
+
+	dl->limited = msec > 0;
+	dl->end = clock() + (clock_t)(msec * (double)CLOCKS_PER_SEC / 1000);
+	dl->fallback = NULL;
+}
+
+static inline bool gen_deadline_expired(const struct gen_deadline *dl)
+{
+	return dl->limited && clock() >= dl->end;
+}
+
+/*
+ * Check the deadline, and if it has expired, record the fallback the
+ * caller is about to take. Returns true if the fallback should be taken.
+ */
+static inline bool gen_deadline_fallback(struct gen_deadline *dl, const char *fallback)
+{
+	if(!gen_deadline_expired(dl))
+		return false;
+	if(!dl->fallback)
+		dl->fallback = fallback;
+	return true;
+}
+
+#endif
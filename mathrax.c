@@ -27,6 +27,9 @@
 
 #include "puzzles.h"
 #include "latin.h"
+#ifdef DESC_CODEC
+#include "desccodec.h"
+#endif
 
 enum {
 	COL_BACKGROUND,
@@ -687,42 +690,77 @@ static int mathrax_solve(game_state *state, int maxdiff)
  * Puzzle Generator *
  * **************** */
 
-static void mathrax_strip_grid_clues(game_state *state, int diff, random_state *rs)
+/*
+ * Remove the given digits at spaces[0..n-1] which the puzzle can do
+ * without, trying them in order, and return the number of solver runs.
+ * Givens never make the solver fail, so if the whole range can go at
+ * once, removing them one by one would have taken them all too. Only
+ * ranges which fail are split, which saves most of the runs on grids
+ * with many clues. fails is set if the whole range is known to fail.
+ */
+static int mathrax_strip_grid_range(game_state *state, const int *spaces, int n,
+	int diff, digit *grid, bool fails)
+{
+	int o2 = state->o * state->o;
+	int i, ret = 0, half;
+
+	if (n == 0)
+		return 0;
+
+	if (!fails)
+	{
+		memcpy(grid, state->grid, o2 * sizeof(digit));
+		for (i = 0; i < n; i++)
+			state->grid[spaces[i]] = 0;
+
+		ret++;
+		fails = !mathrax_solve(state, diff);
+		memcpy(state->grid, grid, o2 * sizeof(digit));
+		if (!fails)
+		{
+			for (i = 0; i < n; i++)
+				state->grid[spaces[i]] = 0;
+			return ret;
+		}
+	}
+	if (n == 1)
+		return ret;
+
+	half = n / 2;
+	ret += mathrax_strip_grid_range(state, spaces, half, diff, grid, false);
+
+	/* If the first half went, the second is the range which failed */
+	for (i = 0; i < half; i++)
+		if (state->grid[spaces[i]]) break;
+	ret += mathrax_strip_grid_range(state, spaces + half, n - half, diff, grid, i == half);
+
+	return ret;
+}
+
+static int mathrax_strip_grid_clues(game_state *state, int diff, random_state *rs)
 {
 	int o = state->o, o2 = o*o;
 	int *spaces = snewn(o2, int);
 	digit *grid = snewn(o2, digit);
-	int i, j;
+	int i, ret;
 
 	for (i = 0; i < o2; i++) spaces[i] = i;
 	shuffle(spaces, o2, sizeof(*spaces), rs);
 
-	for (i = 0; i < o2; i++)
-	{
-		j = spaces[i];
-
-		/* Space is already empty */
-		if (state->grid[j] == 0)
-			continue;
+	ret = mathrax_strip_grid_range(state, spaces, o2, diff, grid, false);
 
-		memcpy(grid, state->grid, o2 * sizeof(digit));
-
-		state->grid[j] = 0;
-
-		if (mathrax_solve(state, diff))
-			grid[j] = 0;
-		memcpy(state->grid, grid, o2 * sizeof(digit));
-	}
 	sfree(spaces);
 	sfree(grid);
+
+	return ret;
 }
 
-static void mathrax_strip_math_clues(game_state *state, int diff, random_state *rs)
+static int mathrax_strip_math_clues(game_state *state, int diff, random_state *rs)
 {
 	int o = state->o, o2 = o*o, co = o-1, cs = co*co;
 	int *spaces = snewn(cs, int);
 	digit *grid = snewn(o2, digit);
-	int i, j;
+	int i, j, ret = 0;
 	clue_t temp;
 
 	memcpy(grid, state->grid, o2 * sizeof(digit));
@@ -742,12 +780,15 @@ static void mathrax_strip_math_clues(game_state *state, int diff, random_state *
 
 		state->clues[j] = 0;
 
+		ret++;
 		if (!mathrax_solve(state, diff))
 			state->clues[j] = temp;
 		memcpy(state->grid, grid, o2 * sizeof(digit));
 	}
 	sfree(spaces);
 	sfree(grid);
+
+	return ret;
 }
 
 static clue_t mathrax_candidate_clue(digit a1, digit b1, digit a2, digit b2, int options)
@@ -785,18 +826,115 @@ static clue_t mathrax_candidate_clue(digit a1, digit b1, digit a2, digit b2, int
 	return 0;
 }
 
-static char *new_game_desc(const game_params *params, random_state *rs,
-			   char **aux, bool interactive)
+/*
+ * Count the 2x2 corners of a filled grid which can hold a clue of one
+ * of the enabled types.
+ */
+static int mathrax_score_grid(const digit *grid, int o, int options)
+{
+	int x, y, co = o-1;
+	int ret = 0;
+
+	for (y = 0; y < co; y++)
+	for (x = 0; x < co; x++)
+	{
+		if (mathrax_candidate_clue(grid[y*o + x], grid[(y+1)*o + x + 1],
+				grid[(y+1)*o + x], grid[y*o + x + 1], options))
+			ret++;
+	}
+
+	return ret;
+}
+
+enum { SWAP_ROWS, SWAP_COLS, SWAP_SYMBOLS };
+
+static void mathrax_swap_grid(digit *grid, int o, int type, int a, int b)
+{
+	int i;
+	digit temp;
+
+	if (type == SWAP_SYMBOLS)
+	{
+		for (i = 0; i < o*o; i++)
+		{
+			if (grid[i] == a)
+				grid[i] = b;
+			else if (grid[i] == b)
+				grid[i] = a;
+		}
+		return;
+	}
+
+	for (i = 0; i < o; i++)
+	{
+		int ia = type == SWAP_ROWS ? a*o + i : i*o + a;
+		int ib = type == SWAP_ROWS ? b*o + i : i*o + b;
+		temp = grid[ia];
+		grid[ia] = grid[ib];
+		grid[ib] = temp;
+	}
+}
+
+/*
+ * Swapping two rows, two columns or two symbols keeps a latin square
+ * intact, but changes which pairs of digits meet diagonally. With only
+ * a few clue types enabled, a random square often leaves most corners
+ * without a possible clue, so the stripping stage has to keep many
+ * given digits. Climb towards a grid with more clue-bearing corners,
+ * keeping each random swap unless it lowers the score.
+ *
+ * Every clue-bearing corner costs a solver run when the clues are
+ * stripped, and makes the solves slower, so the climb stops once a
+ * quarter of the corners bear clues. Most squares start above that
+ * when all clue types are enabled, and are left as they are.
+ */
+static int mathrax_improve_grid(digit *grid, int o, int options, int steps, random_state *rs)
 {
-	int o = params->o, s = o*o, i, x, y, co = o-1, cs = co*co;
+	int co = o-1, target = co*co / 4;
+	int score = mathrax_score_grid(grid, o, options);
+	int i, type, a, b, next;
+
+	for (i = 0; i < steps && score < target; i++)
+	{
+		type = random_upto(rs, 3);
+		a = random_upto(rs, o);
+		b = random_upto(rs, o-1);
+		if (b >= a) b++;
+		if (type == SWAP_SYMBOLS)
+			a++, b++;
+
+		mathrax_swap_grid(grid, o, type, a, b);
+		next = mathrax_score_grid(grid, o, options);
+		if (next < score)
+			mathrax_swap_grid(grid, o, type, a, b);
+		else
+			score = next;
+	}
+
+	return score;
+}
+
+#define MATHRAX_IMPROVE_STEPS(o) ((o)*(o)*8)
+
+/*
+ * Generate a puzzle, returning the number of solver runs needed to
+ * strip it down. If score is not NULL, it is set to the number of
+ * clue-bearing corners before stripping.
+ */
+static int mathrax_generate(game_state *state, const game_params *params, int steps,
+	int *score, random_state *rs)
+{
+	int o = params->o, x, y, co = o-1;
 	int options = params->options;
+	int ret, corners;
 	if(!options) options = OPTIONSMASK;
-	
-	game_state *state = blank_game(o);
-	
+
+	sfree(state->grid);
 	state->grid = latin_generate(o, rs);
-	
-	
+	corners = mathrax_improve_grid(state->grid, o, options, steps, rs);
+	if (score)
+		*score = corners;
+
 	for (y = 0; y < co; y++)
 	for (x = 0; x < co; x++)
 	{
@@ -809,10 +947,18 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 		);
 	}
 
-	mathrax_strip_grid_clues(state, params->diff, rs);
-	mathrax_strip_math_clues(state, params->diff, rs);
-	
+	ret = mathrax_strip_grid_clues(state, params->diff, rs);
+	ret += mathrax_strip_math_clues(state, params->diff, rs);
+
+	return ret;
+}
+
+/* Grid digits and clues, each with runs of empty squares */
+static char *mathrax_encode_desc(const game_state *state)
+{
+	int o = state->o, s = o*o, i, co = o-1, cs = co*co;
 	char *ret, *p;
+	
 	ret = snewn((s*3) + 2, char);
 	p = ret;
 	int run = 0;
@@ -890,9 +1036,125 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	if (run)
 		*p++ = ('a' - 1) + run;
 	
+	*p++ = '\0';
+	return ret;
+}
+
+#ifdef DESC_CODEC
+/* Largest number an arithmetic clue can hold in a grid of this size */
+static int mathrax_clue_max(int o, int type)
+{
+	switch (type)
+	{
+		case CLUE_ADD:
+			return o + o;
+		case CLUE_SUB:
+			return o - 1;
+		case CLUE_MUL:
+			return o * o;
+		case CLUE_DIV:
+			return o;
+	}
+	return 0;
+}
+
+static void mathrax_pack(const game_state *state, struct desc_writer *dw)
+{
+	int o = state->o, s = o*o, i, co = o-1, cs = co*co;
+	int type;
+	bool givens = false;
+	
+	desc_put_varint(dw, o);
+	
+	for (i = 0; i < s; i++)
+		givens = givens || state->grid[i] != 0;
+	desc_put_bits(dw, givens, 1);
+	for (i = 0; i < s && givens; i++)
+	{
+		desc_put_bits(dw, state->grid[i] != 0, 1);
+		if (state->grid[i] != 0)
+			desc_put_bits(dw, state->grid[i] - 1, 4);
+	}
+	
+	/* Only the arithmetic clues carry a number */
+	for (i = 0; i < cs; i++)
+	{
+		type = state->clues[i] & CLUEMASK;
+		desc_put_bits(dw, type, 3);
+		if (type && type <= CLUE_DIV)
+			desc_put_bits(dw, CLUENUM(state->clues[i]),
+				desc_bits_for(mathrax_clue_max(o, type)));
+	}
+}
+
+static game_state *mathrax_unpack(struct desc_reader *dr, game_params **params)
+{
+	game_params *ret = default_params();
+	game_state *state;
+	int o, s, cs, i, d, type, num;
+	
+	*params = ret;
+	ret->o = o = desc_get_varint(dr);
+	if (dr->error || validate_params(ret, false))
+		return NULL;
+	
+	s = o*o;
+	cs = (o-1)*(o-1);
+	state = blank_game(o);
+	
+	if (desc_get_bits(dr, 1))
+	{
+		for (i = 0; i < s && !dr->error; i++)
+		{
+			if (!desc_get_bits(dr, 1))
+				continue;
+			d = desc_get_bits(dr, 4) + 1;
+			if (d > o)
+				dr->error = true;
+			state->grid[i] = d;
+			state->flags[i] |= F_IMMUTABLE;
+		}
+	}
+	
+	for (i = 0; i < cs && !dr->error; i++)
+	{
+		type = desc_get_bits(dr, 3);
+		num = 0;
+		if (type > CLUE_ODD)
+			dr->error = true;
+		else if (type && type <= CLUE_DIV)
+		{
+			num = desc_get_bits(dr, desc_bits_for(mathrax_clue_max(o, type)));
+			if (num > mathrax_clue_max(o, type))
+				dr->error = true;
+		}
+		state->clues[i] = type | SET_CLUENUM(num);
+	}
+	
+	if (dr->error)
+	{
+		free_game(state);
+		return NULL;
+	}
+	return state;
+}
+
+const struct desc_codec thecodec = { mathrax_pack, mathrax_unpack, mathrax_encode_desc };
+#endif
+
+static char *new_game_desc(const game_params *params, random_state *rs,
+			   char **aux, bool interactive)
+{
+	int o = params->o;
+	char *ret;
+	
+	game_state *state = blank_game(o);
+	
+	mathrax_generate(state, params, MATHRAX_IMPROVE_STEPS(o), NULL, rs);
+	
+	ret = mathrax_encode_desc(state);
 	free_game(state);
 	
-	*p++ = '\0';
 	return ret;
 }
 
@@ -994,15 +1256,18 @@ static game_state *load_game(const game_params *params, const char *desc, const
 						*fail = "Invalid clue in description.";
 						return NULL;
 				}
-				num = atoi(p);
-				if(num > 99)
+				num = 0;
+				while(*p && isdigit((unsigned char) *p))
 				{
-					free_game(ret);
-					*fail = "Number is too high in clue description.";
-					return NULL;
+					num = num * 10 + (*p++ - '0');
+					if(num > 99)
+					{
+						free_game(ret);
+						*fail = "Number is too high in clue description.";
+						return NULL;
+					}
 				}
 				ret->clues[pos++] |= SET_CLUENUM(num);
-				while(*p && isdigit((unsigned char) *p)) p++;
 			}
 		}
 		
@@ -1790,3 +2055,229 @@ const struct game thegame = {
 	false, game_timing_state,
 	REQUIRE_RBUTTON, /* flags */
 };
+
+#ifdef STANDALONE_SOLVER
+#include <time.h>
+
+#include "genbatch.h"
+#include "solvestream.h"
+
+const char *quis;
+
+static void usage_exit(const char *msg)
+{
+	if (msg)
+		fprintf(stderr, "%s: %s\n", quis, msg);
+	fprintf(stderr,
+			"Usage: %s [--seed SEED] [--bench COUNT] [--generate COUNT] [--stream] <params> | [game_id [game_id ...]]\n",
+			quis);
+	exit(1);
+}
+
+/*
+ * Generate a number of puzzles with and without improving the latin
+ * square first, and report the solver runs, remaining clues and time
+ * for each.
+ */
+static void mathrax_bench(game_params *params, random_state *rs, int count)
+{
+	int o = params->o, s = o*o, co = o-1, cs = co*co;
+	int pass, i, j, runs, corners, score, givens, clues;
+	int steps[2] = { 0, MATHRAX_IMPROVE_STEPS(o) };
+	game_state *state;
+	clock_t start, total;
+
+	for(pass = 0; pass < 2; pass++)
+	{
+		runs = corners = givens = clues = 0;
+		total = 0;
+		for(i = 0; i < count; i++)
+		{
+			state = blank_game(o);
+			start = clock();
+			runs += mathrax_generate(state, params, steps[pass], &score, rs);
+			total += clock() - start;
+			corners += score;
+
+			for(j = 0; j < s; j++)
+				if(state->grid[j]) givens++;
+			for(j = 0; j < cs; j++)
+				if(state->clues[j]) clues++;
+			free_game(state);
+		}
+
+		printf("%s: %.1f clue corners, %.1f solver runs, %.1f digits and %.1f clues left, %.2f ms per puzzle\n",
+			   pass ? "Improved grid" : "Plain grid",
+			   (double)corners / count, (double)runs / count,
+			   (double)givens / count, (double)clues / count,
+			   total * 1000.0 / CLOCKS_PER_SEC / count);
+	}
+}
+
+/*
+ * The lowest difficulty which solves a generated puzzle, for --generate.
+ * The generator does not retry, so there is no attempt count to report.
+ */
+static const char *mathrax_grade(const game_params *params, const char *desc)
+{
+	game_state *state;
+	int diff, result;
+
+	for(diff = 0; diff < DIFFCOUNT; diff++)
+	{
+		state = new_game(NULL, params, desc);
+		result = mathrax_solve(state, diff);
+		free_game(state);
+		if(result == 1)
+			return mathrax_diffnames[diff];
+		if(result != 0)
+			break;
+	}
+	return "Unsolved";
+}
+
+/* Solve one puzzle for --stream at each difficulty in turn, as for --generate */
+static void mathrax_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+	game_state *copy;
+	int diff, result = 0;
+
+	for(diff = 0; diff < DIFFCOUNT && result == 0; diff++)
+	{
+		copy = dup_game(state);
+		result = mathrax_solve(copy, diff);
+		free_game(copy);
+	}
+
+	if(result == 1)
+	{
+		res->status = "Solved";
+		res->diff = mathrax_diffnames[diff - 1];
+	}
+	else if(result == 2)
+		res->status = "Ambiguous";
+	else if(result < 0)
+		res->status = "Invalid";
+}
+
+int main(int argc, char *argv[])
+{
+	random_state *rs;
+	time_t seed = time(NULL);
+	int bench = 0, generate = 0;
+	bool stream = false;
+
+	game_params *params = NULL;
+
+	char *id = NULL, *desc = NULL;
+	const char *err;
+
+	quis = argv[0];
+
+	while (--argc > 0) {
+		char *p = *++argv;
+		if (!strcmp(p, "--seed")) {
+			if (argc == 0)
+				usage_exit("--seed needs an argument");
+			seed = (time_t) atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--bench")) {
+			if (argc == 0)
+				usage_exit("--bench needs an argument");
+			bench = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--generate")) {
+			if (argc == 0)
+				usage_exit("--generate needs an argument");
+			generate = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--params")) {
+			if (argc == 0)
+				usage_exit("--params needs an argument");
+			id = *++argv;
+			argc--;
+		} else if (!strcmp(p, "--stream"))
+			stream = true;
+		else if (*p == '-')
+			usage_exit("unrecognised option");
+		else
+			id = p;
+	}
+
+	if (id) {
+		desc = strchr(id, ':');
+		if (desc)
+			*desc++ = '\0';
+
+		params = default_params();
+		decode_params(params, id);
+		err = validate_params(params, true);
+		if (err) {
+			fprintf(stderr, "Parameters are invalid\n");
+			fprintf(stderr, "%s: %s", argv[0], err);
+			exit(1);
+		}
+	}
+
+	if (stream) {
+		if (id)
+			usage_exit("--stream reads game IDs from stdin");
+		solvestream_run(stdin, mathrax_stream_solve, NULL);
+	} else if (generate) {
+		if (desc)
+			usage_exit("--generate needs parameters, not a game ID");
+		if (!params)
+			params = default_params();
+		genbatch_run(params, (unsigned long)seed, generate, NULL, mathrax_grade);
+	} else if (bench) {
+		rs = random_new((void *) &seed, sizeof(time_t));
+		if (!params)
+			params = default_params();
+		printf("Generating %d puzzles with parameters %s\n", bench,
+			   encode_params(params, true));
+		mathrax_bench(params, rs, bench);
+	} else if (!desc) {
+		char *desc_gen, *aux;
+		rs = random_new((void *) &seed, sizeof(time_t));
+		if (!params)
+			params = default_params();
+		printf("Generating puzzle with parameters %s\n",
+			   encode_params(params, true));
+		desc_gen = new_game_desc(params, rs, &aux, false);
+
+		printf("Game ID: %s\n", desc_gen);
+	} else {
+		game_state *input;
+		int o, x, y, result;
+
+		err = validate_desc(params, desc);
+		if (err) {
+			fprintf(stderr, "Description is invalid\n");
+			fprintf(stderr, "%s", err);
+			exit(1);
+		}
+
+		input = new_game(NULL, params, desc);
+		o = input->o;
+
+		result = mathrax_solve(input, DIFF_RECURSIVE);
+
+		for(y = 0; y < o; y++)
+		{
+			for(x = 0; x < o; x++)
+				putchar(input->grid[y*o+x] ? '0' + input->grid[y*o+x] : '.');
+			putchar('\n');
+		}
+		if (result < 0)
+			printf("Puzzle is invalid.\n");
+		else if (result == 0)
+			printf("No solution found.\n");
+		else if (result == 2)
+			printf("Puzzle is ambiguous.\n");
+
+		free_game(input);
+	}
+
+	return 0;
+}
+#endif
@@ -0,0 +1,478 @@
+/*
+ * pack.c: Standalone tool to convert descriptions to and from the
+ * binary encoding.
+ * See LICENCE for licence details
+ *
+ * This file is linked together with a single game, compiled with
+ * DESC_CODEC. Game IDs are read one per line; anything up to the last
+ * tab is ignored, so the output of a pool tool's --list can be used.
+ *
+ * A packed corpus starts with a text line:
+ *
+ *   puzzles-desccodec <version> <game>
+ *
+ * followed by one record per puzzle: its length in bytes as a varint,
+ * then the bytes written by the game's codec.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include "puzzles.h"
+#include "desccodec.h"
+#include "genbatch.h"
+
+/* Time each benchmark pass over the corpus for at least this long */
+#define BENCH_MIN_TIME (CLOCKS_PER_SEC / 4)
+
+/*
+ * Longest record accepted when unpacking. Real records are far shorter,
+ * so a longer one means the corpus is damaged.
+ */
+#define MAX_RECORD (1 << 20)
+
+const char *quis;
+
+struct corpus {
+	game_params **params;
+	char **ids, **descs;
+	unsigned char **records;
+	int *lens;
+	int n, size;
+};
+
+static void usage_exit(const char *msg)
+{
+	if (msg)
+		fprintf(stderr, "%s: %s\n", quis, msg);
+	fprintf(stderr,
+		"Usage: %s (--pack | --unpack | --check | --bench) < input\n"
+		"       %s [--seed SEED] --generate COUNT <params>\n",
+		quis, quis);
+	exit(1);
+}
+
+static unsigned char *pack_state(const game_state *state, int *len)
+{
+	struct desc_writer dw;
+
+	desc_writer_init(&dw);
+	thecodec.pack(state, &dw);
+	*len = desc_writer_len(&dw);
+	return dw.data;
+}
+
+static game_state *unpack_record(const unsigned char *data, int len, game_params **params)
+{
+	struct desc_reader dr;
+	game_state *state;
+
+	desc_reader_init(&dr, data, len);
+	*params = NULL;
+	state = thecodec.unpack(&dr, params);
+	if(state && dr.error)
+	{
+		thegame.free_game(state);
+		state = NULL;
+	}
+	if(!state && *params)
+	{
+		thegame.free_params(*params);
+		*params = NULL;
+	}
+	return state;
+}
+
+/*
+ * Read game IDs from stdin, and pack each of them. Returns false if
+ * any line is not a valid game ID.
+ */
+static bool corpus_read(struct corpus *c)
+{
+	char *line, *id, *desc;
+	const char *err;
+	game_params *params;
+	game_state *state;
+	int lineno = 0;
+	bool ok = true;
+
+	c->params = NULL;
+	c->ids = c->descs = NULL;
+	c->records = NULL;
+	c->lens = NULL;
+	c->n = c->size = 0;
+
+	while((line = fgetline(stdin)) != NULL)
+	{
+		line[strcspn(line, "\r\n")] = '\0';
+		lineno++;
+		id = strrchr(line, '\t');
+		id = id ? id + 1 : line;
+		desc = strchr(id, ':');
+		if(!*id)
+		{
+			sfree(line);
+			continue;
+		}
+		if(!desc)
+		{
+			fprintf(stderr, "%s: line %d: missing ':'\n", quis, lineno);
+			sfree(line);
+			ok = false;
+			continue;
+		}
+		*desc++ = '\0';
+
+		params = thegame.default_params();
+		thegame.decode_params(params, id);
+		err = thegame.validate_params(params, false);
+		if(!err)
+			err = thegame.validate_desc(params, desc);
+		if(err)
+		{
+			fprintf(stderr, "%s: line %d: %s\n", quis, lineno, err);
+			thegame.free_params(params);
+			sfree(line);
+			ok = false;
+			continue;
+		}
+
+		if(c->n == c->size)
+		{
+			c->size = c->size * 2 + 64;
+			c->params = sresize(c->params, c->size, game_params *);
+			c->ids = sresize(c->ids, c->size, char *);
+			c->descs = sresize(c->descs, c->size, char *);
+			c->records = sresize(c->records, c->size, unsigned char *);
+			c->lens = sresize(c->lens, c->size, int);
+		}
+
+		state = thegame.new_game(NULL, params, desc);
+		c->params[c->n] = params;
+		c->ids[c->n] = dupstr(id);
+		c->descs[c->n] = dupstr(desc);
+		c->records[c->n] = pack_state(state, &c->lens[c->n]);
+		c->n++;
+
+		thegame.free_game(state);
+		sfree(line);
+	}
+
+	return ok;
+}
+
+static void corpus_free(struct corpus *c)
+{
+	int i;
+
+	for(i = 0; i < c->n; i++)
+	{
+		thegame.free_params(c->params[i]);
+		sfree(c->ids[i]);
+		sfree(c->descs[i]);
+		sfree(c->records[i]);
+	}
+	sfree(c->params);
+	sfree(c->ids);
+	sfree(c->descs);
+	sfree(c->records);
+	sfree(c->lens);
+}
+
+/* Unpack every record and compare its text with the original */
+static int corpus_check(const struct corpus *c)
+{
+	game_params *params;
+	game_state *state;
+	char *desc;
+	int i, nbad = 0;
+
+	for(i = 0; i < c->n; i++)
+	{
+		state = unpack_record(c->records[i], c->lens[i], &params);
+		if(!state)
+		{
+			printf("%d\tunpack failed\t%s\n", i + 1, c->descs[i]);
+			nbad++;
+			continue;
+		}
+
+		desc = thecodec.encode(state);
+		if(strcmp(desc, c->descs[i]))
+		{
+			printf("%d\tmismatch\t%s\t%s\n", i + 1, c->descs[i], desc);
+			nbad++;
+		}
+
+		sfree(desc);
+		thegame.free_game(state);
+		thegame.free_params(params);
+	}
+
+	return nbad;
+}
+
+/* Load each game ID the way the midend does, parameters and all */
+static double bench_text(const struct corpus *c, int *passes)
+{
+	clock_t start = clock(), elapsed;
+	game_params *params;
+	game_state *state;
+	int i;
+
+	*passes = 0;
+	do
+	{
+		for(i = 0; i < c->n; i++)
+		{
+			params = thegame.default_params();
+			thegame.decode_params(params, c->ids[i]);
+			if(!thegame.validate_desc(params, c->descs[i]))
+			{
+				state = thegame.new_game(NULL, params, c->descs[i]);
+				thegame.free_game(state);
+			}
+			thegame.free_params(params);
+		}
+		(*passes)++;
+		elapsed = clock() - start;
+	} while(elapsed < BENCH_MIN_TIME);
+
+	return (double)elapsed / CLOCKS_PER_SEC;
+}
+
+static double bench_binary(const struct corpus *c, int *passes)
+{
+	clock_t start = clock(), elapsed;
+	game_params *params;
+	game_state *state;
+	int i;
+
+	*passes = 0;
+	do
+	{
+		for(i = 0; i < c->n; i++)
+		{
+			state = unpack_record(c->records[i], c->lens[i], &params);
+			if(!state)
+				continue;
+			thegame.free_game(state);
+			thegame.free_params(params);
+		}
+		(*passes)++;
+		elapsed = clock() - start;
+	} while(elapsed < BENCH_MIN_TIME);
+
+	return (double)elapsed / CLOCKS_PER_SEC;
+}
+
+static void write_varint(FILE *fp, unsigned int value)
+{
+	while(value >= 0x80)
+	{
+		fputc((value & 0x7F) | 0x80, fp);
+		value >>= 7;
+	}
+	fputc(value, fp);
+}
+
+static bool read_varint(FILE *fp, unsigned int *value)
+{
+	int c, shift = 0;
+
+	*value = 0;
+	do
+	{
+		c = fgetc(fp);
+		if(c == EOF || shift > 28)
+			return false;
+		*value |= (unsigned int)(c & 0x7F) << shift;
+		shift += 7;
+	} while(c & 0x80);
+
+	return true;
+}
+
+static int varint_len(unsigned int value)
+{
+	int ret = 1;
+	while(value >= 0x80)
+	{
+		ret++;
+		value >>= 7;
+	}
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	enum { MODE_NONE, MODE_PACK, MODE_UNPACK, MODE_CHECK, MODE_BENCH, MODE_GENERATE } mode = MODE_NONE;
+	unsigned long seed = (unsigned long)time(NULL);
+	struct corpus c;
+	game_params *params;
+	game_state *state;
+	char *id = NULL, *key, *desc, *line;
+	const char *err;
+	unsigned char *data;
+	unsigned int len;
+	long textbytes, binbytes;
+	double ttext, tbin;
+	int i, count = 0, ntext, nbin, nbad, ret = 0;
+
+	quis = argv[0];
+
+	while (--argc > 0)
+	{
+		char *p = *++argv;
+		if (!strcmp(p, "--seed") || !strcmp(p, "--generate"))
+		{
+			if (argc <= 1)
+				usage_exit("option needs an argument");
+			argc--;
+			if (!strcmp(p, "--seed"))
+				seed = strtoul(*++argv, NULL, 10);
+			else
+			{
+				mode = MODE_GENERATE;
+				count = atoi(*++argv);
+			}
+		}
+		else if (!strcmp(p, "--pack"))
+			mode = MODE_PACK;
+		else if (!strcmp(p, "--unpack"))
+			mode = MODE_UNPACK;
+		else if (!strcmp(p, "--check"))
+			mode = MODE_CHECK;
+		else if (!strcmp(p, "--bench"))
+			mode = MODE_BENCH;
+		else if (*p == '-')
+			usage_exit("unrecognised option");
+		else
+			id = p;
+	}
+
+	if (mode == MODE_NONE || (mode == MODE_GENERATE) != (id != NULL))
+		usage_exit(NULL);
+
+	switch(mode)
+	{
+	case MODE_GENERATE:
+		params = thegame.default_params();
+		thegame.decode_params(params, id);
+		err = thegame.validate_params(params, true);
+		if (err)
+		{
+			fprintf(stderr, "%s: %s\n", quis, err);
+			exit(1);
+		}
+		key = thegame.encode_params(params, false);
+		for(i = 0; i < count; i++)
+		{
+			desc = genbatch_new_desc(params, seed + i);
+			printf("%s:%s\n", key, desc);
+			fflush(stdout);
+			sfree(desc);
+		}
+		sfree(key);
+		thegame.free_params(params);
+		break;
+	case MODE_PACK:
+		if(!corpus_read(&c))
+			ret = 1;
+		printf("puzzles-desccodec %d %s\n", DESCCODEC_VERSION, thegame.name);
+		for(i = 0; i < c.n; i++)
+		{
+			write_varint(stdout, c.lens[i]);
+			fwrite(c.records[i], 1, c.lens[i], stdout);
+		}
+		corpus_free(&c);
+		break;
+	case MODE_UNPACK:
+		line = fgetline(stdin);
+		if(line)
+			line[strcspn(line, "\r\n")] = '\0';
+		key = snewn(strlen(thegame.name) + 40, char);
+		sprintf(key, "puzzles-desccodec %d %s", DESCCODEC_VERSION, thegame.name);
+		if(!line || strcmp(line, key))
+		{
+			fprintf(stderr, "%s: not a packed %s corpus\n", quis, thegame.name);
+			exit(1);
+		}
+		sfree(line);
+		sfree(key);
+
+		for(i = 1; read_varint(stdin, &len); i++)
+		{
+			/* The rest of the corpus can't be found after a bad length */
+			if(len > MAX_RECORD)
+			{
+				fprintf(stderr, "%s: record %d is invalid\n", quis, i);
+				ret = 1;
+				break;
+			}
+			data = snewn(len ? len : 1, unsigned char);
+			if(fread(data, 1, len, stdin) != len)
+			{
+				fprintf(stderr, "%s: record %d is cut short\n", quis, i);
+				sfree(data);
+				ret = 1;
+				break;
+			}
+			state = unpack_record(data, len, &params);
+			if(!state)
+			{
+				fprintf(stderr, "%s: record %d is invalid\n", quis, i);
+				ret = 1;
+			}
+			else
+			{
+				key = thegame.encode_params(params, false);
+				desc = thecodec.encode(state);
+				printf("%s:%s\n", key, desc);
+				sfree(key);
+				sfree(desc);
+				thegame.free_game(state);
+				thegame.free_params(params);
+			}
+			sfree(data);
+		}
+		break;
+	case MODE_CHECK:
+	case MODE_BENCH:
+		if(!corpus_read(&c))
+			ret = 1;
+		nbad = corpus_check(&c);
+		printf("%d descriptions, %d failed to round-trip\n", c.n, nbad);
+		if(nbad)
+			ret = 1;
+
+		if(mode == MODE_BENCH && c.n)
+		{
+			textbytes = binbytes = 0;
+			for(i = 0; i < c.n; i++)
+			{
+				/* A game ID and its newline, against a record */
+				textbytes += strlen(c.ids[i]) + strlen(c.descs[i]) + 2;
+				binbytes += c.lens[i] + varint_len(c.lens[i]);
+			}
+			printf("Size: %.1f bytes per puzzle as text, %.1f packed (%.0f%%)\n",
+				(double)textbytes / c.n, (double)binbytes / c.n,
+				100.0 * binbytes / textbytes);
+
+			ttext = bench_text(&c, &ntext);
+			tbin = bench_binary(&c, &nbin);
+			printf("Parse: %.3f us per puzzle from text, %.3f us unpacked (%.1fx)\n",
+				ttext * 1e6 / ((double)ntext * c.n), tbin * 1e6 / ((double)nbin * c.n),
+				(ttext / ntext) / (tbin / nbin));
+		}
+		corpus_free(&c);
+		break;
+	default:
+		break;
+	}
+
+	return ret;
+}
@@ -0,0 +1,179 @@
+/*
+ * pool.c: Standalone tool to fill and inspect description pools.
+ * See LICENCE for licence details
+ *
+ * This file is linked together with a single game. Every generated
+ * description gets its own seed, derived from the base seed and its
+ * index, so that any entry can be regenerated from its seed alone and
+ * several processes can fill the same pool with disjoint seed ranges.
+ *
+ * --fill tops the pool up to the requested size, so it can be run
+ * periodically in the background to replace entries which were taken.
+ * Seeds below the pool's next seed have already been used, by entries
+ * which are still there or were taken, so filling starts at that seed
+ * if --seed is lower.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include "puzzles.h"
+#include "descpool.h"
+#include "genbatch.h"
+
+const char *quis;
+
+static void usage_exit(const char *msg)
+{
+	if (msg)
+		fprintf(stderr, "%s: %s\n", quis, msg);
+	fprintf(stderr,
+		"Usage: %s [--dir DIR] [--seed SEED] <params> (--fill N | --list | --check | --take)\n",
+		quis);
+	exit(1);
+}
+
+static struct descpool_entry *pool_read(const char *filename, const char *key,
+	int *n, int *nbad, unsigned long *nextseed)
+{
+	const char *err;
+	struct descpool_entry *entries = descpool_read(filename, key, n, nbad,
+		nextseed, &err);
+
+	if(!entries)
+	{
+		fprintf(stderr, "%s: %s: %s\n", quis, filename, err);
+		exit(1);
+	}
+	return entries;
+}
+
+int main(int argc, char *argv[])
+{
+	enum { MODE_NONE, MODE_FILL, MODE_LIST, MODE_CHECK, MODE_TAKE } mode = MODE_NONE;
+	unsigned long seed = (unsigned long)time(NULL), nextseed;
+	game_params *params = NULL;
+	char *id = NULL, *key, *filename, *desc;
+	struct descpool_entry *entries;
+	const char *err;
+	int i, n, nbad, nfill = 0, ninvalid, ret = 0;
+	char seedbuf[40];
+	clock_t start;
+
+	quis = argv[0];
+
+	while (--argc > 0)
+	{
+		char *p = *++argv;
+		if (!strcmp(p, "--seed") || !strcmp(p, "--dir") || !strcmp(p, "--fill"))
+		{
+			if (argc <= 1)
+				usage_exit("option needs an argument");
+			argc--;
+			if (!strcmp(p, "--seed"))
+				seed = strtoul(*++argv, NULL, 10);
+			else if (!strcmp(p, "--dir"))
+				descpool_dir = *++argv;
+			else
+			{
+				mode = MODE_FILL;
+				nfill = atoi(*++argv);
+			}
+		}
+		else if (!strcmp(p, "--list"))
+			mode = MODE_LIST;
+		else if (!strcmp(p, "--check"))
+			mode = MODE_CHECK;
+		else if (!strcmp(p, "--take"))
+			mode = MODE_TAKE;
+		else if (*p == '-')
+			usage_exit("unrecognised option");
+		else
+			id = p;
+	}
+
+	if (!id || mode == MODE_NONE)
+		usage_exit(NULL);
+
+	params = thegame.default_params();
+	thegame.decode_params(params, id);
+	err = thegame.validate_params(params, true);
+	if (err)
+	{
+		fprintf(stderr, "%s: %s\n", quis, err);
+		exit(1);
+	}
+
+	if (!descpool_dir)
+		descpool_dir = ".";
+	key = thegame.encode_params(params, true);
+	filename = descpool_filename(thegame.name, key);
+	entries = pool_read(filename, key, &n, &nbad, &nextseed);
+
+	switch(mode)
+	{
+	case MODE_FILL:
+		if(seed < nextseed)
+			seed = nextseed;
+		for(i = n; i < nfill; i++)
+		{
+			sprintf(seedbuf, "%lu", seed + i - n);
+			start = clock();
+			desc = genbatch_new_desc(params, seed + i - n);
+			printf("%s\t%s\t%.3f\n", key, seedbuf,
+				(double)(clock() - start) / CLOCKS_PER_SEC);
+			fflush(stdout);
+
+			if(!descpool_add(thegame.name, key, seedbuf, desc))
+			{
+				fprintf(stderr, "%s: unable to write to %s\n", quis, filename);
+				exit(1);
+			}
+			sfree(desc);
+		}
+		break;
+	case MODE_LIST:
+		for(i = 0; i < n; i++)
+			printf("%s\t%s:%s\n", entries[i].seed, key, entries[i].desc);
+		break;
+	case MODE_CHECK:
+		ninvalid = 0;
+		for(i = 0; i < n; i++)
+		{
+			err = thegame.validate_desc(params, entries[i].desc);
+			if(err)
+			{
+				printf("%s\tinvalid\t%s\n", entries[i].seed, err);
+				ninvalid++;
+			}
+		}
+		printf("%s: %d entries, %d invalid, %d bad checksums\n",
+			filename, n, ninvalid, nbad);
+		if(ninvalid || nbad)
+			ret = 1;
+		break;
+	case MODE_TAKE:
+		desc = descpool_take(thegame.name, params, thegame.encode_params,
+			thegame.validate_desc);
+		if(desc)
+			printf("%s:%s\n", key, desc);
+		else
+		{
+			fprintf(stderr, "%s: %s is empty\n", quis, filename);
+			ret = 1;
+		}
+		sfree(desc);
+		break;
+	default:
+		break;
+	}
+
+	descpool_free_entries(entries, n);
+	sfree(filename);
+	sfree(key);
+	thegame.free_params(params);
+	return ret;
+}
@@ -0,0 +1,450 @@
+/*
+ * replay.c: Headless savefile replayer, for profiling redraws.
+ * See LICENCE for licence details
+ *
+ * This file is linked together with a single game. Each savefile given
+ * on the command line is loaded through the midend, rewound to its
+ * first state, and then every move is redone while drawing through the
+ * counting backend in drawcount.c. Animations and flashes are played
+ * out at a fixed frame rate, as a real front end would.
+ *
+ * Output is tab-separated, with one line per move and a total line per
+ * savefile, so the numbers can be compared between commits.
+ *
+ * With --bench, nothing is drawn. Instead the move list of each
+ * savefile is replayed directly through the game's backend many
+ * times, timing execute_move, dup_game and free_game separately.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <time.h>
+
+#include "puzzles.h"
+#include "drawcount.h"
+
+/* Simulated delay between two animation frames, in seconds */
+#define REPLAY_FRAME 0.02F
+/* Give up on animations which don't stop by themselves */
+#define REPLAY_MAXFRAMES 1000
+
+struct frontend {
+	bool timer;
+};
+
+const char *quis;
+
+void fatal(const char *fmt, ...)
+{
+	va_list ap;
+
+	fprintf(stderr, "%s: fatal error: ", quis);
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+void frontend_default_colour(frontend *fe, float *output)
+{
+	output[0] = output[1] = output[2] = 0.9F;
+}
+
+void get_random_seed(void **randseed, int *randseedsize)
+{
+	time_t *tp = snew(time_t);
+	time(tp);
+	*randseed = (void *)tp;
+	*randseedsize = sizeof(time_t);
+}
+
+void activate_timer(frontend *fe)
+{
+	fe->timer = true;
+}
+
+void deactivate_timer(frontend *fe)
+{
+	fe->timer = false;
+}
+
+static bool replay_read(void *ctx, void *buf, int len)
+{
+	FILE *fp = (FILE *)ctx;
+	return fread(buf, 1, len, fp) == (size_t)len;
+}
+
+static double replay_usec(clock_t start)
+{
+	return (double)(clock() - start) * 1000000.0 / CLOCKS_PER_SEC;
+}
+
+static void usage_exit(const char *msg)
+{
+	if (msg)
+		fprintf(stderr, "%s: %s\n", quis, msg);
+	fprintf(stderr, "Usage: %s [-q] [--bench ITERATIONS] <savefile> [savefile ...]\n", quis);
+	exit(1);
+}
+
+/* Play out any running animation or flash. Returns the number of frames drawn. */
+static int replay_settle(midend *me, frontend *fe)
+{
+	int frames = 0;
+
+	while(fe->timer && frames < REPLAY_MAXFRAMES)
+	{
+		midend_timer(me, REPLAY_FRAME);
+		frames++;
+	}
+
+	return frames;
+}
+
+static void replay_print(const char *name, const char *move, int frames,
+	const struct drawcount *dc, double usec)
+{
+	printf("%s\t%s\t%d\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t%.0f\n",
+		name, move, frames, drawcount_calls(dc),
+		dc->texts, dc->rects, dc->lines, dc->polygons, dc->circles,
+		dc->blits, dc->updates, dc->updatearea, dc->dirtypixels, usec);
+}
+
+static void replay_add(struct drawcount *total, const struct drawcount *dc)
+{
+	total->texts += dc->texts;
+	total->rects += dc->rects;
+	total->lines += dc->lines;
+	total->polygons += dc->polygons;
+	total->circles += dc->circles;
+	total->thicklines += dc->thicklines;
+	total->clips += dc->clips;
+	total->updates += dc->updates;
+	total->blits += dc->blits;
+	total->updatearea += dc->updatearea;
+	total->dirtypixels += dc->dirtypixels;
+}
+
+static bool replay_file(const char *filename, bool permove)
+{
+	frontend fe;
+	midend *me;
+	struct drawcount *dc = drawcount_new();
+	struct drawcount total;
+	FILE *fp;
+	const char *err;
+	char buf[16];
+	bool handled;
+	int x, y, move, frames, totalframes;
+	clock_t start;
+	double usec, totalusec;
+
+	fp = fopen(filename, "rb");
+	if(!fp)
+	{
+		fprintf(stderr, "%s: unable to open %s\n", quis, filename);
+		drawcount_free(dc);
+		return false;
+	}
+
+	fe.timer = false;
+	me = midend_new(&fe, &thegame, &drawcount_drawing, dc);
+	err = midend_deserialise(me, replay_read, fp);
+	fclose(fp);
+	if(err)
+	{
+		fprintf(stderr, "%s: %s: %s\n", quis, filename, err);
+		midend_free(me);
+		drawcount_free(dc);
+		return false;
+	}
+
+	x = y = INT_MAX;
+	midend_size(me, &x, &y, false, 1.0);
+	drawcount_set_size(dc, x, y);
+
+	/* Rewind to the first state without counting anything */
+	while(midend_can_undo(me))
+	{
+		midend_process_key(me, 0, 0, UI_UNDO, &handled);
+		replay_settle(me, &fe);
+	}
+
+	memset(&total, 0, sizeof(total));
+	totalframes = 0;
+	totalusec = 0;
+
+	for(move = 0; move == 0 || midend_can_redo(me); move++)
+	{
+		drawcount_reset(dc);
+		start = clock();
+		if(move == 0)
+			midend_force_redraw(me);
+		else
+			midend_process_key(me, 0, 0, UI_REDO, &handled);
+		frames = 1 + replay_settle(me, &fe);
+		usec = replay_usec(start);
+
+		if(permove)
+		{
+			sprintf(buf, "%d", move);
+			replay_print(thegame.name, buf, frames, dc, usec);
+		}
+
+		replay_add(&total, dc);
+		totalframes += frames;
+		totalusec += usec;
+	}
+
+	replay_print(thegame.name, "total", totalframes, &total, totalusec);
+
+	midend_free(me);
+	drawcount_free(dc);
+	return true;
+}
+
+/* ********* *
+ * Benchmark *
+ * ********* */
+
+struct replay_move {
+	bool restart;
+	char *str;
+};
+
+/*
+ * Read the move list of a savefile which has already been accepted
+ * by midend_deserialise. Every record is a padded keyword, a decimal
+ * length and that many bytes of data.
+ */
+static struct replay_move *replay_read_moves(FILE *fp, char **desc, int *nmoves)
+{
+	struct replay_move *ret = NULL;
+	int n = 0, size = 0;
+	char key[9], *val;
+	int c, i, len;
+
+	*desc = NULL;
+
+	while(true)
+	{
+		for(i = 0; i < 8; i++)
+		{
+			if((c = fgetc(fp)) == EOF)
+				goto done;
+			key[i] = c;
+		}
+		key[8] = '\0';
+		while(i > 0 && key[i-1] == ' ')
+			key[--i] = '\0';
+
+		if(fgetc(fp) != ':')
+			break;
+		len = 0;
+		while((c = fgetc(fp)) != ':')
+		{
+			if(c < '0' || c > '9')
+				goto done;
+			len = len*10 + (c - '0');
+		}
+
+		val = snewn(len+1, char);
+		if(fread(val, 1, len, fp) != (size_t)len)
+		{
+			sfree(val);
+			break;
+		}
+		val[len] = '\0';
+		fgetc(fp); /* newline */
+
+		if(!strcmp(key, "DESC") && !*desc)
+			*desc = val;
+		else if(!strcmp(key, "MOVE") || !strcmp(key, "SOLVE") ||
+			!strcmp(key, "RESTART"))
+		{
+			if(n >= size)
+			{
+				size = size * 2 + 16;
+				ret = sresize(ret, size, struct replay_move);
+			}
+			ret[n].restart = !strcmp(key, "RESTART");
+			ret[n].str = val;
+			n++;
+		}
+		else
+			sfree(val);
+	}
+
+done:
+	*nmoves = n;
+	return ret;
+}
+
+static void bench_print(const char *phase, long calls, double usec)
+{
+	printf("%s\t%s\t%ld\t%.0f\t%.1f\n", thegame.name, phase, calls, usec,
+		calls ? usec * 1000.0 / calls : 0.0);
+}
+
+static bool bench_file(const char *filename, int iterations)
+{
+	midend *me;
+	frontend fe;
+	FILE *fp;
+	const char *err;
+	char *desc;
+	game_params *params;
+	game_state **states, **copies;
+	struct replay_move *moves;
+	int nmoves, nstates, i, j;
+	long executes = 0, dups = 0, frees = 0;
+	double texecute = 0, tdup = 0, tfree = 0, tload;
+	clock_t start;
+
+	fp = fopen(filename, "rb");
+	if(!fp)
+	{
+		fprintf(stderr, "%s: unable to open %s\n", quis, filename);
+		return false;
+	}
+
+	fe.timer = false;
+	me = midend_new(&fe, &thegame, NULL, NULL);
+	start = clock();
+	err = midend_deserialise(me, replay_read, fp);
+	tload = replay_usec(start);
+	if(err)
+	{
+		fprintf(stderr, "%s: %s: %s\n", quis, filename, err);
+		fclose(fp);
+		midend_free(me);
+		return false;
+	}
+
+	rewind(fp);
+	moves = replay_read_moves(fp, &desc, &nmoves);
+	fclose(fp);
+	params = midend_get_params(me);
+	midend_free(me);
+	if(!desc)
+	{
+		fprintf(stderr, "%s: %s: no game description\n", quis, filename);
+		thegame.free_params(params);
+		sfree(moves);
+		return false;
+	}
+
+	bench_print("deserialise", 1, tload);
+
+	states = snewn(nmoves+1, game_state *);
+	copies = snewn(nmoves+1, game_state *);
+	for(i = 0; i < iterations; i++)
+	{
+		states[0] = thegame.new_game(NULL, params, desc);
+		nstates = 1;
+
+		start = clock();
+		for(j = 0; j < nmoves; j++)
+		{
+			if(moves[j].restart)
+				states[nstates] = thegame.new_game(NULL, params, moves[j].str);
+			else
+				states[nstates] = thegame.execute_move(states[nstates-1], moves[j].str);
+			if(!states[nstates])
+				break;
+			nstates++;
+		}
+		texecute += replay_usec(start);
+		executes += nstates - 1;
+
+		if(nstates - 1 != nmoves && i == 0)
+			fprintf(stderr, "%s: %s: move %d was rejected\n", quis, filename, nstates);
+
+		/* Duplicate every state in the chain, as the midend does for undo */
+		start = clock();
+		for(j = 0; j < nstates; j++)
+			copies[j] = thegame.dup_game(states[j]);
+		tdup += replay_usec(start);
+		dups += nstates;
+
+		start = clock();
+		for(j = 0; j < nstates; j++)
+			thegame.free_game(copies[j]);
+		tfree += replay_usec(start);
+		frees += nstates;
+
+		start = clock();
+		for(j = 0; j < nstates; j++)
+			thegame.free_game(states[j]);
+		tfree += replay_usec(start);
+		frees += nstates;
+	}
+
+	bench_print("execute_move", executes, texecute);
+	bench_print("dup_game", dups, tdup);
+	bench_print("free_game", frees, tfree);
+
+	for(j = 0; j < nmoves; j++)
+		sfree(moves[j].str);
+	sfree(moves);
+	sfree(states);
+	sfree(copies);
+	sfree(desc);
+	thegame.free_params(params);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	bool permove = true;
+	bool ok = true;
+	int i, nfiles = 0, iterations = 0;
+	char **files = snewn(argc, char *);
+
+	quis = argv[0];
+
+	while (--argc > 0)
+	{
+		char *p = *++argv;
+		if (!strcmp(p, "-q"))
+			permove = false;
+		else if (!strcmp(p, "--bench"))
+		{
+			if (argc <= 1)
+				usage_exit("--bench needs an argument");
+			iterations = atoi(*++argv);
+			if (iterations < 1)
+				usage_exit("--bench argument must be at least 1");
+			argc--;
+		}
+		else if (*p == '-')
+			usage_exit("unrecognised option");
+		else
+			files[nfiles++] = p;
+	}
+
+	if(!nfiles)
+		usage_exit("no savefiles given");
+
+	if(iterations)
+		printf("game\tphase\tcalls\tusec\tnsec_per_call\n");
+	else
+		printf("game\tmove\tframes\tcalls\ttext\trect\tline\tpolygon\tcircle"
+			"\tblit\tupdates\tupdatearea\tdirtypixels\tusec\n");
+
+	for(i = 0; i < nfiles; i++)
+	{
+		if(iterations ? !bench_file(files[i], iterations) : !replay_file(files[i], permove))
+			ok = false;
+	}
+
+	sfree(files);
+	return ok ? 0 : 1;
+}
@@ -36,6 +36,10 @@
 #include <math.h>
 
 #include "puzzles.h"
+#include "arena.h"
+#ifdef DESC_CODEC
+#include "desccodec.h"
+#endif
 
 enum {
 	COL_BACKGROUND,
@@ -274,7 +278,8 @@ static void free_game(game_state *state)
 enum { STATUS_COMPLETE, STATUS_INCOMPLETE, STATUS_INVALID };
 enum { VALID, INVALID_WALLS, INVALID_CLUES, INVALID_REGIONS, INVALID_GOALS };
 
-static char rome_validate_game(game_state *state, bool fullerrors, DSF *dsf, cell *sets)
+static char rome_validate_game(game_state *state, bool fullerrors, DSF *dsf, cell *sets,
+	struct arena *arena)
 {
 	int w = state->w;
 	int h = state->h;
@@ -282,6 +287,7 @@ static char rome_validate_game(game_state *state, bool fullerrors, DSF *dsf, cel
 	bool hasdsf = dsf != NULL;
 	bool hassets = sets != NULL;
 	char ret = STATUS_COMPLETE;
+	struct arena_mark mark = arena_mark(arena);
 	cell *seterrs;
 	
 	for(i = 0; i < w*h; i++)
@@ -291,8 +297,8 @@ static char rome_validate_game(game_state *state, bool fullerrors, DSF *dsf, cel
 		dsf = dsf_new_min(w*h);
 	dsf_reinit(dsf);
 	if(!hassets)
-		sets = snewn(w*h, cell);
-	seterrs = snewn(w*h, cell);
+		sets = arena_newn(arena, w*h, cell);
+	seterrs = arena_newn(arena, w*h, cell);
 	
 	memset(sets, EMPTY, w*h*sizeof(cell));
 	memset(seterrs, EMPTY, w*h*sizeof(cell));
@@ -409,9 +415,7 @@ static char rome_validate_game(game_state *state, bool fullerrors, DSF *dsf, cel
 	
 	if(!hasdsf)
 		dsf_free(dsf);
-	if(!hassets)
-		sfree(sets);
-	sfree(seterrs);
+	arena_release(arena, mark);
 	
 	for(i = 0; i < w*h; i++)
 	{
@@ -423,12 +427,55 @@ static char rome_validate_game(game_state *state, bool fullerrors, DSF *dsf, cel
 	return ret;
 }
 
+/* Validate a game outside of the solver, with scratch of its own */
+static char rome_validate_state(game_state *state)
+{
+	struct arena *arena = arena_new();
+	char ret = rome_validate_game(state, true, NULL, NULL, arena);
+	arena_free(arena);
+	return ret;
+}
+
+/*
+ * Walls are listed for each pair of horizontally adjacent squares, row
+ * by row, then for each pair of vertically adjacent squares.
+ */
+static void rome_merge_walls(game_state *state, const char *walls)
+{
+	int w = state->w;
+	int h = state->h;
+	int hs = ((w-1)*h);
+	int x, y, i, i1, i2;
+	
+	/* Merge horizontally */
+	for(y = 0; y < h; y++)
+	for(x = 0; x < w-1; x++)
+	{
+		i = (y*(w-1))+x;
+		i1 = y*w+x;
+		i2 = y*w+x+1;
+		if(!walls[i])
+			dsf_merge(state->dsf, i1, i2);
+	}
+	
+	/* Merge vertically */
+	for(y = 0; y < h-1; y++)
+	for(x = 0; x < w; x++)
+	{
+		i = hs + (y*w+x);
+		i1 = y*w+x;
+		i2 = (y+1)*w+x;
+		if(!walls[i])
+			dsf_merge(state->dsf, i1, i2);
+	}
+}
+
 static int rome_read_desc(const game_params *params, const char *desc, game_state **retstate)
 {
 	int w = params->w;
 	int h = params->h;
 	int valid = VALID;
-	int x, y, i, i1, i2, erun, wrun;
+	int i, erun, wrun;
 	game_state *state = snew(game_state);
 	int hs = ((w-1)*h);
 	int ws = hs + (w*(h-1));
@@ -487,34 +534,15 @@ static int rome_read_desc(const game_params *params, const char *desc, game_stat
 		}
 	}
 	
-	/* Merge horizontally */
-	for(y = 0; y < h; y++)
-	for(x = 0; x < w-1; x++)
-	{
-		i = (y*(w-1))+x;
-		i1 = y*w+x;
-		i2 = y*w+x+1;
-		if(!walls[i])
-			dsf_merge(state->dsf, i1, i2);
-	}
-	
-	/* Merge vertically */
-	for(y = 0; y < h-1; y++)
-	for(x = 0; x < w; x++)
-	{
-		i = hs + (y*w+x);
-		i1 = y*w+x;
-		i2 = (y+1)*w+x;
-		if(!walls[i])
-			dsf_merge(state->dsf, i1, i2);
-	}
+	rome_merge_walls(state, walls);
 	
-	p++;
+	if(*p)
+		p++;
 	erun = 0;
 	for(i = 0; i < w*h; i++)
 	{
 		char c = 0;
-		if (erun == 0)
+		if (erun == 0 && *p)
 		{
 			c = *p++;
 			if (c >= 'a' && c <= 'z')
@@ -564,7 +592,7 @@ static game_state *new_game(midend *me, const game_params *params, const char *d
 	
 	assert(state);
 	
-	rome_validate_game(state, true, NULL, NULL);
+	rome_validate_state(state);
 	
 	return state;
 }
@@ -579,7 +607,7 @@ static const char *validate_desc(const game_params *params, const char *desc)
 	
 	if(valid == VALID)
 	{
-		status = rome_validate_game(state, true, NULL, NULL);
+		status = rome_validate_state(state);
 		if(status != STATUS_INCOMPLETE)
 		{
 			free_game(state);
@@ -594,10 +622,10 @@ static const char *validate_desc(const game_params *params, const char *desc)
 			if(state->grid[i] & FM_GOAL && size > 1)
 				valid = INVALID_GOALS;
 		}
-		
-		free_game(state);
 	}
 	
+	free_game(state);
+	
 	if(valid == INVALID_WALLS)
 		return "Region description contains invalid characters";
 	if(valid == INVALID_CLUES)
@@ -637,399 +665,821 @@ static game_state *dup_game(const game_state *state)
  * Solver *
  * ****** */
  
-static int rome_solver_single(game_state *state)
+/*
+ * Every technique works on either single squares or entire regions. The
+ * solver keeps a dirty flag for each square or region a technique can
+ * work on, and only sets it when a mark or arrow changes nearby. A
+ * technique without dirty flags is skipped, since it would not find
+ * anything new. The techniques are still tried in order of difficulty,
+ * starting over from the easiest one after every change, and each one
+ * visits its dirty squares in grid order like a full sweep would.
+ */
+#define TECHLIST(A) \
+	A(SINGLE,single,EASY) \
+	A(DOUBLES,doubles,EASY) \
+	A(LOOPS,loops,EASY) \
+	A(FIND4,find4,NORMAL) \
+	A(PAIRS,pairs,NORMAL) \
+	A(EXPAND,expand,NORMAL) \
+	A(OPPOSITES,opposites,TRICKY) \
+
+#define TECHENUM(upper,lower,diff) TECH_ ## upper,
+#define TECHNAME(upper,lower,diff) #lower,
+#define TECHDIFF(upper,lower,diff) DIFF_ ## diff,
+enum { TECHLIST(TECHENUM) TECHCOUNT };
+static const int rome_techdiffs[] = { TECHLIST(TECHDIFF) };
+
+struct rome_solver {
+	game_state *state;
+	int w, h;
+
+	/* Repeat every technique on the entire grid, for benchmarking */
+	bool restart;
+	/* Holds the solver and its arrays, and the scratch for validating */
+	struct arena *arena;
+
+	/* Arrows pointing at each other */
+	DSF *dsf;
+	/* Arrows placed in each region */
+	cell *sets;
+	/* Empty square or goal at the end of each chain of arrows */
+	cell *sinks;
+
+	int empty;
+	char status;
+	/* Hardest difficulty level of the techniques which made progress */
+	int diff;
+
+	/* The squares of each region, indexed by the first square */
+	int *regcells;
+	int *regstart;
+
+	bool *dirty[TECHCOUNT];
+	int ndirty[TECHCOUNT];
+	/* No square before this one is flagged */
+	int firstdirty[TECHCOUNT];
+
+	/* Technique invocations, and squares visited by each technique */
+	long calls[TECHCOUNT];
+	long visits[TECHCOUNT];
+	long checks, checkvisits;
+	/* Invocations which made progress */
+	long uses[TECHCOUNT];
+};
+
+static void rome_solver_dirty(struct rome_solver *solver, int tech, int i)
 {
-	/* If a square has a single possibility, place it */
-	int ret = 0;
-	int i;
-	int s = state->w * state->h;
-	
+	if(!solver->dirty[tech][i])
+	{
+		solver->dirty[tech][i] = true;
+		solver->ndirty[tech]++;
+		if(i < solver->firstdirty[tech])
+			solver->firstdirty[tech] = i;
+	}
+}
+
+static bool rome_solver_to_goal(struct rome_solver *solver, int i)
+{
+	cell sink = solver->sinks[dsf_canonify(solver->dsf, i)];
+	return (solver->state->grid[sink] & FM_GOAL) != 0;
+}
+
+/* Flag the techniques which can use a square with fewer possibilities */
+static void rome_solver_marks_changed(struct rome_solver *solver, int i)
+{
+	game_state *state = solver->state;
+	int w = solver->w, h = solver->h;
+	int x = i%w, y = i/w;
+	int c = dsf_canonify(state->dsf, i);
+	int size = dsf_size(state->dsf, i);
+
+	rome_solver_dirty(solver, TECH_SINGLE, i);
+	rome_solver_dirty(solver, TECH_OPPOSITES, i);
+	if(size == 4)
+		rome_solver_dirty(solver, TECH_FIND4, c);
+	if(size >= 3)
+		rome_solver_dirty(solver, TECH_PAIRS, c);
+
+	if((y > 0 && rome_solver_to_goal(solver, i-w)) ||
+		(y < h-1 && rome_solver_to_goal(solver, i+w)) ||
+		(x > 0 && rome_solver_to_goal(solver, i-1)) ||
+		(x < w-1 && rome_solver_to_goal(solver, i+1)))
+		rome_solver_dirty(solver, TECH_EXPAND, 0);
+}
+
+static void rome_solver_remove(struct rome_solver *solver, int i, cell marks)
+{
+	solver->state->marks[i] &= ~marks;
+	rome_solver_marks_changed(solver, i);
+}
+
+/*
+ * Place an arrow, and keep track of the validity of the grid. This does
+ * the same checks as rome_validate_game, for only the new arrow.
+ */
+static void rome_solver_place(struct rome_solver *solver, int i, cell arrow)
+{
+	game_state *state = solver->state;
+	int w = solver->w, h = solver->h;
+	int x = i%w, y = i/w;
+	int r, j, sink;
+
+	state->grid[i] = arrow;
+	solver->empty--;
+	if(solver->restart)
+		return;
+
+	solver->checkvisits++;
+
+	if((arrow == FM_UP && y == 0) || (arrow == FM_DOWN && y == h-1) ||
+		(arrow == FM_LEFT && x == 0) || (arrow == FM_RIGHT && x == w-1))
+	{
+		solver->status = STATUS_INVALID;
+		return;
+	}
+	j = arrow == FM_UP ? i-w : arrow == FM_DOWN ? i+w :
+		arrow == FM_LEFT ? i-1 : i+1;
+
+	r = dsf_canonify(state->dsf, i);
+	if(solver->sets[r] & arrow)
+		solver->status = STATUS_INVALID;
+	solver->sets[r] |= arrow;
+	rome_solver_dirty(solver, TECH_DOUBLES, r);
+
+	if(dsf_canonify(solver->dsf, i) == dsf_canonify(solver->dsf, j))
+	{
+		solver->status = STATUS_INVALID;
+		return;
+	}
+
+	/*
+	 * The chain starting at this square now ends at the same square
+	 * as the chain it points to. That square is the only one which
+	 * can gain a loop, and if it is a goal, its area has grown.
+	 */
+	sink = solver->sinks[dsf_canonify(solver->dsf, j)];
+	dsf_merge(solver->dsf, i, j);
+	solver->sinks[dsf_canonify(solver->dsf, i)] = sink;
+
+	rome_solver_dirty(solver, TECH_LOOPS, i);
+	rome_solver_dirty(solver, TECH_LOOPS, sink);
+	if(state->grid[sink] & FM_GOAL)
+		rome_solver_dirty(solver, TECH_EXPAND, 0);
+
+	if(solver->empty == 0 && solver->status == STATUS_INCOMPLETE)
+		solver->status = STATUS_COMPLETE;
+}
+
+static void rome_solver_find_sinks(struct rome_solver *solver)
+{
+	game_state *state = solver->state;
+	int i, s = solver->w * solver->h;
+
 	for(i = 0; i < s; i++)
 	{
-		if(state->grid[i] != EMPTY)
+		if(!(state->grid[i] & FM_ARROWMASK))
+			solver->sinks[dsf_canonify(solver->dsf, i)] = i;
+	}
+}
+
+/*
+ * The solver is allocated from the arena, which must not be released
+ * past this point until after rome_solver_free.
+ */
+static struct rome_solver *rome_solver_new(game_state *state, bool restart,
+	struct arena *arena)
+{
+	int w = state->w;
+	int h = state->h;
+	int s = w*h;
+	int i, c, t, n;
+	struct rome_solver *solver = arena_newn(arena, 1, struct rome_solver);
+
+	solver->state = state;
+	solver->w = w;
+	solver->h = h;
+	solver->restart = restart;
+	solver->arena = arena;
+	solver->dsf = dsf_new_min(s);
+	solver->sets = arena_newn(arena, s, cell);
+	solver->sinks = arena_newn(arena, s, cell);
+	solver->regcells = arena_newn(arena, s, int);
+	solver->regstart = arena_newn(arena, s, int);
+
+	for(t = 0; t < TECHCOUNT; t++)
+	{
+		solver->dirty[t] = arena_newn(arena, s, bool);
+		memset(solver->dirty[t], 0, s*sizeof(bool));
+		solver->ndirty[t] = 0;
+		solver->firstdirty[t] = s;
+		solver->calls[t] = solver->visits[t] = solver->uses[t] = 0;
+	}
+	solver->checks = solver->checkvisits = 0;
+	solver->diff = DIFF_EASY;
+
+	/* List the squares of each region in grid order */
+	n = 0;
+	for(i = 0; i < s; i++)
+	{
+		if(dsf_canonify(state->dsf, i) != i)
 			continue;
-		
-		if(state->marks[i] == FM_UP)
-		{
-			state->grid[i] = FM_UP;
-			ret++;
-		}
-		if(state->marks[i] == FM_DOWN)
-		{
-			state->grid[i] = FM_DOWN;
-			ret++;
-		}
-		if(state->marks[i] == FM_LEFT)
-		{
-			state->grid[i] = FM_LEFT;
-			ret++;
-		}
-		if(state->marks[i] == FM_RIGHT)
-		{
-			state->grid[i] = FM_RIGHT;
-			ret++;
-		}
+		solver->regstart[i] = n;
+		n += dsf_size(state->dsf, i);
 	}
-	
-	return ret;
+	for(i = 0; i < s; i++)
+	{
+		c = dsf_canonify(state->dsf, i);
+		solver->regcells[solver->regstart[c]++] = i;
+	}
+	for(i = 0; i < s; i++)
+	{
+		if(dsf_canonify(state->dsf, i) == i)
+			solver->regstart[i] -= dsf_size(state->dsf, i);
+	}
+
+	return solver;
 }
 
-static int rome_solver_doubles(game_state *state, cell *sets)
+static void rome_solver_free(struct rome_solver *solver)
 {
-	/* Look at the currently placed arrows in each region, 
+	dsf_free(solver->dsf);
+}
+
+static int rome_solver_single(struct rome_solver *solver, int i)
+{
+	/* If a square has a single possibility, place it */
+	game_state *state = solver->state;
+	cell marks = state->marks[i];
+
+	if(state->grid[i] != EMPTY)
+		return 0;
+
+	if(marks == FM_UP || marks == FM_DOWN || marks == FM_LEFT || marks == FM_RIGHT)
+	{
+		rome_solver_place(solver, i, marks);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int rome_solver_doubles(struct rome_solver *solver, int c)
+{
+	/* Look at the currently placed arrows in a region,
 	 * and rule these out as possibilities */
+	game_state *state = solver->state;
 	int ret = 0;
-	int i;
-	int s = state->w * state->h;
-	cell prev;
-	
-	for(i = 0; i < s; i++)
+	int j, i;
+	int size = dsf_size(state->dsf, c);
+	const int *cells = solver->regcells + solver->regstart[c];
+
+	solver->visits[TECH_DOUBLES] += size;
+	for(j = 0; j < size; j++)
 	{
-		prev = state->marks[i];
-		state->marks[i] &= ~(sets[dsf_canonify(state->dsf, i)]);
-		
-		if(prev != state->marks[i])
+		i = cells[j];
+		if(state->marks[i] & solver->sets[c])
+		{
+			rome_solver_remove(solver, i, solver->sets[c]);
 			ret++;
+		}
 	}
-	
+
 	return ret;
 }
 
-static int rome_solver_loops(game_state *state, DSF *dsf)
+static int rome_solver_loops(struct rome_solver *solver, int i)
 {
 	/* Find nearby squares that would form a loop */
-	int w = state->w;
-	int h = state->h;
-	int x, y;
+	game_state *state = solver->state;
+	DSF *dsf = solver->dsf;
+	int w = solver->w;
 	int ret = 0;
-	
-	for(y = 0; y < h; y++)
-	for(x = 0; x < w; x++)
+
+	if(state->marks[i] & FM_UP &&
+		dsf_canonify(dsf, i) == dsf_canonify(dsf, i-w))
 	{
-		if(state->marks[y*w+x] & FM_UP && 
-			dsf_canonify(dsf, y*w+x) == dsf_canonify(dsf, (y-1)*w+x))
-		{
-			state->marks[y*w+x] &= ~FM_UP;
-			ret++;
-		}
-		if(state->marks[y*w+x] & FM_DOWN && 
-			dsf_canonify(dsf, y*w+x) == dsf_canonify(dsf, (y+1)*w+x))
-		{
-			state->marks[y*w+x] &= ~FM_DOWN;
-			ret++;
-		}
-		if(state->marks[y*w+x] & FM_LEFT && 
-			dsf_canonify(dsf, y*w+x) == dsf_canonify(dsf, y*w+x-1))
-		{
-			state->marks[y*w+x] &= ~FM_LEFT;
-			ret++;
-		}
-		if(state->marks[y*w+x] & FM_RIGHT && 
-			dsf_canonify(dsf, y*w+x) == dsf_canonify(dsf, y*w+x+1))
-		{
-			state->marks[y*w+x] &= ~FM_RIGHT;
-			ret++;
-		}
+		rome_solver_remove(solver, i, FM_UP);
+		ret++;
 	}
-	
+	if(state->marks[i] & FM_DOWN &&
+		dsf_canonify(dsf, i) == dsf_canonify(dsf, i+w))
+	{
+		rome_solver_remove(solver, i, FM_DOWN);
+		ret++;
+	}
+	if(state->marks[i] & FM_LEFT &&
+		dsf_canonify(dsf, i) == dsf_canonify(dsf, i-1))
+	{
+		rome_solver_remove(solver, i, FM_LEFT);
+		ret++;
+	}
+	if(state->marks[i] & FM_RIGHT &&
+		dsf_canonify(dsf, i) == dsf_canonify(dsf, i+1))
+	{
+		rome_solver_remove(solver, i, FM_RIGHT);
+		ret++;
+	}
+
 	return ret;
 }
 
-static int rome_find4_position(game_state *state)
+static int rome_find4_position(struct rome_solver *solver, int c)
 {
-	/* In a region of 4 squares, find if a certain arrow can be placed 
+	/* In a region of 4 squares, find if a certain arrow can be placed
 		in only one square */
+	game_state *state = solver->state;
 	int ret = 0;
-	int i, c;
-	cell prev;
-	int s = state->w * state->h;
-	cell *singles = snewn(s, cell);
-	cell *doubles = snewn(s, cell);
-	
-	memset(singles, EMPTY, s*sizeof(cell));
-	memset(doubles, EMPTY, s*sizeof(cell));
-	
-	for(i = 0; i < s; i++)
+	int i, j;
+	cell singles = EMPTY, doubles = EMPTY, unique;
+	const int *cells = solver->regcells + solver->regstart[c];
+
+	if(dsf_size(state->dsf, c) != 4)
+		return 0;
+
+	solver->visits[TECH_FIND4] += 4;
+	for(j = 0; j < 4; j++)
 	{
-		if(dsf_size(state->dsf, i) != 4)
-			continue;
-		
-		c = dsf_canonify(state->dsf, i);
-		doubles[c] |= state->marks[i] & singles[c];
-		singles[c] |= state->marks[i];
+		i = cells[j];
+		doubles |= state->marks[i] & singles;
+		singles |= state->marks[i];
 	}
-	
-	for(i = 0; i < s; i++)
+
+	unique = singles ^ doubles;
+	for(j = 0; j < 4; j++)
 	{
-		if(dsf_size(state->dsf, i) != 4)
-			continue;
-		
-		c = dsf_canonify(state->dsf, i);
-		prev = state->marks[i];
-		if(state->marks[i] & (singles[c] ^ doubles[c]))
-			state->marks[i] &= singles[c] ^ doubles[c];
-		
-		if(prev != state->marks[i])
+		i = cells[j];
+		if(state->marks[i] & unique && state->marks[i] & ~unique)
+		{
+			rome_solver_remove(solver, i, ~unique);
 			ret++;
+		}
 	}
-	
-	sfree(singles);
-	sfree(doubles);
+
 	return ret;
 }
 
-static int rome_naked_pairs(game_state *state)
+static int rome_naked_pairs(struct rome_solver *solver, int c)
 {
 	/* In a region, find two squares with the same possibilities, which must be
 		exactly two. Then rule out these possibilities in the other squares
 		in this region */
+	game_state *state = solver->state;
 	int ret = 0;
-	int i, j, k, c;
+	int i, j, k, ci, cj, ck;
 	int poss;
-	cell prev;
-	int s = state->w * state->h;
-	
-	for(i = 0; i < s; i++)
+	int size = dsf_size(state->dsf, c);
+	const int *cells = solver->regcells + solver->regstart[c];
+
+	if(size < 3)
+		return 0;
+
+	solver->visits[TECH_PAIRS] += size;
+	for(ci = 0; ci < size; ci++)
 	{
-		if(dsf_size(state->dsf, i) < 3)
-			continue;
-		
+		i = cells[ci];
+
 		/* Get the number of possibilities */
 		poss = ((state->marks[i] & FM_UP) / FM_UP) +
 			((state->marks[i] & FM_DOWN) / FM_DOWN) +
 			((state->marks[i] & FM_LEFT) / FM_LEFT) +
 			((state->marks[i] & FM_RIGHT) / FM_RIGHT);
-		
+
 		if(poss == 2)
 		{
-			c = dsf_canonify(state->dsf, i);
 			/* Find the second one */
-			for(j = i+1; j < s; j++)
+			for(cj = ci+1; cj < size; cj++)
 			{
-				if(state->marks[j] != state->marks[i] || 
-					c != dsf_canonify(state->dsf, j))
+				j = cells[cj];
+				if(state->marks[j] != state->marks[i])
 					continue;
-				
+
 				/* We found two squares. Now look for the other ones */
-				for(k = c; k < s; k++)
+				for(ck = 0; ck < size; ck++)
 				{
-					if(k == i || k == j || c != dsf_canonify(state->dsf, k))
+					k = cells[ck];
+					if(k == i || k == j)
 						continue;
-					
-					prev = state->marks[k];
-					state->marks[k] &= ~(state->marks[i]);
-					if(state->marks[k] != prev)
+
+					if(state->marks[k] & state->marks[i])
+					{
+						rome_solver_remove(solver, k, state->marks[i]);
 						ret++;
+					}
 				}
 			}
 		}
 	}
-	
+
 	return ret;
 }
 
-static int rome_solver_expand(game_state *state, DSF *dsf)
+static int rome_solver_expand(struct rome_solver *solver)
 {
 	/* Check if there is one single possibility to expand the area pointing
 	   to a goal. */
-	
-	int i, c, x, y, i1, i2;
-	int w = state->w;
-	int h = state->h;
+
+	game_state *state = solver->state;
+	int x, y, i1;
+	int w = solver->w;
+	int h = solver->h;
 	cell dir = EMPTY;
 	int idx = -1;
-	
-	for(i = 0; i < w*h; i++)
+
+	solver->visits[TECH_EXPAND] += w*h;
+	for(y = 0; y < h; y++)
+	for(x = 0; x < w; x++)
 	{
-		if(state->grid[i] & FM_GOAL)
+		i1 = y*w+x;
+
+		if(x < w-1 && state->marks[i1] & FM_RIGHT && rome_solver_to_goal(solver, i1+1))
 		{
-			c = dsf_canonify(dsf, i);
-			
-			for(y = 0; y < h; y++)
-			for(x = 0; x < w; x++)
-			{
-				i1 = y*w+x;
-				
-				i2 = y*w+x+1;
-				if(x < w-1 && dsf_canonify(dsf, i2) == c && state->marks[i1] & FM_RIGHT)
-				{
-					if(dir != EMPTY)
-						return 0;
-					
-					dir = FM_RIGHT;
-					idx = i1;
-				}
-				
-				i2 = y*w+x-1;
-				if(x > 0 && dsf_canonify(dsf, i2) == c && state->marks[i1] & FM_LEFT)
-				{
-					if(dir != EMPTY)
-						return 0;
-					
-					dir = FM_LEFT;
-					idx = i1;
-				}
-				
-				i2 = (y+1)*w+x;
-				if(y < h-1 && dsf_canonify(dsf, i2) == c && state->marks[i1] & FM_DOWN)
-				{
-					if(dir != EMPTY)
-						return 0;
-					
-					dir = FM_DOWN;
-					idx = i1;
-				}
-				
-				i2 = (y-1)*w+x;
-				if(y > 0 && dsf_canonify(dsf, i2) == c && state->marks[i1] & FM_UP)
-				{
-					if(dir != EMPTY)
-						return 0;
-					
-					dir = FM_UP;
-					idx = i1;
-				}
-			}
+			if(dir != EMPTY)
+				return 0;
+
+			dir = FM_RIGHT;
+			idx = i1;
+		}
+
+		if(x > 0 && state->marks[i1] & FM_LEFT && rome_solver_to_goal(solver, i1-1))
+		{
+			if(dir != EMPTY)
+				return 0;
+
+			dir = FM_LEFT;
+			idx = i1;
+		}
+
+		if(y < h-1 && state->marks[i1] & FM_DOWN && rome_solver_to_goal(solver, i1+w))
+		{
+			if(dir != EMPTY)
+				return 0;
+
+			dir = FM_DOWN;
+			idx = i1;
+		}
+
+		if(y > 0 && state->marks[i1] & FM_UP && rome_solver_to_goal(solver, i1-w))
+		{
+			if(dir != EMPTY)
+				return 0;
+
+			dir = FM_UP;
+			idx = i1;
 		}
 	}
-	
-	if(dir != EMPTY)
+
+	if(dir != EMPTY && state->marks[idx] != dir)
 	{
-		state->marks[idx] = dir;
+		rome_solver_remove(solver, idx, ~dir);
 		return 1;
 	}
-	
+
 	return 0;
 }
 
-static int rome_solver_opposites(game_state *state)
+static int rome_solver_opposites(struct rome_solver *solver, int i1)
 {
 	/* A square with only up/down as possibilities can not be pointed at
-
-	   by another up or down arrow in the same region. 
+	   by another up or down arrow in the same region.
 	   The same goes for left/right. */
-	
+
+	game_state *state = solver->state;
 	int ret = 0;
-	int w = state->w;
-	int h = state->h;
-	int x, y, i1, i2, c;
-	
-	for(y = 0; y < h; y++)
-	for(x = 0; x < w; x++)
+	int w = solver->w;
+	int i2, c;
+
+	if(state->marks[i1] == (FM_UP|FM_DOWN))
 	{
-		i1 = y*w+x;
-		
-		if(state->marks[i1] == (FM_UP|FM_DOWN))
+		c = dsf_canonify(state->dsf, i1);
+		i2 = i1-w;
+		if(state->marks[i2] & FM_DOWN && dsf_canonify(state->dsf, i2) == c)
 		{
-			c = dsf_canonify(state->dsf, i1);
-			i2 = (y-1)*w+x;
-			if(state->marks[i2] & FM_DOWN && dsf_canonify(state->dsf, i2) == c)
-			{
-				state->marks[i2] &= ~FM_DOWN;
-				ret++;
-			}
-			
-			i2 = (y+1)*w+x;
-			if(state->marks[i2] & FM_UP && dsf_canonify(state->dsf, i2) == c)
-			{
-				state->marks[i2] &= ~FM_UP;
-				ret++;
-			}
+			rome_solver_remove(solver, i2, FM_DOWN);
+			ret++;
 		}
-		
-		if(state->marks[i1] == (FM_LEFT|FM_RIGHT))
+
+		i2 = i1+w;
+		if(state->marks[i2] & FM_UP && dsf_canonify(state->dsf, i2) == c)
 		{
-			c = dsf_canonify(state->dsf, i1);
-			i2 = y*w+x-1;
-			if(state->marks[i2] & FM_RIGHT && dsf_canonify(state->dsf, i2) == c)
-			{
-				state->marks[i2] &= ~FM_RIGHT;
-				ret++;
-			}
-			
-			i2 = y*w+x+1;
-			if(state->marks[i2] & FM_LEFT && dsf_canonify(state->dsf, i2) == c)
-			{
-				state->marks[i2] &= ~FM_LEFT;
-				ret++;
-			}
+			rome_solver_remove(solver, i2, FM_UP);
+			ret++;
 		}
 	}
-	
+
+	if(state->marks[i1] == (FM_LEFT|FM_RIGHT))
+	{
+		c = dsf_canonify(state->dsf, i1);
+		i2 = i1-1;
+		if(state->marks[i2] & FM_RIGHT && dsf_canonify(state->dsf, i2) == c)
+		{
+			rome_solver_remove(solver, i2, FM_RIGHT);
+			ret++;
+		}
+
+		i2 = i1+1;
+		if(state->marks[i2] & FM_LEFT && dsf_canonify(state->dsf, i2) == c)
+		{
+			rome_solver_remove(solver, i2, FM_LEFT);
+			ret++;
+		}
+	}
+
 	return ret;
 }
 
-static char rome_solve(game_state *state, int maxdiff)
+/*
+ * Run a technique on every square or region which was flagged for it,
+ * in grid order. Squares which are flagged during the sweep are visited
+ * in the same sweep if they come later in the grid.
+ */
+static int rome_solver_technique(struct rome_solver *solver, int tech)
 {
-	int w = state->w;
-	int h = state->h;
-	int i;
-	char status;
-	
-	DSF *dsf = dsf_new_min(w*h);
-	cell *sets = snewn(w*h, cell);
-	
-	/* Initialize all marks */
-	for(i = 0; i < w*h; i++)
+	game_state *state = solver->state;
+	int s = solver->w * solver->h;
+	int i, ret = 0;
+
+	if(!solver->restart && !solver->ndirty[tech])
+		return 0;
+
+	solver->calls[tech]++;
+
+	if(tech == TECH_EXPAND)
 	{
-		if(state->grid[i] == EMPTY)
-			state->marks[i] = FM_ARROWMASK;
-		else
-			state->marks[i] = state->grid[i] & FM_ARROWMASK;
+		solver->dirty[tech][0] = false;
+		solver->ndirty[tech] = 0;
+		ret = rome_solver_expand(solver);
+		if(ret)
+		{
+			solver->diff = max(solver->diff, rome_techdiffs[tech]);
+			solver->uses[tech]++;
+		}
+		return ret;
 	}
-	
-	/* Disable marks near borders */
-	for(i = 0; i < w; i++)
+
+	i = solver->restart ? 0 : solver->firstdirty[tech];
+	solver->firstdirty[tech] = s;
+	for(; i < s && (solver->restart || solver->ndirty[tech]); i++)
 	{
-		state->marks[i] &= ~FM_UP;
-		state->marks[(h-1)*w+i] &= ~FM_DOWN;
+		if(solver->dirty[tech][i])
+		{
+			solver->dirty[tech][i] = false;
+			solver->ndirty[tech]--;
+		}
+		else if(!solver->restart)
+			continue;
+
+		switch(tech)
+		{
+		case TECH_SINGLE:
+			solver->visits[tech]++;
+			ret += rome_solver_single(solver, i);
+			break;
+		case TECH_DOUBLES:
+			if(dsf_canonify(state->dsf, i) == i)
+				ret += rome_solver_doubles(solver, i);
+			break;
+		case TECH_LOOPS:
+			solver->visits[tech]++;
+			ret += rome_solver_loops(solver, i);
+			break;
+		case TECH_FIND4:
+			if(dsf_canonify(state->dsf, i) == i)
+				ret += rome_find4_position(solver, i);
+			break;
+		case TECH_PAIRS:
+			if(dsf_canonify(state->dsf, i) == i)
+				ret += rome_naked_pairs(solver, i);
+			break;
+		case TECH_OPPOSITES:
+			solver->visits[tech]++;
+			ret += rome_solver_opposites(solver, i);
+			break;
+		}
 	}
-	for(i = 0; i < h; i++)
+
+	if(ret)
 	{
-		state->marks[i*w] &= ~FM_LEFT;
-		state->marks[i*w+(w-1)] &= ~FM_RIGHT;
+		solver->diff = max(solver->diff, rome_techdiffs[tech]);
+		solver->uses[tech]++;
 	}
-	
+
+	return ret;
+}
+
+/* Bring the arrow chains and region contents up to date with the grid */
+static void rome_solver_check(struct rome_solver *solver)
+{
+	int i, s = solver->w * solver->h;
+
+	solver->checks++;
+	solver->checkvisits += s;
+	solver->status = rome_validate_game(solver->state, false, solver->dsf, solver->sets,
+		solver->arena);
+	rome_solver_find_sinks(solver);
+
+	solver->empty = 0;
+	for(i = 0; i < s; i++)
+	{
+		if(solver->state->grid[i] == EMPTY)
+			solver->empty++;
+	}
+}
+
+/* Continue from another solver's position on the same puzzle */
+static void rome_solver_copy(struct rome_solver *solver, struct rome_solver *from)
+{
+	int t, s = solver->w * solver->h;
+
+	memcpy(solver->state->grid, from->state->grid, s*sizeof(cell));
+	memcpy(solver->state->marks, from->state->marks, s*sizeof(cell));
+	dsf_copy(solver->dsf, from->dsf);
+	memcpy(solver->sets, from->sets, s*sizeof(cell));
+	memcpy(solver->sinks, from->sinks, s*sizeof(cell));
+
+	for(t = 0; t < TECHCOUNT; t++)
+	{
+		memcpy(solver->dirty[t], from->dirty[t], s*sizeof(bool));
+		solver->ndirty[t] = from->ndirty[t];
+		solver->firstdirty[t] = from->firstdirty[t];
+	}
+
+	solver->empty = from->empty;
+	solver->status = from->status;
+	solver->diff = from->diff;
+}
+
+/*
+ * Add a clue to a grid the solver has already worked on. The marks
+ * remain valid, as a clue can only rule out more possibilities.
+ */
+static void rome_solver_add(struct rome_solver *solver, int i, cell arrow)
+{
+	game_state *state = solver->state;
+
+	if(state->grid[i] != EMPTY)
+	{
+		if((state->grid[i] & FM_ARROWMASK) != arrow)
+			solver->status = STATUS_INVALID;
+		return;
+	}
+
+	state->marks[i] = arrow;
+	rome_solver_marks_changed(solver, i);
+	rome_solver_place(solver, i, arrow);
+}
+
+static char rome_solver_propagate(struct rome_solver *solver, int maxdiff)
+{
 	while(true)
 	{
-		status = rome_validate_game(state, false, dsf, sets);
-		if(status != STATUS_INCOMPLETE)
+		if(solver->restart)
+			rome_solver_check(solver);
+		if(solver->status != STATUS_INCOMPLETE)
 			break;
-		
-		if(rome_solver_single(state))
+
+		if(rome_solver_technique(solver, TECH_SINGLE))
 			continue;
-		
-		if(rome_solver_doubles(state, sets))
+
+		if(rome_solver_technique(solver, TECH_DOUBLES))
 			continue;
-		
-		if(rome_solver_loops(state, dsf))
+
+		if(rome_solver_technique(solver, TECH_LOOPS))
 			continue;
-		
+
 		if(maxdiff < DIFF_NORMAL)
 			break;
-		
-		if(rome_find4_position(state))
+
+		if(rome_solver_technique(solver, TECH_FIND4))
 			continue;
-		
-		if(rome_naked_pairs(state))
+
+		if(rome_solver_technique(solver, TECH_PAIRS))
 			continue;
-		
-		if(rome_solver_expand(state, dsf))
+
+		if(rome_solver_technique(solver, TECH_EXPAND))
 			continue;
-		
+
 		if(maxdiff < DIFF_TRICKY)
 			break;
-		
-		if(rome_solver_opposites(state))
+
+		if(rome_solver_technique(solver, TECH_OPPOSITES))
 			continue;
-		
+
 		break;
 	}
-	
-	dsf_free(dsf);
-	sfree(sets);
-	
-	return status;
+
+	return solver->status;
+}
+
+/* Leave the error flags in the grid, like the validation would */
+static char rome_solver_finish(struct rome_solver *solver)
+{
+	if(!solver->restart)
+	{
+		char status = solver->status;
+		rome_solver_check(solver);
+		assert(solver->status == status);
+	}
+
+	return solver->status;
+}
+
+static char rome_solver_run(struct rome_solver *solver, int maxdiff)
+{
+	game_state *state = solver->state;
+	int w = solver->w;
+	int h = solver->h;
+	int i, t;
+
+	/* Initialize all marks */
+	for(i = 0; i < w*h; i++)
+	{
+		if(state->grid[i] == EMPTY)
+			state->marks[i] = FM_ARROWMASK;
+		else
+			state->marks[i] = state->grid[i] & FM_ARROWMASK;
+	}
+
+	/* Disable marks near borders */
+	for(i = 0; i < w; i++)
+	{
+		state->marks[i] &= ~FM_UP;
+		state->marks[(h-1)*w+i] &= ~FM_DOWN;
+	}
+	for(i = 0; i < h; i++)
+	{
+		state->marks[i*w] &= ~FM_LEFT;
+		state->marks[i*w+(w-1)] &= ~FM_RIGHT;
+	}
+
+	rome_solver_check(solver);
+
+	/* Every technique starts out looking at the entire grid */
+	for(t = 0; t < TECHCOUNT; t++)
+	{
+		for(i = 0; i < w*h; i++)
+		{
+			if(t != TECH_EXPAND || i == 0)
+				rome_solver_dirty(solver, t, i);
+		}
+	}
+
+	rome_solver_propagate(solver, maxdiff);
+	return rome_solver_finish(solver);
+}
+
+/*
+ * Returns the difficulty level of the hardest technique which was needed
+ * to solve the puzzle, -1 if it could not be solved, or -2 if the
+ * puzzle is invalid.
+ */
+static int rome_solve(game_state *state, int maxdiff, struct arena *arena)
+{
+	struct arena_mark mark = arena_mark(arena);
+	struct rome_solver *solver = rome_solver_new(state, false, arena);
+	char status = rome_solver_run(solver, maxdiff);
+	int diff = solver->diff;
+
+	rome_solver_free(solver);
+	arena_release(arena, mark);
+
+	if(status == STATUS_INVALID)
+		return -2;
+	if(status == STATUS_INCOMPLETE)
+		return -1;
+	return diff;
+}
+
+/*
+ * Solve the puzzle with the given clues, continuing from the position of
+ * base instead of starting over. The clues in base must be a subset of
+ * these clues with the same goals, and base must have been run with only
+ * the easy techniques.
+ *
+ * The easy techniques reach the same marks whichever order they make
+ * their deductions in, so the harder techniques are first tried on the
+ * same position as with rome_solve, with every one of them flagged for
+ * the entire grid. The result and the difficulty are the same as well.
+ * The grid is not validated again afterwards, so it has no error flags.
+ */
+static int rome_solve_from(struct rome_solver *solver, struct rome_solver *base,
+	const cell *clues, int maxdiff)
+{
+	int i, s = solver->w * solver->h;
+	char status;
+
+	rome_solver_copy(solver, base);
+	for(i = 0; i < s; i++)
+	{
+		if(clues[i] & FM_ARROWMASK)
+			rome_solver_add(solver, i, clues[i] & FM_ARROWMASK);
+	}
+	status = rome_solver_propagate(solver, maxdiff);
+
+	if(status == STATUS_INVALID)
+		return -2;
+	if(status == STATUS_INCOMPLETE)
+		return -1;
+	return solver->diff;
 }
 
 static char *solve_game(const game_state *state, const game_state *currstate,
@@ -1040,8 +1490,10 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	char *ret = snewn(s+2, char);
 	char *p = ret;
 	game_state *solved = dup_game(state);
+	struct arena *arena = arena_new();
 	
-	rome_solve(solved, DIFFCOUNT);
+	rome_solve(solved, DIFFCOUNT, arena);
+	arena_free(arena);
 	
 	*p++ = 'S';
 	for(i = 0; i < s; i++)
@@ -1119,17 +1571,19 @@ static void rome_join_arrows(game_state *state, DSF *arrdsf, cell *suggest)
 	}
 }
 
-static bool rome_generate_arrows(game_state *state, random_state *rs)
+static bool rome_generate_arrows(game_state *state, random_state *rs,
+	struct arena *arena)
 {
 	int w = state->w;
 	int h = state->h;
 	int i, j, k;
 	
-	int *spaces = snewn(w*h, int);
+	struct arena_mark mark = arena_mark(arena);
+	int *spaces = arena_newn(arena, w*h, int);
 	DSF *arrdsf = dsf_new_min(w*h);
-	cell *suggest = snewn(w*h, cell);
+	cell *suggest = arena_newn(arena, w*h, cell);
 	
-	cell *arrows = snewn(4, cell);
+	cell *arrows = arena_newn(arena, 4, cell);
 	arrows[0] = FM_UP; arrows[1] = FM_DOWN;
 	arrows[2] = FM_LEFT; arrows[3] = FM_RIGHT;
 	
@@ -1175,13 +1629,11 @@ static bool rome_generate_arrows(game_state *state, random_state *rs)
 			}
 		}
 		
-		rome_solve(state, DIFF_EASY);
+		rome_solve(state, DIFF_EASY, arena);
 	}
 	
-	sfree(spaces);
 	dsf_free(arrdsf);
-	sfree(suggest);
-	sfree(arrows);
+	arena_release(arena, mark);
 	
 	j = 0;
 	for(i = 0; i < w*h; i++)
@@ -1191,13 +1643,14 @@ static bool rome_generate_arrows(game_state *state, random_state *rs)
 	}
 	
 	/* Keep the amount of Goal squares to a minimum */
-	if(j > max(1,(w*h)/25) || rome_validate_game(state, false, NULL, NULL) != STATUS_COMPLETE)
+	if(j > max(1,(w*h)/25) || rome_validate_game(state, false, NULL, NULL, arena) != STATUS_COMPLETE)
 		return false;
 	
 	return true;
 }
 
-static bool rome_generate_regions(game_state *state, random_state *rs)
+static bool rome_generate_regions(game_state *state, random_state *rs,
+	struct arena *arena)
 {
 	/*
 	 * From a grid filled with arrows in 1x1 regions, randomly pick
@@ -1210,9 +1663,10 @@ static bool rome_generate_regions(game_state *state, random_state *rs)
 	int hs = ((w-1)*h);
 	int ws = hs + (w*(h-1));
 	
-	cell *cells = snewn(w*h, cell);
+	struct arena_mark mark = arena_mark(arena);
+	cell *cells = arena_newn(arena, w*h, cell);
 	cell c, c1, c2;
-	int *spaces = snewn(ws, int);
+	int *spaces = arena_newn(arena, ws, int);
 	
 	/* Initialize horizontal mergers */
 	i = 0;
@@ -1260,23 +1714,42 @@ static bool rome_generate_regions(game_state *state, random_state *rs)
 		cells[dsf_canonify(state->dsf, i1)] |= c;
 	}
 	
-	sfree(spaces);
-	sfree(cells);
+	arena_release(arena, mark);
 	
 	return true;
 }
 
-static bool rome_generate_clues(game_state *state, random_state *rs, int diff)
+static int rome_generate_clues(game_state *state, random_state *rs, int diff,
+	struct arena *arena)
 {
-	/* Remove clues from the grid if the puzzle is solvable without them. */
-	
-	int s = state->w * state->h;
-	int i, j;
-	char status;
+	/*
+	 * Remove clues from the grid if the puzzle is solvable without them.
+	 * Returns the difficulty level of the final puzzle.
+	 *
+	 * Once half of the clues have been tried, removals which leave the
+	 * puzzle easier than requested are put off until the end, so that
+	 * the remaining clues are first spent on removals which need the
+	 * requested techniques. Before that point nearly every removal is
+	 * easy, and putting them off would only change the order.
+	 *
+	 * Every clue which stays for the rest of a pass is added to a second
+	 * solver, which only runs the easy techniques. Each removal is then
+	 * checked by continuing from its position, so the solver does not
+	 * have to work out the consequences of these clues again.
+	 */
 	
-	int *spaces = snewn(s, int);
-	cell *grid = snewn(s, cell);
-	cell c;
+	int s = state->w * state->h;
+	int i, j, n, pass, found;
+	int grade = DIFF_EASY;
+	int ndeferred = 0;
+	cell clue;
+	
+	struct arena_mark mark = arena_mark(arena);
+	int *spaces = arena_newn(arena, s, int);
+	cell *grid = arena_newn(arena, s, cell);
+	game_state *kept = dup_game(state);
+	struct rome_solver *base = rome_solver_new(kept, false, arena);
+	struct rome_solver *solver = rome_solver_new(state, false, arena);
 	
 	for(i = 0; i < s; i++)
 		spaces[i] = i;
@@ -1284,94 +1757,87 @@ static bool rome_generate_clues(game_state *state, random_state *rs, int diff)
 	shuffle(spaces, s, sizeof(*spaces), rs);
 	memcpy(grid, state->grid, s*sizeof(cell));
 	
-	for(j = 0; j < s; j++)
+	for(pass = 0; pass < 2; pass++)
 	{
-		i = spaces[j];
-		
-		c = state->grid[i];
-		if(c & FM_GOAL)
-			continue;
-		
-		state->grid[i] = EMPTY;
-		
-		status = rome_solve(state, diff);
-		memcpy(state->grid, grid, s*sizeof(cell));
+		/*
+		 * The first pass can try every clue, but the goals always stay.
+		 * The second pass only tries the deferred clues.
+		 */
+		for(i = 0; i < s; i++)
+			kept->grid[i] = pass == 0 ? grid[i] & FM_GOAL : grid[i];
+		for(j = 0; j < ndeferred; j++)
+			kept->grid[spaces[j]] = EMPTY;
+		rome_solver_run(base, DIFF_EASY);
 		
-		if(status == STATUS_COMPLETE)
+		n = pass == 0 ? s : ndeferred;
+		for(j = 0; j < n; j++)
 		{
-			state->grid[i] = EMPTY;
+			i = spaces[j];
+			if(grid[i] & FM_GOAL)
+				continue;
+			
+			clue = grid[i];
 			grid[i] = EMPTY;
+			found = rome_solve_from(solver, base, grid, diff);
+			
+			if(found >= 0 &&
+				!(pass == 0 && found < diff && grade < diff && j >= s/2))
+			{
+				grade = found;
+				continue;
+			}
+			
+			/* The deferred squares are stored at the start of spaces */
+			if(found >= 0)
+				spaces[ndeferred++] = i;
+			
+			grid[i] = clue;
+			rome_solver_add(base, i, clue);
+			rome_solver_propagate(base, DIFF_EASY);
 		}
 	}
 	
-	sfree(spaces);
-	sfree(grid);
+	memcpy(state->grid, grid, s*sizeof(cell));
 	
-	return true;
+	rome_solver_free(base);
+	rome_solver_free(solver);
+	free_game(kept);
+	arena_release(arena, mark);
+	
+	return grade;
 }
 
-static bool rome_generate(game_state *state, random_state *rs, int diff)
+#ifdef STANDALONE_SOLVER
+/* Generator attempts, reported by --generate */
+static long gen_attempts;
+#endif
+
+static bool rome_generate(game_state *state, random_state *rs, int diff,
+	struct arena *arena)
 {
-	game_state *solved;
-	bool ret = true;
-	
-	if(!rome_generate_arrows(state, rs))
-		return false;
-	
-	if(!rome_generate_regions(state, rs))
+#ifdef STANDALONE_SOLVER
+	gen_attempts++;
+#endif
+	if(!rome_generate_arrows(state, rs, arena))
 		return false;
 	
-	if(!rome_generate_clues(state, rs, diff))
+	if(!rome_generate_regions(state, rs, arena))
 		return false;
 	
-	solved = dup_game(state);
-	rome_solve(solved, diff);
-	if(rome_validate_game(solved, false, NULL, NULL) != STATUS_COMPLETE)
-		ret = false;
-	free_game(solved);
-	
-	if(ret && diff > 0)
-	{
-		solved = dup_game(state);
-		rome_solve(solved, diff-1);
-		if(rome_validate_game(solved, false, NULL, NULL) == STATUS_COMPLETE)
-			ret = false;
-		free_game(solved);
-	}
-	
-	return ret;
+	/*
+	 * Every removal is checked with a solve at the requested difficulty,
+	 * so the puzzle is always solvable. It is only rejected if it turned
+	 * out too easy.
+	 */
+	return rome_generate_clues(state, rs, diff, arena) == diff;
 }
 
-static char *new_game_desc(const game_params *params, random_state *rs,
-			   char **aux, bool interactive)
+static void rome_find_walls(const game_state *state, char *walls)
 {
-	int w = params->w;
-	int h = params->h;
+	int w = state->w;
+	int h = state->h;
 	int x, y, i;
-	int hs = ((w-1)*h);
-	int ws = hs + (w*(h-1));
-	int erun, wrun;
-	cell c;
-	
-	game_state *state = snew(game_state);
-	
-	char *walls = snewn(ws, char);
-	char *p, *ret;
-	
-	state->w = w;
-	state->h = h;
-	state->dsf = dsf_new_min(w*h);
-	state->grid = snewn(w*h, cell);
-	state->marks = snewn(w*h, cell);
-	
-	do
-	{
-		dsf_reinit(state->dsf);
-		memset(state->grid, EMPTY, w*h*sizeof(cell));
-		memset(state->marks, EMPTY, w*h*sizeof(cell));
-	} while(!rome_generate(state, rs, params->diff));
 	
-	/* Generate wall list */
 	i = 0;
 	for(y = 0; y < h; y++)
 	for(x = 0; x < w-1; x++)
@@ -1391,6 +1857,21 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 			walls[i] = false;
 		i++;
 	}
+}
+
+/* Walls as alternating runs, then the clues with runs of empty squares */
+static char *rome_encode_desc(const game_state *state)
+{
+	int w = state->w;
+	int h = state->h;
+	int i, erun, wrun;
+	int hs = ((w-1)*h);
+	int ws = hs + (w*(h-1));
+	cell c;
+	char *walls = snewn(ws, char);
+	char *p, *ret;
+	
+	rome_find_walls(state, walls);
 	
 	ret = snewn(ws + (w*h), char);
 	p = ret;
@@ -1451,9 +1932,127 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	*p++ = '\0';
 	
 	sfree(walls);
+	return ret;
+}
+
+#ifdef DESC_CODEC
+/* Clue kinds, in the order the text description checks them */
+static const cell rome_clues[] = { FM_UP, FM_DOWN, FM_LEFT, FM_RIGHT, FM_GOAL };
+
+static void rome_pack(const game_state *state, struct desc_writer *dw)
+{
+	int w = state->w;
+	int h = state->h;
+	int ws = ((w-1)*h) + (w*(h-1));
+	int i, c;
+	char *walls = snewn(ws, char);
+	
+	desc_put_varint(dw, w);
+	desc_put_varint(dw, h);
+	
+	rome_find_walls(state, walls);
+	for(i = 0; i < ws; i++)
+		desc_put_bits(dw, walls[i], 1);
+	sfree(walls);
+	
+	for(i = 0; i < w*h; i++)
+	{
+		desc_put_bits(dw, state->grid[i] != EMPTY, 1);
+		if(state->grid[i] == EMPTY)
+			continue;
+		for(c = 0; !(state->grid[i] & rome_clues[c]); c++);
+		desc_put_bits(dw, c, 3);
+	}
+}
+
+static game_state *rome_unpack(struct desc_reader *dr, game_params **params)
+{
+	game_params *ret = default_params();
+	game_state *state;
+	int w, h, ws, i, c;
+	char *walls;
+	
+	*params = ret;
+	ret->w = w = desc_get_varint(dr);
+	ret->h = h = desc_get_varint(dr);
+	if(dr->error || validate_params(ret, false))
+		return NULL;
+	if(!desc_need_bits(dr, ((double)(w-1)*h) + ((double)w*(h-1)) + ((double)w*h)))
+		return NULL;
+	
+	ws = ((w-1)*h) + (w*(h-1));
+	walls = snewn(ws, char);
+	for(i = 0; i < ws; i++)
+		walls[i] = desc_get_bits(dr, 1);
+	
+	state = snew(game_state);
+	state->w = w;
+	state->h = h;
+	state->dsf = dsf_new_min(w*h);
+	state->grid = snewn(w*h, cell);
+	state->marks = snewn(w*h, cell);
+	state->completed = state->cheated = false;
+	memset(state->marks, EMPTY, w*h*sizeof(cell));
+	
+	rome_merge_walls(state, walls);
+	sfree(walls);
+	
+	for(i = 0; i < w*h; i++)
+	{
+		state->grid[i] = EMPTY;
+		if(!desc_get_bits(dr, 1))
+			continue;
+		c = desc_get_bits(dr, 3);
+		if(c >= lenof(rome_clues))
+		{
+			dr->error = true;
+			break;
+		}
+		state->grid[i] = rome_clues[c]|FM_FIXED;
+	}
+	
+	if(dr->error)
+	{
+		free_game(state);
+		return NULL;
+	}
+	
+	rome_validate_state(state);
+	return state;
+}
+
+const struct desc_codec thecodec = { rome_pack, rome_unpack, rome_encode_desc };
+#endif
+
+static char *new_game_desc(const game_params *params, random_state *rs,
+			   char **aux, bool interactive)
+{
+	int w = params->w;
+	int h = params->h;
+	char *ret;
+	
+	game_state *state = snew(game_state);
+	struct arena *arena = arena_new();
+	
+	state->w = w;
+	state->h = h;
+	state->dsf = dsf_new_min(w*h);
+	state->grid = snewn(w*h, cell);
+	state->marks = snewn(w*h, cell);
+	state->completed = state->cheated = false;
+	
+	do
+	{
+		dsf_reinit(state->dsf);
+		memset(state->grid, EMPTY, w*h*sizeof(cell));
+		memset(state->marks, EMPTY, w*h*sizeof(cell));
+	} while(!rome_generate(state, rs, params->diff, arena));
+	
+	ret = rome_encode_desc(state);
 	free_game(state);
+	arena_free(arena);
 	
-	return dupstr(ret);
+	return ret;
 }
 
 /* ************** *
@@ -1789,7 +2388,7 @@ static game_state *execute_move(const game_state *oldstate, const char *move)
 			}
 		}
 		
-		if(rome_validate_game(state, true, NULL, NULL) == STATUS_COMPLETE)
+		if(rome_validate_state(state) == STATUS_COMPLETE)
 			state->completed = true;
 		return state;
 	}
@@ -1827,7 +2426,7 @@ static game_state *execute_move(const game_state *oldstate, const char *move)
 			i++;
 		}
 		
-		state->completed = (rome_validate_game(state, true, NULL, NULL) == STATUS_COMPLETE);
+		state->completed = (rome_validate_state(state) == STATUS_COMPLETE);
 		state->cheated = state->completed;
 		return state;
 	}
@@ -2296,3 +2895,366 @@ const struct game thegame = {
 	false, game_timing_state,
 	REQUIRE_RBUTTON, /* flags */
 };
+
+#ifdef STANDALONE_SOLVER
+#include <time.h>
+
+#include "genbatch.h"
+#include "solvestream.h"
+
+static char const *const rome_technames[] = { TECHLIST(TECHNAME) };
+
+const char *quis;
+
+static void usage_exit(const char *msg)
+{
+	if (msg)
+		fprintf(stderr, "%s: %s\n", quis, msg);
+	fprintf(stderr,
+			"Usage: %s [--seed SEED] [--bench COUNT] [--generate COUNT] [--stream] <params> | [game_id [game_id ...]]\n",
+			quis);
+	exit(1);
+}
+
+static void rome_print_grid(const game_state *state)
+{
+	int x, y;
+	cell c;
+
+	for(y = 0; y < state->h; y++)
+	{
+		for(x = 0; x < state->w; x++)
+		{
+			c = state->grid[y*state->w+x];
+			putchar(c & FM_GOAL ? '*' : c & FM_UP ? '^' : c & FM_DOWN ? 'v' :
+				c & FM_LEFT ? '<' : c & FM_RIGHT ? '>' : '.');
+		}
+		putchar('\n');
+	}
+}
+
+/*
+ * Solve the same puzzle by starting over with every technique after each
+ * change, and with the dirty flags, and compare both the results and the
+ * amount of work done.
+ */
+static bool rome_bench_one(game_state *puzzle, int maxdiff,
+	long *calls, long *visits, struct arena *arena)
+{
+	game_state *states[2];
+	struct rome_solver *solver;
+	struct arena_mark mark = arena_mark(arena);
+	char status[2];
+	int m, t, s = puzzle->w * puzzle->h;
+	bool ret;
+
+	for(m = 0; m < 2; m++)
+	{
+		states[m] = dup_game(puzzle);
+		solver = rome_solver_new(states[m], m == 0, arena);
+		status[m] = rome_solver_run(solver, maxdiff);
+		for(t = 0; t < TECHCOUNT; t++)
+		{
+			calls[m*(TECHCOUNT+1) + t] += solver->calls[t];
+			visits[m*(TECHCOUNT+1) + t] += solver->visits[t];
+		}
+		calls[m*(TECHCOUNT+1) + TECHCOUNT] += solver->checks;
+		visits[m*(TECHCOUNT+1) + TECHCOUNT] += solver->checkvisits;
+		rome_solver_free(solver);
+		arena_release(arena, mark);
+	}
+
+	ret = status[0] == status[1] &&
+		!memcmp(states[0]->grid, states[1]->grid, s*sizeof(cell)) &&
+		!memcmp(states[0]->marks, states[1]->marks, s*sizeof(cell));
+
+	free_game(states[0]);
+	free_game(states[1]);
+	return ret;
+}
+
+/*
+ * Remove the clues of a solved grid in random order, like the generator
+ * does, and check each removal both from scratch and by continuing from
+ * the clues which were kept. Both must give the same result.
+ */
+static int rome_bench_strip(const game_state *solved, random_state *rs,
+	int maxdiff, clock_t *times, struct arena *arena)
+{
+	int s = solved->w * solved->h;
+	int i, j, found[2], mismatches = 0;
+	struct arena_mark mark = arena_mark(arena);
+	int *spaces = arena_newn(arena, s, int);
+	cell *grid = arena_newn(arena, s, cell);
+	cell clue;
+	clock_t start;
+	game_state *cold = dup_game(solved);
+	game_state *warm = dup_game(solved);
+	game_state *kept = dup_game(solved);
+	struct rome_solver *base = rome_solver_new(kept, false, arena);
+	struct rome_solver *solver = rome_solver_new(warm, false, arena);
+
+	for(i = 0; i < s; i++)
+	{
+		spaces[i] = i;
+		grid[i] = solved->grid[i] & (FM_ARROWMASK|FM_GOAL);
+		kept->grid[i] = grid[i] & FM_GOAL;
+	}
+	shuffle(spaces, s, sizeof(*spaces), rs);
+	rome_solver_run(base, DIFF_EASY);
+
+	for(j = 0; j < s; j++)
+	{
+		i = spaces[j];
+		if(grid[i] & FM_GOAL)
+			continue;
+
+		clue = grid[i];
+		grid[i] = EMPTY;
+
+		start = clock();
+		memcpy(cold->grid, grid, s*sizeof(cell));
+		found[0] = rome_solve(cold, maxdiff, arena);
+		times[0] += clock() - start;
+
+		start = clock();
+		found[1] = rome_solve_from(solver, base, grid, maxdiff);
+		times[1] += clock() - start;
+
+		if(found[0] != found[1] ||
+			memcmp(cold->grid, warm->grid, s*sizeof(cell)))
+			mismatches++;
+
+		if(found[0] >= 0)
+			continue;
+
+		grid[i] = clue;
+		rome_solver_add(base, i, clue);
+		rome_solver_propagate(base, DIFF_EASY);
+	}
+
+	rome_solver_free(base);
+	rome_solver_free(solver);
+	free_game(cold);
+	free_game(warm);
+	free_game(kept);
+	arena_release(arena, mark);
+	return mismatches;
+}
+
+static int rome_bench(game_params *params, random_state *rs, int count)
+{
+	long calls[2*(TECHCOUNT+1)], visits[2*(TECHCOUNT+1)];
+	clock_t times[2];
+	game_state *puzzle, *solved;
+	char *desc, *aux;
+	int i, t, d, mismatches = 0;
+	struct arena *arena = arena_new();
+
+	memset(calls, 0, sizeof(calls));
+	memset(visits, 0, sizeof(visits));
+	times[0] = times[1] = 0;
+
+	for(i = 0; i < count; i++)
+	{
+		desc = new_game_desc(params, rs, &aux, false);
+		puzzle = new_game(NULL, params, desc);
+
+		/* Grading solves at every level, as well as the full solve */
+		for(d = 0; d <= params->diff; d++)
+		{
+			if(!rome_bench_one(puzzle, d, calls, visits, arena))
+			{
+				printf("Mismatch at %s level: %s\n", rome_diffnames[d], desc);
+				mismatches++;
+			}
+		}
+
+		/* Clue removals from the solution, as the generator checks them */
+		solved = dup_game(puzzle);
+		rome_solve(solved, DIFFCOUNT, arena);
+		d = rome_bench_strip(solved, rs, params->diff, times, arena);
+		if(d)
+		{
+			printf("Mismatch in %d clue removals: %s\n", d, desc);
+			mismatches++;
+		}
+		free_game(solved);
+
+		free_game(puzzle);
+		sfree(desc);
+	}
+	arena_free(arena);
+
+	printf("technique\trestart_calls\tcalls\trestart_visits\tvisits\tvisits_saved\n");
+	for(t = 0; t <= TECHCOUNT; t++)
+	{
+		long rv = visits[t], v = visits[TECHCOUNT+1 + t];
+		printf("%s\t%ld\t%ld\t%ld\t%ld\t%.1f%%\n",
+			t < TECHCOUNT ? rome_technames[t] : "validate",
+			calls[t], calls[TECHCOUNT+1 + t], rv, v,
+			rv ? 100.0 * (rv - v) / rv : 0.0);
+	}
+	printf("Clue removals: %.0f ms from scratch, %.0f ms from kept clues\n",
+		times[0] * 1000.0 / CLOCKS_PER_SEC, times[1] * 1000.0 / CLOCKS_PER_SEC);
+	printf("Scratch: %.1f allocations from %.1f heap blocks\n",
+		(double)arena_total_allocs / count, (double)arena_total_blocks / count);
+
+	return mismatches;
+}
+
+/* Difficulty level of a generated puzzle, for --generate */
+static const char *rome_grade(const game_params *params, const char *desc)
+{
+	game_state *state = new_game(NULL, params, desc);
+	struct arena *arena = arena_new();
+	int diff = rome_solve(state, DIFFCOUNT, arena);
+
+	arena_free(arena);
+	free_game(state);
+	return diff < 0 ? "Unsolved" : rome_diffnames[diff];
+}
+
+/* Solve one puzzle for --stream, using the arena in ctx */
+static void rome_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+	struct arena *arena = ctx;
+	struct arena_mark mark = arena_mark(arena);
+	struct rome_solver *solver = rome_solver_new(state, false, arena);
+	char status = rome_solver_run(solver, DIFFCOUNT);
+
+	if(status == STATUS_INVALID)
+		res->status = "Invalid";
+	else if(status != STATUS_INCOMPLETE)
+	{
+		res->status = "Solved";
+		res->diff = rome_diffnames[solver->diff];
+	}
+	solvestream_counts(res, rome_technames, solver->uses, TECHCOUNT);
+
+	rome_solver_free(solver);
+	arena_release(arena, mark);
+}
+
+int main(int argc, char *argv[])
+{
+	random_state *rs;
+	time_t seed = time(NULL);
+	int bench = 0, generate = 0;
+	bool stream = false;
+
+	game_params *params = NULL;
+
+	char *id = NULL, *desc = NULL;
+	const char *err;
+
+	quis = argv[0];
+
+	while (--argc > 0) {
+		char *p = *++argv;
+		if (!strcmp(p, "--seed")) {
+			if (argc == 0)
+				usage_exit("--seed needs an argument");
+			seed = (time_t) atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--bench")) {
+			if (argc == 0)
+				usage_exit("--bench needs an argument");
+			bench = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--generate")) {
+			if (argc == 0)
+				usage_exit("--generate needs an argument");
+			generate = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--params")) {
+			if (argc == 0)
+				usage_exit("--params needs an argument");
+			id = *++argv;
+			argc--;
+		} else if (!strcmp(p, "--stream"))
+			stream = true;
+		else if (*p == '-')
+			usage_exit("unrecognised option");
+		else
+			id = p;
+	}
+
+	if (id) {
+		desc = strchr(id, ':');
+		if (desc)
+			*desc++ = '\0';
+
+		params = default_params();
+		decode_params(params, id);
+		err = validate_params(params, true);
+		if (err) {
+			fprintf(stderr, "Parameters are invalid\n");
+			fprintf(stderr, "%s: %s", argv[0], err);
+			exit(1);
+		}
+	}
+
+	if (stream) {
+		struct arena *arena;
+		if (id)
+			usage_exit("--stream reads game IDs from stdin");
+		arena = arena_new();
+		solvestream_run(stdin, rome_stream_solve, arena);
+		arena_free(arena);
+		return 0;
+	}
+
+	if (!params)
+		params = default_params();
+
+	if (generate) {
+		if (desc)
+			usage_exit("--generate needs parameters, not a game ID");
+		genbatch_run(params, (unsigned long)seed, generate, &gen_attempts,
+			rome_grade);
+	} else if (bench) {
+		rs = random_new((void *) &seed, sizeof(time_t));
+		printf("Solving %d puzzles with parameters %s\n", bench,
+			   encode_params(params, true));
+		return rome_bench(params, rs, bench) ? 1 : 0;
+	} else if (!desc) {
+		char *desc_gen, *aux;
+		rs = random_new((void *) &seed, sizeof(time_t));
+		printf("Generating puzzle with parameters %s\n",
+			   encode_params(params, true));
+		desc_gen = new_game_desc(params, rs, &aux, false);
+
+		printf("Game ID: %s\n", desc_gen);
+		printf("Scratch: %lu allocations from %lu heap blocks\n",
+			arena_total_allocs, arena_total_blocks);
+	} else {
+		game_state *input;
+		struct arena *arena;
+		int diff;
+
+		err = validate_desc(params, desc);
+		if (err) {
+			fprintf(stderr, "Description is invalid\n");
+			fprintf(stderr, "%s", err);
+			exit(1);
+		}
+
+		input = new_game(NULL, params, desc);
+		arena = arena_new();
+		diff = rome_solve(input, DIFFCOUNT, arena);
+		arena_free(arena);
+		rome_print_grid(input);
+		free_game(input);
+
+		if (diff >= 0)
+			printf("Difficulty: %s\n", rome_diffnames[diff]);
+		else if (diff == -2)
+			printf("Puzzle is invalid.\n");
+		else
+			printf("No solution found.\n");
+	}
+
+	return 0;
+}
+#endif
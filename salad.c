@@ -1236,6 +1236,11 @@ static void salad_strip_clues(game_state *state, random_state *rs, digit *clues,
 /* ********* *
  * Generator *
  * ********* */
+#ifdef STANDALONE_SOLVER
+/* Generator attempts, reported by --generate */
+static long gen_attempts;
+#endif
+
 static char *salad_new_numbers_desc(const game_params *params, random_state *rs, char **aux)
 {
 	int o = params->order;
@@ -1250,6 +1255,9 @@ static char *salad_new_numbers_desc(const game_params *params, random_state *rs,
 
 	while(true)
 	{
+#ifdef STANDALONE_SOLVER
+		gen_attempts++;
+#endif
 		/* Generate a solved grid */
 		grid = latin_generate(o, rs);
 		state = blank_game(params);
@@ -1348,6 +1356,9 @@ static char *salad_new_letters_desc(const game_params *params, random_state *rs,
 	
 	while(true)
 	{
+#ifdef STANDALONE_SOLVER
+		gen_attempts++;
+#endif
 		grid = latin_generate(o, rs);
 		state = blank_game(params);
 		memset(state->borderclues, 0, ox4 * sizeof(char));
@@ -2528,6 +2539,9 @@ const struct game thegame = {
 #include <time.h>
 #include <stdarg.h>
 
+#include "genbatch.h"
+#include "solvestream.h"
+
 /* Most of the standalone solver code was copied from unequal.c and singles.c */
 
 const char *quis;
@@ -2536,15 +2550,58 @@ static void usage_exit(const char *msg)
 {
 	if (msg)
 		fprintf(stderr, "%s: %s\n", quis, msg);
-	fprintf(stderr, "Usage: %s [-v] [--seed SEED] <params> | [game_id [game_id ...]]\n", quis);
+	fprintf(stderr, "Usage: %s [-v] [--seed SEED] [--generate COUNT] [--stream] <params> | [game_id [game_id ...]]\n", quis);
 	exit(1);
 }
 
+static char const *const salad_diffnames[] = { DIFFLIST(TITLE) };
+
+/* Lowest difficulty level which solves a generated puzzle, for --generate */
+static const char *salad_grade(const game_params *params, const char *desc)
+{
+	game_state *state;
+	bool solved;
+	int diff;
+	
+	for(diff = 0; diff < DIFFCOUNT; diff++)
+	{
+		state = new_game(NULL, params, desc);
+		solved = salad_solve(state, diff);
+		free_game(state);
+		if(solved)
+			break;
+	}
+	
+	return diff < DIFFCOUNT ? salad_diffnames[diff] : "Unsolved";
+}
+
+/* Solve one puzzle for --stream at each difficulty in turn, as for --generate */
+static void salad_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+	game_state *copy;
+	bool solved = false;
+	int diff;
+	
+	for(diff = 0; diff < DIFFCOUNT && !solved; diff++)
+	{
+		copy = dup_game(state);
+		solved = salad_solve(copy, diff);
+		free_game(copy);
+	}
+	
+	if(solved)
+	{
+		res->status = "Solved";
+		res->diff = salad_diffnames[diff - 1];
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	random_state *rs;
 	time_t seed = time(NULL);
-	int i, attempts = 1;
+	int i, attempts = 1, generate = 0;
+	bool stream = false;
 	game_params *params = NULL;
 	
 	char *id = NULL, *desc = NULL;
@@ -2562,6 +2619,22 @@ int main(int argc, char *argv[])
 			seed = (time_t)atoi(*++argv);
 			argc--;
 		}
+		else if (!strcmp(p, "--generate"))
+		{
+			if (argc == 0)
+				usage_exit("--generate needs an argument");
+			generate = atoi(*++argv);
+			argc--;
+		}
+		else if (!strcmp(p, "--params"))
+		{
+			if (argc == 0)
+				usage_exit("--params needs an argument");
+			id = *++argv;
+			argc--;
+		}
+		else if (!strcmp(p, "--stream"))
+			stream = true;
 		else if(!strcmp(p, "-v"))
 			solver_show_working = true;
 		else if(!strcmp(p, "--soak"))
@@ -2588,7 +2661,20 @@ int main(int argc, char *argv[])
 		}
 	}
 	
-	if (!desc)
+	if (stream)
+	{
+		if (id)
+			usage_exit("--stream reads game IDs from stdin");
+		solvestream_run(stdin, salad_stream_solve, NULL);
+	}
+	else if (generate)
+	{
+		if (desc)
+			usage_exit("--generate needs parameters, not a game ID");
+		if(!params) params = default_params();
+		genbatch_run(params, (unsigned long)seed, generate, &gen_attempts, salad_grade);
+	}
+	else if (!desc)
 	{
 		rs = random_new((void*)&seed, sizeof(time_t));
 		if(!params) params = default_params();
@@ -33,6 +33,11 @@
 #include <math.h>
 
 #include "puzzles.h"
+#include "arena.h"
+#include "trail.h"
+#ifdef DESC_CODEC
+#include "desccodec.h"
+#endif
 
 #ifdef STANDALONE_SOLVER
 bool solver_verbose = false;
@@ -308,7 +313,8 @@ static void free_game(game_state *state)
 #define AREA_BITS(x) ( NUM_BIT((x)+1)-1 )
 #define FM_MARKS AREA_BITS(9)
 
-static int seismic_unset(game_state *state, int x, int y, char n)
+static int seismic_unset(game_state *state, int x, int y, char n,
+	struct trail *trail)
 {
 	/* Remove one mark from a cell */
 	
@@ -319,13 +325,14 @@ static int seismic_unset(game_state *state, int x, int y, char n)
 	
 	if(state->marks[y*w+x] & NUM_BIT(n))
 	{
-		state->marks[y*w+x] &= ~NUM_BIT(n);
+		trail_clear_bits(trail, &state->marks[y*w+x], NUM_BIT(n));
 		return 1;
 	}
 	return 0;
 }
 
-static int seismic_place_number(game_state *state, int x, int y, char n)
+static int seismic_place_number(game_state *state, int x, int y, char n,
+	struct trail *trail)
 {
 	/* Place a number in the grid, and rule out this number
 	 * in all cells in range, and in the rest of the region. */
@@ -342,12 +349,12 @@ static int seismic_place_number(game_state *state, int x, int y, char n)
 	
 	if(state->grid[i] != n)
 	{
-		state->grid[i] = n;
+		trail_set_char(trail, &state->grid[i], n);
 		ret += 1;
 	}
 	if(state->marks[i] != NUM_BIT(n))
 	{
-		state->marks[i] = NUM_BIT(n);
+		trail_set_int(trail, &state->marks[i], NUM_BIT(n));
 		ret += 1;
 	}
 	
@@ -355,10 +362,10 @@ static int seismic_place_number(game_state *state, int x, int y, char n)
 	{
 		for (j = 1; j <= n; j++)
 		{
-			ret += seismic_unset(state, x + j, y, n);
-			ret += seismic_unset(state, x - j, y, n);
-			ret += seismic_unset(state, x, y + j, n);
-			ret += seismic_unset(state, x, y - j, n);
+			ret += seismic_unset(state, x + j, y, n, trail);
+			ret += seismic_unset(state, x - j, y, n, trail);
+			ret += seismic_unset(state, x, y + j, n, trail);
+			ret += seismic_unset(state, x, y - j, n, trail);
 		}
 	}
 	else
@@ -368,7 +375,7 @@ static int seismic_place_number(game_state *state, int x, int y, char n)
 			for (dy = -1; dy <= 1; dy++)
 			{
 				if (!dx && !dy) continue;
-				ret += seismic_unset(state, x + dx, y + dy, n);
+				ret += seismic_unset(state, x + dx, y + dy, n, trail);
 			}
 	}
 	
@@ -378,7 +385,7 @@ static int seismic_place_number(game_state *state, int x, int y, char n)
 		if(j == i)
 			continue;
 		if(c1 == dsf_canonify(state->dsf, j))
-			ret += seismic_unset(state, j%w, j/w, n);
+			ret += seismic_unset(state, j%w, j/w, n, trail);
 	}
 	
 	return ret;
@@ -400,7 +407,7 @@ static void seismic_solver_init(game_state *state)
 	for(i = 0; i < s; i++)
 	{
 		if(state->grid[i] != 0)
-			seismic_place_number(state, i%w, i/w, state->grid[i]);
+			seismic_place_number(state, i%w, i/w, state->grid[i], NULL);
 	}
 }
 
@@ -423,14 +430,14 @@ static int seismic_solver_marks(game_state *state)
 		for(j = 1; j <= 9; j++)
 		{
 			if(state->marks[i] == NUM_BIT(j))
-				ret += seismic_place_number(state, i%w, i/w, j);
+				ret += seismic_place_number(state, i%w, i/w, j, NULL);
 		}
 	}
 	
 	return ret;
 }
 
-static int seismic_solver_areas(game_state *state)
+static int seismic_solver_areas(game_state *state, struct arena *arena)
 {
 	/* Check if a region has a single possibility for a certain number,
 	 * then remove all other marks from that cell */
@@ -442,10 +449,11 @@ static int seismic_solver_areas(game_state *state)
 	
 	int ret = 0;
 	
+	struct arena_mark mark = arena_mark(arena);
 	/* Marks which appear at least once */
-	int *singles = snewn(s, int);
+	int *singles = arena_newn(arena, s, int);
 	/* Marks which appear at least twice */
-	int *doubles = snewn(s, int);
+	int *doubles = arena_newn(arena, s, int);
 	
 	memset(singles, 0, s*sizeof(int));
 	memset(doubles, 0, s*sizeof(int));
@@ -468,24 +476,24 @@ static int seismic_solver_areas(game_state *state)
 			ret++;
 	}
 	
-	sfree(singles);
-	sfree(doubles);
+	arena_release(arena, mark);
 	return ret;
 }
 
-static int seismic_solver_attempt(game_state *state)
+static int seismic_solver_attempt(game_state *state, struct arena *arena,
+	struct trail *trail)
 {
-	/* Try to place a number, and see if this directly leads to an error */
+	/* Try to place a number, and see if this directly leads to an error.
+	 * The placement is made through the trail, and rolled back after. */
 	
 	int ret = 0;
 	int w = state->w;
 	int s = w * state->h;
-	int i, j, n;
+	int i, j, n, tmark;
 	bool valid;
 	
-	char *grid = snewn(s, char);
-	int *marks = snewn(s, int);
-	int *areas = snewn(s, int);
+	struct arena_mark mark = arena_mark(arena);
+	int *areas = arena_newn(arena, s, int);
 	
 	for(i = 0; i < s; i++)
 	{
@@ -497,12 +505,11 @@ static int seismic_solver_attempt(game_state *state)
 			if(!(state->marks[i] & NUM_BIT(n)))
 				continue;
 			
-			memcpy(grid, state->grid, s*sizeof(char));
-			memcpy(marks, state->marks, s*sizeof(int));
 			memset(areas, 0, s*sizeof(int));
 			
 			valid = true;
-			seismic_place_number(state, i%w, i/w, n);
+			tmark = trail_mark(trail);
+			seismic_place_number(state, i%w, i/w, n, trail);
 			
 			/* Get all marks for each region */
 			for(j = 0; j < s; j++)
@@ -520,25 +527,22 @@ static int seismic_solver_attempt(game_state *state)
 					valid = false;
 			}
 			
-			memcpy(state->grid, grid, s*sizeof(char));
-			memcpy(state->marks, marks, s*sizeof(int));
+			trail_rollback(trail, tmark);
 			
 			if(!valid)
 			{
-				ret += seismic_unset(state, i%w, i/w, n);
+				ret += seismic_unset(state, i%w, i/w, n, NULL);
 			}
 		}
 	}
 	
-	sfree(grid);
-	sfree(marks);
-	sfree(areas);
+	arena_release(arena, mark);
 	return ret;
 }
 
 enum { STATUS_COMPLETE, STATUS_UNFINISHED, STATUS_INVALID };
 
-static int seismic_validate_game(game_state *state)
+static int seismic_validate_game(game_state *state, struct arena *arena)
 {
 	int w = state->w;
 	int h = state->h;
@@ -546,12 +550,13 @@ static int seismic_validate_game(game_state *state)
 	int i, j, n, c;
 	int ret = STATUS_COMPLETE;
 	
+	struct arena_mark mark = arena_mark(arena);
 	/* Numbers which appear at least once */
-	int *singles = snewn(s, int);
+	int *singles = arena_newn(arena, s, int);
 	/* Numbers which appear at least twice */
-	int *doubles = snewn(s, int);
+	int *doubles = arena_newn(arena, s, int);
 	/* Numbers in range of an equal number */
-	int *ranges = snewn(s, int);
+	int *ranges = arena_newn(arena, s, int);
 	
 	memset(singles, 0, s*sizeof(int));
 	memset(doubles, 0, s*sizeof(int));
@@ -631,47 +636,68 @@ static int seismic_validate_game(game_state *state)
 		}
 	}
 	
-	sfree(singles);
-	sfree(doubles);
-	sfree(ranges);
+	arena_release(arena, mark);
 	
 	return ret;
 }
 
-static int seismic_solve_game(game_state *state, int maxdiff)
+#ifdef STANDALONE_SOLVER
+/* How often each technique made progress, reported by --stream */
+enum { USE_MARKS, USE_AREAS, USE_ATTEMPT, USECOUNT };
+static long solver_uses[USECOUNT];
+#define SOLVER_USED(t) (solver_uses[t]++)
+#else
+#define SOLVER_USED(t) ((void)0)
+#endif
+
+static int seismic_solve_game(game_state *state, int maxdiff, struct arena *arena)
 {
 	int diff = DIFF_EASY;
+	struct trail *trail = NULL;
 	
 	seismic_solver_init(state);
 	
 	while(true)
 	{
-		if(seismic_validate_game(state) != STATUS_UNFINISHED)
+		if(seismic_validate_game(state, arena) != STATUS_UNFINISHED)
 			break;
 		
 		if(seismic_solver_marks(state))
+		{
+			SOLVER_USED(USE_MARKS);
 			continue;
+		}
 		
-		if(seismic_solver_areas(state))
+		if(seismic_solver_areas(state, arena))
+		{
+			SOLVER_USED(USE_AREAS);
 			continue;
+		}
 			
 		if(maxdiff < DIFF_HARD)
 			break;
 		diff = max(diff, DIFF_HARD);
 		
-		if(seismic_solver_attempt(state))
+		if(!trail)
+			trail = trail_new();
+		if(seismic_solver_attempt(state, arena, trail))
+		{
+			SOLVER_USED(USE_ATTEMPT);
 			continue;
+		}
 		
 		break;
 	}
 	
-	if(seismic_validate_game(state) != STATUS_COMPLETE)
+	trail_free(trail);
+	
+	if(seismic_validate_game(state, arena) != STATUS_COMPLETE)
 		return -1;
 	
 	return diff;
 }
 
-static bool seismic_gen_numbers(game_state *state, random_state *rs)
+static bool seismic_gen_numbers(game_state *state, random_state *rs, struct arena *arena)
 {
 	/* Fill a grid with numbers by randomly picking squares, then
 	 * placing the lowest possible number. */
@@ -680,7 +706,8 @@ static bool seismic_gen_numbers(game_state *state, random_state *rs)
 	int h = state->h;
 	int s = w * h;
 	int i, j, k;
-	int *spaces = snewn(s, int);
+	struct arena_mark mark = arena_mark(arena);
+	int *spaces = arena_newn(arena, s, int);
 	
 	for(i = 0; i < s; i++)
 	{
@@ -697,77 +724,291 @@ static bool seismic_gen_numbers(game_state *state, random_state *rs)
 		{
 			if(state->marks[i] & NUM_BIT(k))
 			{
-				seismic_place_number(state, i%w, i/w, k);
+				seismic_place_number(state, i%w, i/w, k, NULL);
 				break;
 			}
 		}
 		if (k > 9)
+		{
+			arena_release(arena, mark);
 			return false;
+		}
 	}
 	
-	sfree(spaces);
+	arena_release(arena, mark);
 	
 	return true;
 }
 
-static bool tectonic_gen_numbers(game_state *state, random_state *rs)
+static void tectonic_gen_areas(game_state *state, random_state *rs, struct arena *arena)
 {
+	/* Grow areas of 4 or 5 cells from random starting points. Cells
+	 * which are left over form smaller areas, and single cells are
+	 * merged with a neighbouring area where possible.
+	 *
+	 * Every area needs a 1, and no two 1s can touch, so at most a
+	 * quarter of the cells can be 1s. Areas smaller than 4 cells
+	 * quickly make the grid impossible to fill. */
+	
 	int w = state->w;
 	int h = state->h;
 	int s = w * h;
-	int i, j, k;
-	int spaces[5] = { 1, 2, 3, 4, 5 };
-	int counts[5] = { 0, 0, 0, 0, 0 };
-	for (i = 0; i < s; i++)
-	{
-		state->marks[i] = AREA_BITS(5);
-	}
-
-	/* Visit all grid spaces sequentially and place a random number. */
-	for (i = 0; i < s; i++)
+	int i, j, k, n, x, y, size, target, nfront;
+	int hs = ((w-1)*h);
+	int ws = hs + (w*(h-1));
+	int front[20];
+	struct arena_mark mark = arena_mark(arena);
+	int *spaces = arena_newn(arena, ws, int);
+	bool *used = arena_newn(arena, s, bool);
+	
+	memset(used, 0, s*sizeof(bool));
+	for(i = 0; i < s; i++)
+		spaces[i] = i;
+	shuffle(spaces, s, sizeof(*spaces), rs);
+	
+	for(j = 0; j < s; j++)
 	{
-		shuffle(spaces, 5, sizeof(int), rs);
-		for (j = 0; j < 5; j++)
+		i = spaces[j];
+		if(used[i])
+			continue;
+		
+		target = 4 + random_upto(rs, 2);
+		used[i] = true;
+		size = 1;
+		nfront = 0;
+		n = i;
+		while(true)
 		{
-			k = spaces[j];
-			if (state->marks[i] & NUM_BIT(k))
+			x = n % w;
+			y = n / w;
+			if(x > 0 && !used[n-1]) front[nfront++] = n-1;
+			if(x < w-1 && !used[n+1]) front[nfront++] = n+1;
+			if(y > 0 && !used[n-w]) front[nfront++] = n-w;
+			if(y < h-1 && !used[n+w]) front[nfront++] = n+w;
+			
+			/* Pick a random unused neighbour of the area */
+			n = -1;
+			while(size < target && nfront > 0 && n < 0)
 			{
-				seismic_place_number(state, i%w, i/w, k);
-				counts[k - 1]++;
-				break;
+				k = random_upto(rs, nfront);
+				if(!used[front[k]])
+					n = front[k];
+				front[k] = front[--nfront];
 			}
+			if(n < 0)
+				break;
+			
+			used[n] = true;
+			dsf_merge(state->dsf, i, n);
+			size++;
 		}
 	}
+	
+	/* Horizontal and vertical borders, as in seismic_gen_areas */
+	i = 0;
+	for(y = 0; y < h; y++)
+	for(x = 0; x < w-1; x++)
+		spaces[i++] = y*w+x;
+	for(y = 0; y < h-1; y++)
+	for(x = 0; x < w; x++)
+		spaces[i++] = s + y*w+x;
+	shuffle(spaces, ws, sizeof(*spaces), rs);
+	
+	for(i = 0; i < ws; i++)
+	{
+		j = spaces[i] % s;
+		k = spaces[i] >= s ? j + w : j + 1;
+		
+		if(dsf_size(state->dsf, j) != 1 && dsf_size(state->dsf, k) != 1)
+			continue;
+		if(dsf_canonify(state->dsf, j) == dsf_canonify(state->dsf, k))
+			continue;
+		if(dsf_size(state->dsf, j) + dsf_size(state->dsf, k) > 5)
+			continue;
+		
+		dsf_merge(state->dsf, j, k);
+	}
+	
+	arena_release(arena, mark);
+}
+
+#ifdef STANDALONE_SOLVER
+/* Generator statistics, reported by --bench */
+static long gen_attempts, gen_failed_fills, gen_backjumps;
+#endif
+
+static int tectonic_bit_count(int bits)
+{
+	int ret = 0;
+	for(; bits; bits &= bits - 1)
+		ret++;
+	return ret;
+}
 
-	/* Build a map of each number based on how often it appears in the grid. */
-	for (j = 0; j < 5; j++)
+static bool tectonic_gen_numbers(game_state *state, random_state *rs, struct arena *arena)
+{
+	/*
+	 * Fill the areas with numbers using a backtracking search. The next
+	 * cell is always one with the fewest numbers left in its marks. Each
+	 * depth keeps a conflict set: the earlier depths which ruled out one
+	 * of its numbers, either directly or further down the search. When a
+	 * cell runs out of numbers, the search jumps straight back to the
+	 * latest depth in its conflict set, instead of the previous one.
+	 *
+	 * Returns false if the areas cannot be filled, or if the search
+	 * takes too long.
+	 */
+	
+	int w = state->w;
+	int h = state->h;
+	int s = w * h;
+	int words = (s + 31) / 32;
+	int i, j, k, n, d, x, y, dx, dy, best, bestcount, avail, bit;
+	long nodes = 0, limit = 100L * s;
+	bool ret = false;
+	
+	struct arena_mark mark = arena_mark(arena);
+	/* Cells which cannot have the same number: neighbours and area */
+	int *nbrs = arena_newn(arena, s*12, int);
+	int *nnbrs = arena_newn(arena, s, int);
+	/* Number of neighbours with each number */
+	int *counts = arena_newn(arena, s*5, int);
+	int *areabits = arena_newn(arena, s, int);
+	int *order = arena_newn(arena, s, int);
+	int *depth = arena_newn(arena, s, int);
+	int *tried = arena_newn(arena, s, int);
+	int *cells = arena_newn(arena, s, int);
+	unsigned int *conf = arena_newn(arena, s*words, unsigned int);
+	unsigned int *cd;
+	
+	for(i = 0; i < s; i++)
 	{
-		int imax = -1;
-		int cmax = -1;
-		for (k = 0; k < 5; k++)
+		x = i % w;
+		y = i / w;
+		nnbrs[i] = 0;
+		
+		/* An area has at most 5 cells, so it fits in a 9x9 box */
+		for(dy = -4; dy <= 4; dy++)
+		for(dx = -4; dx <= 4; dx++)
 		{
-			if (counts[k] > cmax)
+			if((!dx && !dy) || x+dx < 0 || x+dx >= w || y+dy < 0 || y+dy >= h)
+				continue;
+			j = i + dy*w + dx;
+			if((abs(dx) <= 1 && abs(dy) <= 1) ||
+				dsf_canonify(state->dsf, i) == dsf_canonify(state->dsf, j))
+				nbrs[i*12 + nnbrs[i]++] = j;
+		}
+		
+		areabits[i] = AREA_BITS(dsf_size(state->dsf, i));
+		state->marks[i] = areabits[i];
+		state->grid[i] = 0;
+		cells[i] = i;
+	}
+	memset(counts, 0, s*5*sizeof(int));
+	
+	/* Ties between cells with the same number of marks are broken randomly */
+	shuffle(cells, s, sizeof(*cells), rs);
+	
+	d = 0;
+	while(d < s)
+	{
+		/* Find the cell with the fewest possible numbers */
+		best = -1;
+		bestcount = 6;
+		for(k = 0; k < s && bestcount > 0; k++)
+		{
+			i = cells[k];
+			if(state->grid[i])
+				continue;
+			n = tectonic_bit_count(state->marks[i]);
+			if(n < bestcount)
 			{
-				imax = k;
-				cmax = counts[k];
+				best = i;
+				bestcount = n;
 			}
 		}
-
-		spaces[j] = imax + 1;
-		counts[imax] = -1;
+		
+		i = best;
+		order[d] = i;
+		tried[d] = 0;
+		cd = conf + d*words;
+		memset(cd, 0, words*sizeof(unsigned int));
+		for(k = 0; k < nnbrs[i]; k++)
+		{
+			j = nbrs[i*12+k];
+			if(state->grid[j] && (areabits[i] & NUM_BIT(state->grid[j])))
+				cd[depth[j]/32] |= 1U << (depth[j]%32);
+		}
+		
+		while(true)
+		{
+			avail = state->marks[i] & ~tried[d];
+			if(avail)
+			{
+				/* Place a random number from the remaining ones */
+				k = random_upto(rs, tectonic_bit_count(avail));
+				for(n = 1; !(avail & NUM_BIT(n)) || k--; n++);
+				
+				tried[d] |= NUM_BIT(n);
+				state->grid[i] = n;
+				depth[i] = d;
+				for(k = 0; k < nnbrs[i]; k++)
+				{
+					j = nbrs[i*12+k];
+					if(counts[j*5 + n-1]++ == 0)
+						state->marks[j] &= ~NUM_BIT(n);
+				}
+				d++;
+				nodes++;
+				break;
+			}
+			
+			/* Dead end. Find the latest depth in the conflict set */
+			cd = conf + d*words;
+			for(j = words-1; j >= 0 && !cd[j]; j--);
+			if(j < 0 || nodes > limit)
+				goto done;
+			for(bit = 31; !(cd[j] & (1U << bit)); bit--);
+			k = j*32 + bit;
+			
+			/* The conflicts of this depth become conflicts of depth k */
+			cd[j] &= ~(1U << bit);
+			for(j = 0; j < words; j++)
+				conf[k*words + j] |= cd[j];
+			
+			/* Undo every number from depth k onwards */
+			while(d > k)
+			{
+				d--;
+				j = order[d];
+				n = state->grid[j];
+				state->grid[j] = 0;
+				for(x = 0; x < nnbrs[j]; x++)
+				{
+					y = nbrs[j*12+x];
+					if(--counts[y*5 + n-1] == 0 && (areabits[y] & NUM_BIT(n)))
+						state->marks[y] |= NUM_BIT(n);
+				}
+			}
+			i = order[d];
+#ifdef STANDALONE_SOLVER
+			gen_backjumps++;
+#endif
+		}
 	}
-
-	/*
-	 * Translate the grid numbers based on the map.
-	 * The 1 must appear most often in the grid, followed by 2, then 3, etc. 
-	 */
-	for (i = 0; i < s; i++)
-		state->grid[i] = spaces[state->grid[i] - 1];
-
-	return true;
+	ret = true;
+	
+done:
+#ifdef STANDALONE_SOLVER
+	if(!ret)
+		gen_failed_fills++;
+#endif
+	arena_release(arena, mark);
+	
+	return ret;
 }
 
-static bool seismic_gen_areas(game_state *state, random_state *rs)
+static bool seismic_gen_areas(game_state *state, random_state *rs, struct arena *arena)
 {
 	/* Examine borders between two areas in a random order,
 	 * and attempt to merge the areas whenever possible.
@@ -783,9 +1024,10 @@ static bool seismic_gen_areas(game_state *state, random_state *rs)
 	int ws = hs + (w*(h-1));
 	bool ret = true;
 	
-	int *cells = snewn(w*h, int);
+	struct arena_mark mark = arena_mark(arena);
+	int *cells = arena_newn(arena, w*h, int);
 	int c, c1, c2;
-	int *spaces = snewn(ws, int);
+	int *spaces = arena_newn(arena, ws, int);
 	
 	/* Initialize horizontal mergers */
 	i = 0;
@@ -836,22 +1078,33 @@ static bool seismic_gen_areas(game_state *state, random_state *rs)
 			ret = false;
 	}
 	
-	sfree(spaces);
-	sfree(cells);
+	arena_release(arena, mark);
 	
 	return ret;
 }
 
-static bool seismic_gen_clues(game_state *state, random_state *rs, int diff)
+static int seismic_gen_clues(game_state *state, random_state *rs, int diff, struct arena *arena)
 {
-	/* Randomly remove numbers to create a puzzle */
+	/*
+	 * Randomly remove numbers to create a puzzle. Returns the difficulty
+	 * level of the final puzzle.
+	 *
+	 * A removal is normally kept as soon as the puzzle is still solvable.
+	 * Once three quarters of the numbers have been tried and the puzzle
+	 * is still easier than requested, all remaining numbers are tried
+	 * before each removal, and one which needs the requested techniques
+	 * is taken first.
+	 */
 	
 	int s = state->w * state->h;
-	int i, j;
-	char status;
+	int i, j, n, found, take, takediff;
+	int grade = DIFF_EASY;
+	int tried = 0;
+	bool scan;
 	
-	int *spaces = snewn(s, int);
-	char *grid = snewn(s, char);
+	struct arena_mark mark = arena_mark(arena);
+	int *spaces = arena_newn(arena, s, int);
+	char *grid = arena_newn(arena, s, char);
 	
 	for(i = 0; i < s; i++)
 		spaces[i] = i;
@@ -859,90 +1112,107 @@ static bool seismic_gen_clues(game_state *state, random_state *rs, int diff)
 	shuffle(spaces, s, sizeof(*spaces), rs);
 	memcpy(grid, state->grid, s*sizeof(char));
 	
-	for(j = 0; j < s; j++)
+	/* The first n entries of spaces are the numbers left to try */
+	n = s;
+	while(n > 0)
 	{
-		i = spaces[j];
-		
-		state->grid[i] = 0;
+		scan = grade < diff && tried >= 3*s/4;
+		take = -1;
+		takediff = -1;
 		
-		status = seismic_solve_game(state, diff);
-		memcpy(state->grid, grid, s*sizeof(char));
-		
-		if(status != -1)
+		for(j = 0; j < n; j++)
 		{
+			i = spaces[j];
+			
 			state->grid[i] = 0;
-			grid[i] = 0;
+			
+			found = seismic_solve_game(state, diff, arena);
+			memcpy(state->grid, grid, s*sizeof(char));
+			tried++;
+			
+			/* Removing more numbers will not make this one redundant */
+			if(found == -1)
+			{
+				n--;
+				memmove(spaces+j, spaces+j+1, (n-j)*sizeof(int));
+				j--;
+				continue;
+			}
+			
+			if(found > takediff)
+			{
+				take = j;
+				takediff = found;
+			}
+			if(!scan || found == diff)
+				break;
 		}
+		
+		if(take < 0)
+			break;
+		
+		i = spaces[take];
+		state->grid[i] = 0;
+		grid[i] = 0;
+		grade = takediff;
+		
+		n--;
+		memmove(spaces+take, spaces+take+1, (n-take)*sizeof(int));
 	}
 	
-	sfree(spaces);
-	sfree(grid);
-	
-	return true;
-}
-
-static bool seismic_gen_diff(game_state *state, int diff)
-{
-	/* Verify the difficulty of the puzzle */
-	
-	game_state *solved;
-	bool ret = true;
-	
-	/* Check if puzzle is solvable */
-	solved = dup_game(state);
-	if(seismic_solve_game(solved, diff) == -1)
-		ret = false;
-	free_game(solved);
-	
-	if(diff <= 0 || !ret)
-		return ret;
+	arena_release(arena, mark);
 	
-	/* Check if puzzle is not solvable on lower difficulty */
-	solved = dup_game(state);
-	if(seismic_solve_game(solved, diff-1) != -1)
-		ret = false;
-	free_game(solved);
-	
-	return ret;
+	return grade;
 }
 
-static bool seismic_gen_puzzle(game_state *state, random_state *rs, int diff)
+static bool seismic_gen_puzzle(game_state *state, random_state *rs, int diff,
+	struct arena *arena)
 {
-	if (state->mode == MODE_TECTONIC && !tectonic_gen_numbers(state, rs))
-		return false;
-	if(state->mode == MODE_SEISMIC && !seismic_gen_numbers(state, rs))
-		return false;
-	if(!seismic_gen_areas(state, rs))
-		return false;
-	if(!seismic_gen_clues(state, rs, diff))
-		return false;
-	if(!seismic_gen_diff(state, diff))
-		return false;
+#ifdef STANDALONE_SOLVER
+	gen_attempts++;
+#endif
+	/*
+	 * Tectonic areas are generated first, and then filled in. A layout
+	 * which cannot be filled is replaced straight away, so that every
+	 * attempt gets a complete grid. Seismic areas are built around a
+	 * grid of numbers.
+	 */
+	if(state->mode == MODE_TECTONIC)
+	{
+		while(true)
+		{
+			tectonic_gen_areas(state, rs, arena);
+			if(tectonic_gen_numbers(state, rs, arena))
+				break;
+			dsf_reinit(state->dsf);
+		}
+	}
+	else
+	{
+		if(!seismic_gen_numbers(state, rs, arena))
+			return false;
+		if(!seismic_gen_areas(state, rs, arena))
+			return false;
+	}
 	
-	return true;
+	/*
+	 * Every removal is checked with a solve at the requested difficulty,
+	 * so the puzzle is always solvable. It is only rejected if it turned
+	 * out too easy.
+	 */
+	return seismic_gen_clues(state, rs, diff, arena) == diff;
 }
 
-static char *new_game_desc(const game_params *params, random_state *rs,
-			   char **aux, bool interactive)
+/*
+ * Walls are listed for each pair of horizontally adjacent squares, row
+ * by row, then for each pair of vertically adjacent squares.
+ */
+static void seismic_find_walls(const game_state *state, char *walls)
 {
-	int w = params->w;
-	int h = params->h;
-	int diff = params->diff;
-	int x, y, i, erun, wrun;
-	int hs = ((w-1)*h);
-	int ws = hs + (w*(h-1));
-	char *ret, *p, c;
-	
-	char *walls = snewn(ws, char);
-	game_state *state = blank_state(w, h, params->mode);
-	
-	do
-	{
-		memset(state->grid, 0, w*h*sizeof(char));
-		dsf_reinit(state->dsf);
-	}while(!seismic_gen_puzzle(state, rs, diff));
+	int w = state->w;
+	int h = state->h;
+	int x, y, i;
 	
-	/* Generate wall list */
 	i = 0;
 	for(y = 0; y < h; y++)
 	for(x = 0; x < w-1; x++)
@@ -962,6 +1232,50 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 			walls[i] = false;
 		i++;
 	}
+}
+
+static void seismic_merge_walls(game_state *state, const char *walls)
+{
+	int w = state->w;
+	int h = state->h;
+	int hs = ((w-1)*h);
+	int x, y, i, i1, i2;
+	
+	/* Merge horizontally */
+	for(y = 0; y < h; y++)
+	for(x = 0; x < w-1; x++)
+	{
+		i = (y*(w-1))+x;
+		i1 = y*w+x;
+		i2 = y*w+x+1;
+		if(!walls[i])
+			dsf_merge(state->dsf, i1, i2);
+	}
+	
+	/* Merge vertically */
+	for(y = 0; y < h-1; y++)
+	for(x = 0; x < w; x++)
+	{
+		i = hs + (y*w+x);
+		i1 = y*w+x;
+		i2 = (y+1)*w+x;
+		if(!walls[i])
+			dsf_merge(state->dsf, i1, i2);
+	}
+}
+
+/* Walls as alternating runs, then the clues with runs of empty squares */
+static char *seismic_encode_desc(const game_state *state)
+{
+	int w = state->w;
+	int h = state->h;
+	int i, erun, wrun;
+	int hs = ((w-1)*h);
+	int ws = hs + (w*(h-1));
+	char *ret, *p, c;
+	char *walls = snewn(ws, char);
+	
+	seismic_find_walls(state, walls);
 	
 	ret = snewn(ws + (w*h), char);
 	p = ret;
@@ -1024,8 +1338,107 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	
 	*p++ = '\0';
 	
-	free_game(state);
 	sfree(walls);
+	return ret;
+}
+
+#ifdef DESC_CODEC
+static void seismic_pack(const game_state *state, struct desc_writer *dw)
+{
+	int w = state->w;
+	int h = state->h;
+	int ws = ((w-1)*h) + (w*(h-1));
+	int i;
+	char *walls = snewn(ws, char);
+	
+	desc_put_varint(dw, w);
+	desc_put_varint(dw, h);
+	desc_put_bits(dw, state->mode == MODE_TECTONIC, 1);
+	
+	seismic_find_walls(state, walls);
+	for(i = 0; i < ws; i++)
+		desc_put_bits(dw, walls[i], 1);
+	sfree(walls);
+	
+	/* Clues 1 to 9 are stored as 0 to 8 */
+	for(i = 0; i < w*h; i++)
+	{
+		desc_put_bits(dw, state->grid[i] != 0, 1);
+		if(state->grid[i] != 0)
+			desc_put_bits(dw, state->grid[i] - 1, 4);
+	}
+}
+
+static game_state *seismic_unpack(struct desc_reader *dr, game_params **params)
+{
+	game_params *ret = default_params();
+	game_state *state;
+	int w, h, ws, i, c;
+	char *walls;
+	
+	*params = ret;
+	ret->w = w = desc_get_varint(dr);
+	ret->h = h = desc_get_varint(dr);
+	ret->mode = desc_get_bits(dr, 1) ? MODE_TECTONIC : MODE_SEISMIC;
+	if(dr->error || validate_params(ret, false))
+		return NULL;
+	if(!desc_need_bits(dr, ((double)(w-1)*h) + ((double)w*(h-1)) + ((double)w*h)))
+		return NULL;
+	
+	ws = ((w-1)*h) + (w*(h-1));
+	walls = snewn(ws, char);
+	for(i = 0; i < ws; i++)
+		walls[i] = desc_get_bits(dr, 1);
+	
+	state = blank_state(w, h, ret->mode);
+	seismic_merge_walls(state, walls);
+	sfree(walls);
+	
+	for(i = 0; i < w*h; i++)
+	{
+		if(!desc_get_bits(dr, 1))
+			continue;
+		c = desc_get_bits(dr, 4) + 1;
+		if(c > 9)
+		{
+			dr->error = true;
+			break;
+		}
+		state->grid[i] = c;
+		state->flags[i] = FM_FIXED;
+	}
+	
+	if(dr->error)
+	{
+		free_game(state);
+		return NULL;
+	}
+	return state;
+}
+
+const struct desc_codec thecodec = { seismic_pack, seismic_unpack, seismic_encode_desc };
+#endif
+
+static char *new_game_desc(const game_params *params, random_state *rs,
+			   char **aux, bool interactive)
+{
+	int w = params->w;
+	int h = params->h;
+	int diff = params->diff;
+	char *ret;
+	
+	game_state *state = blank_state(w, h, params->mode);
+	struct arena *arena = arena_new();
+	
+	do
+	{
+		memset(state->grid, 0, w*h*sizeof(char));
+		dsf_reinit(state->dsf);
+	}while(!seismic_gen_puzzle(state, rs, diff, arena));
+	
+	ret = seismic_encode_desc(state);
+	free_game(state);
+	arena_free(arena);
 	
 	return ret;
 }
@@ -1037,7 +1450,7 @@ static int seismic_read_desc(const game_params *params, const char *desc, game_s
 	int w = params->w;
 	int h = params->h;
 	int erun, wrun;
-	int i, x, y, i1, i2;
+	int i;
 	int valid = VALID;
 	const char *p = desc;
 	int hs = ((w-1)*h);
@@ -1087,28 +1500,10 @@ static int seismic_read_desc(const game_params *params, const char *desc, game_s
 		}
 	}
 	
-	/* Merge horizontally */
-	for(y = 0; y < h; y++)
-	for(x = 0; x < w-1; x++)
-	{
-		i = (y*(w-1))+x;
-		i1 = y*w+x;
-		i2 = y*w+x+1;
-		if(!walls[i])
-			dsf_merge(state->dsf, i1, i2);
-	}
+	seismic_merge_walls(state, walls);
 	
-	/* Merge vertically */
-	for(y = 0; y < h-1; y++)
-	for(x = 0; x < w; x++)
-	{
-		i = hs + (y*w+x);
-		i1 = y*w+x;
-		i2 = (y+1)*w+x;
-		if(!walls[i])
-			dsf_merge(state->dsf, i1, i2);
-	}
-	p++;
+	if(*p)
+		p++;
 	erun = 0;
 	for(i = 0; i < w*h; i++)
 	{
@@ -1216,8 +1611,10 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	char *ret = snewn(s+2, char);
 	char *p = ret;
 	game_state *solved = dup_game(state);
+	struct arena *arena = arena_new();
 	
-	seismic_solve_game(solved, DIFFCOUNT);
+	seismic_solve_game(solved, DIFFCOUNT, arena);
+	arena_free(arena);
 	
 	*p++ = 'S';
 	for(i = 0; i < s; i++)
@@ -1487,6 +1884,7 @@ static game_state *execute_move(const game_state *oldstate, const char *move)
 	int x, y;
 	char c;
 	game_state *state;
+	struct arena *arena;
 	
 	if ((move[0] == 'P' || move[0] == 'R') &&
 			sscanf(move+1, "%d,%d,%c", &x, &y, &c) == 3 &&
@@ -1514,8 +1912,10 @@ static game_state *execute_move(const game_state *oldstate, const char *move)
 				state->marks[y*w+x] ^= NUM_BIT(c - '0');
 		}
 		
-		if(seismic_validate_game(state) == STATUS_COMPLETE)
+		arena = arena_new();
+		if(seismic_validate_game(state, arena) == STATUS_COMPLETE)
 			state->completed = true;
+		arena_free(arena);
 		return state;
 	}
 	
@@ -1539,7 +1939,9 @@ static game_state *execute_move(const game_state *oldstate, const char *move)
 			i++;
 		}
 		
-		state->completed = (seismic_validate_game(state) == STATUS_COMPLETE);
+		arena = arena_new();
+		state->completed = (seismic_validate_game(state, arena) == STATUS_COMPLETE);
+		arena_free(arena);
 		state->cheated = state->completed;
 		return state;
 	}
@@ -1952,6 +2354,9 @@ const struct game thegame = {
 #include <time.h>
 #include <stdarg.h>
 
+#include "genbatch.h"
+#include "solvestream.h"
+
 /* Most of the standalone solver code was copied from unequal.c and singles.c */
 
 const char *quis;
@@ -1961,15 +2366,84 @@ static void usage_exit(const char *msg)
 	if (msg)
 		fprintf(stderr, "%s: %s\n", quis, msg);
 	fprintf(stderr,
-			"Usage: %s [-v] [--seed SEED] <params> | [game_id [game_id ...]]\n",
+			"Usage: %s [-v] [--seed SEED] [--bench COUNT] [--generate COUNT] [--stream] <params> | [game_id [game_id ...]]\n",
 			quis);
 	exit(1);
 }
 
+/*
+ * Generate a number of puzzles, and report how many attempts each one
+ * took and how long it took to generate.
+ */
+static void seismic_bench(game_params *params, random_state *rs, int count)
+{
+	char *desc, *aux;
+	clock_t start, time, total = 0;
+	long attempts = 0, failed = 0, backjumps = 0;
+	int i;
+
+	printf("puzzle\tattempts\tfailed_fills\tbackjumps\tmsec\n");
+	for(i = 0; i < count; i++)
+	{
+		gen_attempts = gen_failed_fills = gen_backjumps = 0;
+		start = clock();
+		desc = new_game_desc(params, rs, &aux, false);
+		time = clock() - start;
+
+		printf("%d\t%ld\t%ld\t%ld\t%.1f\n", i+1, gen_attempts,
+			gen_failed_fills, gen_backjumps, time * 1000.0 / CLOCKS_PER_SEC);
+		attempts += gen_attempts;
+		failed += gen_failed_fills;
+		backjumps += gen_backjumps;
+		total += time;
+		sfree(desc);
+	}
+
+	printf("Average: %.2f attempts, %.2f failed fills, %.1f backjumps, %.1f ms\n",
+		(double)attempts / count, (double)failed / count,
+		(double)backjumps / count, total * 1000.0 / CLOCKS_PER_SEC / count);
+	printf("Scratch: %.1f allocations from %.1f heap blocks\n",
+		(double)arena_total_allocs / count, (double)arena_total_blocks / count);
+}
+
+/* Difficulty level of a generated puzzle, for --generate */
+static const char *seismic_grade(const game_params *params, const char *desc)
+{
+	game_state *state = new_game(NULL, params, desc);
+	struct arena *arena = arena_new();
+	int diff = seismic_solve_game(state, DIFFCOUNT, arena);
+
+	arena_free(arena);
+	free_game(state);
+	return diff < 0 ? "Unsolved" : seismic_diffnames[diff];
+}
+
+static const char *const seismic_usenames[] = { "marks", "areas", "attempt" };
+
+/* Solve one puzzle for --stream, using the arena in ctx */
+static void seismic_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+	struct arena *arena = ctx;
+	int diff;
+
+	memset(solver_uses, 0, sizeof(solver_uses));
+	diff = seismic_solve_game(state, DIFFCOUNT, arena);
+	if(diff >= 0)
+	{
+		res->status = "Solved";
+		res->diff = seismic_diffnames[diff];
+	}
+	else if(seismic_validate_game(state, arena) == STATUS_INVALID)
+		res->status = "Invalid";
+	solvestream_counts(res, seismic_usenames, solver_uses, USECOUNT);
+}
+
 int main(int argc, char *argv[])
 {
 	random_state *rs;
 	time_t seed = time(NULL);
+	int bench = 0, generate = 0;
+	bool stream = false;
 
 	game_params *params = NULL;
 
@@ -1985,7 +2459,24 @@ int main(int argc, char *argv[])
 				usage_exit("--seed needs an argument");
 			seed = (time_t) atoi(*++argv);
 			argc--;
-		} else if (!strcmp(p, "-v"))
+		} else if (!strcmp(p, "--bench")) {
+			if (argc == 0)
+				usage_exit("--bench needs an argument");
+			bench = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--generate")) {
+			if (argc == 0)
+				usage_exit("--generate needs an argument");
+			generate = atoi(*++argv);
+			argc--;
+		} else if (!strcmp(p, "--params")) {
+			if (argc == 0)
+				usage_exit("--params needs an argument");
+			id = *++argv;
+			argc--;
+		} else if (!strcmp(p, "--stream"))
+			stream = true;
+		else if (!strcmp(p, "-v"))
 			solver_verbose = true;
 		else if (*p == '-')
 			usage_exit("unrecognised option");
@@ -2008,7 +2499,28 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	if (!desc) {
+	if (stream) {
+		struct arena *arena;
+		if (id)
+			usage_exit("--stream reads game IDs from stdin");
+		arena = arena_new();
+		solvestream_run(stdin, seismic_stream_solve, arena);
+		arena_free(arena);
+	} else if (generate) {
+		if (desc)
+			usage_exit("--generate needs parameters, not a game ID");
+		if (!params)
+			params = default_params();
+		genbatch_run(params, (unsigned long)seed, generate, &gen_attempts,
+			seismic_grade);
+	} else if (bench) {
+		rs = random_new((void *) &seed, sizeof(time_t));
+		if (!params)
+			params = default_params();
+		printf("Generating %d puzzles with parameters %s\n", bench,
+			   encode_params(params, true));
+		seismic_bench(params, rs, bench);
+	} else if (!desc) {
 		char *desc_gen, *aux;
 		rs = random_new((void *) &seed, sizeof(time_t));
 		if (!params)
@@ -2024,8 +2536,11 @@ int main(int argc, char *argv[])
 		}
 
 		printf("Game ID: %s\n", desc_gen);
+		printf("Scratch: %lu allocations from %lu heap blocks\n",
+			arena_total_allocs, arena_total_blocks);
 	} else {
 		game_state *input;
+		struct arena *arena;
 		int maxdiff;
 
 		err = validate_desc(params, desc);
@@ -2037,7 +2552,9 @@ int main(int argc, char *argv[])
 
 		input = new_game(NULL, params, desc);
 
-		maxdiff = seismic_solve_game(input, DIFFCOUNT);
+		arena = arena_new();
+		maxdiff = seismic_solve_game(input, DIFFCOUNT, arena);
+		arena_free(arena);
 
 		char *fmt = game_text_format(input);
 		fputs(fmt, stdout);
@@ -0,0 +1,178 @@
+/*
+ * solvestream.h: Solving a stream of game IDs for the standalone solvers.
+ * See LICENCE for licence details
+ *
+ * With --stream, a standalone solver reads game IDs from stdin, one per
+ * line, and solves each of them in turn. As for pack.c, anything up to
+ * the last tab of a line is ignored. One line of tab-separated values is
+ * written for each: the line number, the status, the difficulty needed,
+ * how often each technique made progress, and the time spent solving in
+ * microseconds. A summary is written to stderr at the end.
+ *
+ * Memory use does not grow with the input. Lines are read into a single
+ * buffer, and longer ones are skipped and reported as too long. The
+ * parameters are only decoded again when they differ from the previous
+ * line, and each game state is freed before the next line is read.
+ * Scratch which the solver keeps from one puzzle to the next, such as
+ * an arena or a trail, is passed to the game through ctx.
+ *
+ * This file is included by the standalone code at the end of a game,
+ * after thegame has been defined.
+ */
+
+#ifndef PUZZLES_SOLVESTREAM_H
+#define PUZZLES_SOLVESTREAM_H
+
+/* Longest line read, including the newline */
+#define SOLVESTREAM_MAX_LINE 65536
+/* Room for the technique counts of one puzzle */
+#define SOLVESTREAM_MAX_COUNTS 256
+
+struct solvestream_result {
+	/* One of "Solved", "Unfinished", "Ambiguous" or "Invalid" */
+	const char *status;
+	/* The difficulty needed, or NULL if it is not known */
+	const char *diff;
+	/* Technique counts as name=count pairs, or empty if not counted */
+	char counts[SOLVESTREAM_MAX_COUNTS];
+};
+
+/*
+ * Solve the state in place. The state is freed by the caller afterwards,
+ * and the result has been cleared.
+ */
+typedef void (*solvestream_fn)(game_state *state, void *ctx, struct solvestream_result *res);
+
+/* Write the nonzero counts out as name=count pairs */
+static inline void solvestream_counts(struct solvestream_result *res,
+	const char *const *names, const long *counts, int n)
+{
+	char *p = res->counts, *end = res->counts + SOLVESTREAM_MAX_COUNTS;
+	int i;
+
+	*p = '\0';
+	for(i = 0; i < n; i++)
+	{
+		if(!counts[i])
+			continue;
+		p += snprintf(p, end - p, "%s%s=%ld", p == res->counts ? "" : ",",
+			names[i], counts[i]);
+		if(p >= end)
+			break;
+	}
+}
+
+/* Read a line, and return its length or -1 at the end of the input */
+static int solvestream_read(FILE *fp, char *buf, bool *toolong)
+{
+	int len, c;
+
+	*toolong = false;
+	if(!fgets(buf, SOLVESTREAM_MAX_LINE, fp))
+		return -1;
+
+	len = strlen(buf);
+	if(len > 0 && buf[len-1] == '\n')
+		buf[--len] = '\0';
+	else if(!feof(fp))
+	{
+		/* Skip the rest of the line */
+		*toolong = true;
+		while((c = getc(fp)) != EOF && c != '\n');
+		return 0;
+	}
+	if(len > 0 && buf[len-1] == '\r')
+		buf[--len] = '\0';
+	return len;
+}
+
+static void solvestream_run(FILE *fp, solvestream_fn solve, void *ctx)
+{
+	char *buf = snewn(SOLVESTREAM_MAX_LINE, char);
+	char *lastparams = snewn(SOLVESTREAM_MAX_LINE, char);
+	char *id, *desc;
+	game_params *params = NULL;
+	game_state *state;
+	struct solvestream_result res;
+	clock_t start, begin = clock();
+	double usec, total = 0;
+	long lineno = 0, solved = 0, unsolved = 0, failed = 0;
+	bool toolong;
+
+	*lastparams = '\0';
+	printf("line\tstatus\tdifficulty\tcounts\tusec\n");
+	while(solvestream_read(fp, buf, &toolong) >= 0)
+	{
+		lineno++;
+		if(toolong)
+		{
+			printf("%ld\tToolong\t-\t-\t-\n", lineno);
+			failed++;
+			continue;
+		}
+
+		id = strrchr(buf, '\t');
+		id = id ? id + 1 : buf;
+		if(!*id)
+			continue;
+		desc = strchr(id, ':');
+		if(desc)
+			*desc++ = '\0';
+
+		if(!params || strcmp(id, lastparams))
+		{
+			if(params)
+				thegame.free_params(params);
+			params = thegame.default_params();
+			thegame.decode_params(params, id);
+			strcpy(lastparams, id);
+			if(thegame.validate_params(params, false))
+			{
+				thegame.free_params(params);
+				params = NULL;
+			}
+		}
+
+		if(!desc || !params || thegame.validate_desc(params, desc))
+		{
+			printf("%ld\tBadid\t-\t-\t-\n", lineno);
+			failed++;
+			continue;
+		}
+
+		state = thegame.new_game(NULL, params, desc);
+		res.status = "Unfinished";
+		res.diff = NULL;
+		res.counts[0] = '\0';
+
+		start = clock();
+		solve(state, ctx, &res);
+		usec = (clock() - start) * 1000000.0 / CLOCKS_PER_SEC;
+		total += usec;
+		thegame.free_game(state);
+
+		if(!strcmp(res.status, "Solved"))
+			solved++;
+		else
+			unsolved++;
+		printf("%ld\t%s\t%s\t%s\t%.0f\n", lineno, res.status,
+			res.diff ? res.diff : "-", res.counts[0] ? res.counts : "-", usec);
+	}
+
+	if(solved + unsolved > 0)
+	{
+		double secs = (double)(clock() - begin) / CLOCKS_PER_SEC;
+		fprintf(stderr, "%ld puzzles solved, %ld not solved, %ld unreadable\n",
+			solved, unsolved, failed);
+		fprintf(stderr, "%.2f s in all, %.1f per second, %.1f usec solving each\n",
+			secs, secs > 0 ? (solved + unsolved) / secs : 0.0,
+			total / (solved + unsolved));
+	}
+
+	if(params)
+		thegame.free_params(params);
+	sfree(lastparams);
+	sfree(buf);
+}
+
+#endif
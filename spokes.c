@@ -18,6 +18,7 @@
 #include <math.h>
 
 #include "puzzles.h"
+#include "trail.h"
 
 #ifdef STANDALONE_SOLVER
 bool solver_debug = false;
@@ -416,17 +417,23 @@ static void free_game(game_state *state)
     sfree(state);
 }
 
-static int spokes_place(game_state *state, int i, int dir, int s)
+static int spokes_place(game_state *state, int i, int dir, int s, struct trail *trail)
 {
 	int x, y;
 	int w = state->w;
-	SET_SPOKE(state->spokes[i], dir, s);
+	hub_t hub = state->spokes[i];
+	SET_SPOKE(hub, dir, s);
+	trail_set_uint(trail, &state->spokes[i], hub);
 	
 	x = (i%w) + spoke_dirs[dir].dx;
 	y = (i/w) + spoke_dirs[dir].dy;
 		
 	if(x >= 0 && x < w && y >= 0 && y < state->h)
-		SET_SPOKE(state->spokes[y*w+x], INV_DIR(dir), s);
+	{
+		hub = state->spokes[y*w+x];
+		SET_SPOKE(hub, INV_DIR(dir), s);
+		trail_set_uint(trail, &state->spokes[y*w+x], hub);
+	}
 	
 	return 1;
 }
@@ -529,7 +536,7 @@ static void spokes_solver_recount(const game_state *state, struct spokes_scratch
 	}
 }
 
-static int spokes_solver_full(game_state *state, struct spokes_scratch *solver)
+static int spokes_solver_full(game_state *state, struct spokes_scratch *solver, struct trail *trail)
 {
 	int ret = 0;
 	int i, j;
@@ -543,7 +550,7 @@ static int spokes_solver_full(game_state *state, struct spokes_scratch *solver)
 		{
 			for(j = 0; j < 8; j++) {
 				if(GET_SPOKE(state->spokes[i], j) == SPOKE_EMPTY) {
-					spokes_place(state, i, j, SPOKE_LINE);
+					spokes_place(state, i, j, SPOKE_LINE, trail);
 					changed = true;
 				}
 			}
@@ -554,7 +561,7 @@ static int spokes_solver_full(game_state *state, struct spokes_scratch *solver)
 			/* No more lines can be placed here, mark the rest of the spokes */
 			for(j = 0; j < 8; j++) {
 				if(GET_SPOKE(state->spokes[i], j) == SPOKE_EMPTY) {
-					spokes_place(state, i, j, SPOKE_MARKED);
+					spokes_place(state, i, j, SPOKE_MARKED, trail);
 					changed = true;
 				}
 			}
@@ -566,7 +573,7 @@ static int spokes_solver_full(game_state *state, struct spokes_scratch *solver)
 	return ret;
 }
 
-static int spokes_solver_diagonal(game_state *state)
+static int spokes_solver_diagonal(game_state *state, struct trail *trail)
 {
 	int ret = 0;
 	int x, y;
@@ -579,17 +586,17 @@ static int spokes_solver_diagonal(game_state *state)
 	{
 		if(GET_SPOKE(state->spokes[y*w+x], DIR_BOTRIGHT) == SPOKE_LINE && 
 				GET_SPOKE(state->spokes[y*w+x+1], DIR_BOTLEFT) == SPOKE_EMPTY)
-			ret += spokes_place(state, y*w+x+1, DIR_BOTLEFT, SPOKE_MARKED);
+			ret += spokes_place(state, y*w+x+1, DIR_BOTLEFT, SPOKE_MARKED, trail);
 		
 		if(GET_SPOKE(state->spokes[y*w+x], DIR_BOTRIGHT) == SPOKE_EMPTY && 
 				GET_SPOKE(state->spokes[y*w+x+1], DIR_BOTLEFT) == SPOKE_LINE)
-			ret += spokes_place(state, y*w+x, DIR_BOTRIGHT, SPOKE_MARKED);
+			ret += spokes_place(state, y*w+x, DIR_BOTRIGHT, SPOKE_MARKED, trail);
 	}
 	
 	return ret ? 1 : 0;
 }
 
-static int spokes_solver_ones(game_state *state)
+static int spokes_solver_ones(game_state *state, struct trail *trail)
 {
 	/* Connecting two 1's would lead to a group of 2 hubs with no possibility
 	 * of connecting the rest. Mark every spoke connecting two 1's. */
@@ -623,7 +630,7 @@ static int spokes_solver_ones(game_state *state)
 				continue;
 			
 			if(state->numbers[dy*w+dx] == 1)
-				ret += spokes_place(state, y*w+x, j, SPOKE_MARKED);
+				ret += spokes_place(state, y*w+x, j, SPOKE_MARKED, trail);
 		}
 	}
 	
@@ -631,12 +638,24 @@ static int spokes_solver_ones(game_state *state)
 }
 
 enum { STATUS_INVALID, STATUS_INCOMPLETE, STATUS_VALID };
-static int spokes_solve(game_state *state, struct spokes_scratch *solver, int diff);
+static int spokes_solve(game_state *state, struct spokes_scratch *solver, int diff,
+	struct trail *trail);
 
-static int spokes_solver_attempt(game_state *state, game_state *copy, struct spokes_scratch *solver, int diff)
+#ifdef STANDALONE_SOLVER
+/* How often each technique made progress, reported by --stream */
+enum { USE_FULL, USE_DIAGONAL, USE_LIMITED, USE_ATTEMPT, USECOUNT };
+static long solver_uses[USECOUNT];
+#define SOLVER_USED(t) (solver_uses[t]++)
+#else
+#define SOLVER_USED(t) ((void)0)
+#endif
+
+static int spokes_solver_attempt(game_state *state, struct trail *trail, struct spokes_scratch *solver, int diff)
 {
+	/* Place a spoke, and solve on from there at a lower difficulty.
+	 * The trial is undone by rolling back the trail. */
 	int ret = 0;
-	int i, dir, l, w = state->w, h = state->h;
+	int i, dir, l, mark, status, w = state->w, h = state->h;
 #ifdef STANDALONE_SOLVER
 	bool temp_debug = solver_debug;
 	solver_debug = false;
@@ -650,11 +669,12 @@ static int spokes_solver_attempt(game_state *state, game_state *copy, struct spo
 				if(GET_SPOKE(state->spokes[i], dir) != SPOKE_EMPTY)
 					continue;
 				
-				duplicate_game(state, copy);
-				
-				spokes_place(copy, i, dir, l ? SPOKE_LINE : SPOKE_MARKED);
-				if(spokes_solve(copy, solver, diff) == STATUS_INVALID)
-					ret += spokes_place(state, i, dir, l ? SPOKE_MARKED : SPOKE_LINE);
+				mark = trail_mark(trail);
+				spokes_place(state, i, dir, l ? SPOKE_LINE : SPOKE_MARKED, trail);
+				status = spokes_solve(state, solver, diff, trail);
+				trail_rollback(trail, mark);
+				if(status == STATUS_INVALID)
+					ret += spokes_place(state, i, dir, l ? SPOKE_MARKED : SPOKE_LINE, trail);
 			}
 		}
 	}
@@ -758,18 +778,23 @@ static char *game_text_format(const game_state *state);
 
 #define ACTION_LIMIT 4
 
-static int spokes_solve(game_state *state, struct spokes_scratch *solver, int diff)
+/*
+ * Every spoke placed by the solver goes on the trail, so that a trial
+ * can undo the whole nested solve. trail may be NULL, in which case one
+ * is made if trials are needed.
+ */
+static int spokes_solve(game_state *state, struct spokes_scratch *solver, int diff,
+	struct trail *trail)
 {
-	game_state *copy = NULL;
 	bool hassolver = solver != NULL;
+	bool hastrail = trail != NULL;
 	if(!hassolver)
 		solver = spokes_new_scratch(state);
+	if(!hastrail && diff >= DIFF_TRICKY)
+		trail = trail_new();
 	int ret, action, total = 0;
 	
-	spokes_solver_ones(state);
-
-	if(diff >= DIFF_TRICKY)
-		copy = dup_game(state);
+	spokes_solver_ones(state, trail);
 	
 	while(true)
 	{
@@ -778,12 +803,14 @@ static int spokes_solve(game_state *state, struct spokes_scratch *solver, int di
 		if(diff == DIFF_LIMITED && total >= ACTION_LIMIT)
 			break;
 		
-		if((action = spokes_solver_full(state, solver))) {
+		if((action = spokes_solver_full(state, solver, trail))) {
+			SOLVER_USED(USE_FULL);
 			total += action;
 			continue;
 		}
 		
-		if((action = spokes_solver_diagonal(state))) {
+		if((action = spokes_solver_diagonal(state, trail))) {
+			SOLVER_USED(USE_DIAGONAL);
 			total += action;
 			continue;
 		}
@@ -791,14 +818,18 @@ static int spokes_solve(game_state *state, struct spokes_scratch *solver, int di
 		if(diff < DIFF_TRICKY)
 			break;
 		
-		if(diff == DIFF_TRICKY && spokes_solver_attempt(state, copy, solver, DIFF_LIMITED))
+		if(diff == DIFF_TRICKY && spokes_solver_attempt(state, trail, solver, DIFF_LIMITED)) {
+			SOLVER_USED(USE_LIMITED);
 			continue;
+		}
 
 		if(diff < DIFF_HARD)
 			break;
 
-		if(spokes_solver_attempt(state, copy, solver, DIFF_EASY))
+		if(spokes_solver_attempt(state, trail, solver, DIFF_EASY)) {
+			SOLVER_USED(USE_ATTEMPT);
 			continue;
+		}
 		
 		break;
 	}
@@ -807,8 +838,8 @@ static int spokes_solve(game_state *state, struct spokes_scratch *solver, int di
 	
 	if(!hassolver)
 		spokes_free_scratch(solver);
-	if(copy)
-		free_game(copy);
+	if(!hastrail)
+		trail_free(trail);
 	
 #ifdef STANDALONE_SOLVER
 	if(solver_debug)
@@ -841,7 +872,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	
 	game_state *solved = dup_game(state);
 	
-	spokes_solve(solved, NULL, DIFFCOUNT);
+	spokes_solve(solved, NULL, DIFFCOUNT, NULL);
 	
 	buf = snewn(3+(w*h*80), char);
 	p = buf;
@@ -878,14 +909,14 @@ static int spokes_generate_hubs(const game_params *params, game_state *state, in
 	for (y = 0; y < h; y++)
 		for (x = 0; x < w - 1; x++)
 		{
-			spokes_place(state, y*w + x, DIR_RIGHT, SPOKE_LINE);
+			spokes_place(state, y*w + x, DIR_RIGHT, SPOKE_LINE, NULL);
 			temp[ret++] = ((y*w + x) << 3) | DIR_RIGHT;
 		}
 
 	for (y = 0; y < h - 1; y++)
 		for (x = 0; x < w; x++)
 		{
-			spokes_place(state, y*w + x, DIR_BOT, SPOKE_LINE);
+			spokes_place(state, y*w + x, DIR_BOT, SPOKE_LINE, NULL);
 			temp[ret++] = ((y*w + x) << 3) | DIR_BOT;
 		}
 
@@ -894,12 +925,12 @@ static int spokes_generate_hubs(const game_params *params, game_state *state, in
 		{
 			if (random_upto(rs, 2))
 			{
-				spokes_place(state, y*w + x, DIR_BOTRIGHT, SPOKE_LINE);
+				spokes_place(state, y*w + x, DIR_BOTRIGHT, SPOKE_LINE, NULL);
 				temp[ret++] = ((y*w + x) << 3) | DIR_BOTRIGHT;
 			}
 			else
 			{
-				spokes_place(state, y*w + x + 1, DIR_BOTLEFT, SPOKE_LINE);
+				spokes_place(state, y*w + x + 1, DIR_BOTLEFT, SPOKE_LINE, NULL);
 				temp[ret++] = ((y*w + x + 1) << 3) | DIR_BOTLEFT;
 			}
 		}
@@ -970,22 +1001,27 @@ static bool spokes_generate(const game_params *params, game_state *generated, ga
 
 		blank_game(params, state);
 
-		spokes_place(generated, i, d, SPOKE_EMPTY);
+		spokes_place(generated, i, d, SPOKE_EMPTY, NULL);
 
 		for (k = 0; k < w*h; k++)
 			state->numbers[k] = spokes_count(generated->spokes[k], SPOKE_LINE);
 		
 		spokes_generate_clear(state);
 
-		if(spokes_solve(state, solver, params->diff) != STATUS_VALID)
-			spokes_place(generated, i, d, SPOKE_LINE);
+		if(spokes_solve(state, solver, params->diff, NULL) != STATUS_VALID)
+			spokes_place(generated, i, d, SPOKE_LINE, NULL);
 	}
 
 	for (k = 0; k < w*h; k++)
 		state->numbers[k] = spokes_count(generated->spokes[k], SPOKE_LINE);
-	return params->diff == DIFF_EASY || spokes_solve(state, solver, params->diff - 1) != STATUS_VALID;
+	return params->diff == DIFF_EASY || spokes_solve(state, solver, params->diff - 1, NULL) != STATUS_VALID;
 }
 
+#ifdef STANDALONE_SOLVER
+/* Generator attempts, reported by --generate */
+static long gen_attempts;
+#endif
+
 static char *new_game_desc(const game_params *params, random_state *rs,
 			   char **aux, bool interactive)
 {
@@ -1002,6 +1038,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	while(!spokes_generate(params, generated, state, solver, temp, rs)) { attempts++; };
 
 #ifdef STANDALONE_SOLVER
+	gen_attempts = attempts + 1;
 	if(solver_debug)
 	{
 		printf("Generated puzzle in %d attempts\n", attempts);
@@ -1271,7 +1308,7 @@ static game_state *execute_move(const game_state *state, const char *move)
 				for(j = 0; j < 4; j++)
 				{
 					if(GET_SPOKE(ret->spokes[i], j) != SPOKE_HIDDEN)
-						spokes_place(ret, i, j, SPOKE_EMPTY);
+						spokes_place(ret, i, j, SPOKE_EMPTY, NULL);
 				}
 			}
 			
@@ -1285,7 +1322,7 @@ static game_state *execute_move(const game_state *state, const char *move)
 			if(!ret) ret = dup_game(state);
 			
 			if(GET_SPOKE(ret->spokes[i], d) != SPOKE_HIDDEN)
-				spokes_place(ret, i, d, s);
+				spokes_place(ret, i, d, s, NULL);
 		}
 		while(*p && *p++ != ';');
 	}
@@ -1751,6 +1788,9 @@ const struct game thegame = {
 #include <time.h>
 #include <stdarg.h>
 
+#include "genbatch.h"
+#include "solvestream.h"
+
 /* Most of the standalone solver code was copied from unequal.c and singles.c */
 
 const char *quis;
@@ -1760,16 +1800,81 @@ static void usage_exit(const char *msg)
 	if (msg)
 		fprintf(stderr, "%s: %s\n", quis, msg);
 	fprintf(stderr,
-			"Usage: %s [-d] [--seed SEED] [--soak AMOUNT] <params> | [game_id [game_id ...]]\n",
+			"Usage: %s [-d] [--seed SEED] [--soak AMOUNT] [--generate COUNT] [--stream] <params> | [game_id [game_id ...]]\n",
 			quis);
 	exit(1);
 }
 
+/* Lowest difficulty level which solves a generated puzzle, for --generate */
+static const char *spokes_grade(const game_params *params, const char *desc)
+{
+	game_state *state;
+	int diff, status;
+
+	for(diff = 0; diff < DIFFCOUNT; diff++)
+	{
+		state = new_game(NULL, params, desc);
+		status = spokes_solve(state, NULL, diff, NULL);
+		free_game(state);
+		if(status == STATUS_VALID)
+			break;
+	}
+
+	return diff < DIFFCOUNT ? spokes_diffnames[diff] : "Unsolved";
+}
+
+/* Solver scratch for --stream, kept for as long as the grid size stays the same */
+struct spokes_stream {
+	struct spokes_scratch *solver;
+	int w, h;
+};
+
+static const char *const spokes_usenames[] = { "full", "diagonal", "limited", "attempt" };
+
+/* Solve one puzzle for --stream at each difficulty in turn, as for --generate */
+static void spokes_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+	struct spokes_stream *stream = ctx;
+	game_state *copy;
+	int diff, status = STATUS_INCOMPLETE;
+
+	if(stream->solver && (stream->w != state->w || stream->h != state->h))
+	{
+		spokes_free_scratch(stream->solver);
+		stream->solver = NULL;
+	}
+	if(!stream->solver)
+	{
+		stream->solver = spokes_new_scratch(state);
+		stream->w = state->w;
+		stream->h = state->h;
+	}
+
+	for(diff = 0; diff < DIFFCOUNT && status == STATUS_INCOMPLETE; diff++)
+	{
+		memset(solver_uses, 0, sizeof(solver_uses));
+		copy = dup_game(state);
+		status = spokes_solve(copy, stream->solver, diff, NULL);
+		free_game(copy);
+	}
+
+	if(status == STATUS_VALID)
+	{
+		res->status = "Solved";
+		res->diff = spokes_diffnames[diff - 1];
+	}
+	else if(status == STATUS_INVALID)
+		res->status = "Invalid";
+	solvestream_counts(res, spokes_usenames, solver_uses, USECOUNT);
+}
+
 int main(int argc, char *argv[])
 {
 	random_state *rs;
 	time_t seed = time(NULL);
 	time_t tt_start, tt_end;
+	int generate = 0;
+	bool stream = false;
 	
 	game_params *params = NULL;
 
@@ -1795,6 +1900,20 @@ int main(int argc, char *argv[])
 				usage_exit("--soak argument must be at least 1");
 			argc--;
 		}
+		else if (!strcmp(p, "--generate")) {
+			if (argc == 0)
+				usage_exit("--generate needs an argument");
+			generate = atoi(*++argv);
+			argc--;
+		}
+		else if (!strcmp(p, "--params")) {
+			if (argc == 0)
+				usage_exit("--params needs an argument");
+			id = *++argv;
+			argc--;
+		}
+		else if (!strcmp(p, "--stream"))
+			stream = true;
 		else if (!strcmp(p, "-d"))
 			solver_debug = true;
 		else if (*p == '-')
@@ -1818,7 +1937,21 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	if (!desc) {
+	if (stream) {
+		struct spokes_stream scratch = { NULL, 0, 0 };
+		if (id)
+			usage_exit("--stream reads game IDs from stdin");
+		solvestream_run(stdin, spokes_stream_solve, &scratch);
+		if (scratch.solver)
+			spokes_free_scratch(scratch.solver);
+	} else if (generate) {
+		if (desc)
+			usage_exit("--generate needs parameters, not a game ID");
+		if (!params)
+			params = default_params();
+		genbatch_run(params, (unsigned long)seed, generate, &gen_attempts,
+			spokes_grade);
+	} else if (!desc) {
 		int i;
 		char *desc_gen, *aux, *fmt;
 		rs = random_new((void *) &seed, sizeof(time_t));
@@ -1861,7 +1994,7 @@ int main(int argc, char *argv[])
 
 		input = new_game(NULL, params, desc);
 
-		valid = spokes_solve(input, NULL, DIFFCOUNT);
+		valid = spokes_solve(input, NULL, DIFFCOUNT, NULL);
 
 		char *fmt = game_text_format(input);
 		fputs(fmt, stdout);
@@ -261,165 +261,156 @@ static void sticks_make_dsf(game_state *state, DSF *dsf, int *lengths)
 	}
 }
 
-static int sticks_max_size_horizontal(game_state *state, DSF *dsf, int *lengths, int idx)
+static bool sticks_can_enter(const game_state *state, int start, int step,
+	int line, const int *owner, int k, int next)
 {
-	int w = state->w;
-	int c, x, y = idx / w;
-	int ret = 1;
-	int action;
+	/* Check if a line from another segment can be extended into position k */
+	int cross = line == F_HOR ? F_VER : F_HOR;
 
-	for (action = -1; action < 2; action += 2)
+	if (state->grid[start + k*step] & (F_BLOCK | cross) || owner[k] != -1)
+		return false;
+	if (next != -1 && state->grid[start + next*step] & line && owner[next] != -1)
+		return false;
+	return true;
+}
+
+static void sticks_line_reach(const game_state *state, int start, int step, int len,
+	int line, int *owner, int *size, int *lo, int *hi)
+{
+	/*
+	 * Look at a single row (for horizontal lines) or column (for vertical
+	 * lines), given by its first cell, the step between cells and the
+	 * number of cells. Positions in the arrays are counted along the line.
+	 *
+	 * owner is the position of the number in each segment, -1 if there is
+	 * none and -2 if there are several. size is the length of the segment.
+	 * lo and hi are the first and last position a line going through the
+	 * cell could extend to. It can pass through its own segment, and
+	 * through cells which don't belong to another number. It can't enter
+	 * a cell if the cell after it belongs to another number.
+	 */
+	int j, k, m, n, next;
+
+	for (k = 0; k < len; k = j)
 	{
-		x = (idx%w) + action;
-		while (x >= 0 && x < w)
+		j = k + 1;
+		if (!(state->grid[start + k*step] & line))
 		{
-			if (state->grid[y*w + x] & (F_BLOCK | F_VER))
-				break;
+			owner[k] = state->numbers[start + k*step] != -1 ? k : -1;
+			size[k] = 1;
+			continue;
+		}
 
-			c = dsf_canonify(dsf, y*w + x);
-			if (lengths[c] != -1 && lengths[c] != idx)
-				break;
+		n = -1;
+		for (j = k; j < len && state->grid[start + j*step] & line; j++)
+		{
+			if (state->numbers[start + j*step] != -1)
+				n = n == -1 ? j : -2;
+		}
+		for (m = k; m < j; m++)
+		{
+			owner[m] = n;
+			size[m] = j - k;
+		}
+	}
 
-			if (action == -1 && x > 1 && state->grid[y*w + x - 1] & F_HOR)
-			{
-				int other = lengths[dsf_canonify(dsf, y*w + x - 1)];
-				if (other != -1 && other != idx)
-					break;
-			}
+	for (k = 0; k < len; k++)
+	{
+		lo[k] = k;
+		next = k > 2 ? k - 2 : -1;
+		if (k > 0 && (state->grid[start + k*step] & state->grid[start + (k-1)*step] & line ||
+			sticks_can_enter(state, start, step, line, owner, k - 1, next)))
+			lo[k] = lo[k - 1];
+	}
+	for (k = len - 1; k >= 0; k--)
+	{
+		hi[k] = k;
+		next = k < len - 2 ? k + 2 : -1;
+		if (k < len - 1 && (state->grid[start + k*step] & state->grid[start + (k+1)*step] & line ||
+			sticks_can_enter(state, start, step, line, owner, k + 1, next)))
+			hi[k] = hi[k + 1];
+	}
+}
 
-			if (action == 1 && x < w - 1 && state->grid[y*w + x + 1] & F_HOR)
-			{
-				int other = lengths[dsf_canonify(dsf, y*w + x + 1)];
-				if (other != -1 && other != idx)
-					break;
-			}
+static bool sticks_line_errors(game_state *state, int start, int step, int len,
+	int line, int *temp, bool mark)
+{
+	/*
+	 * Check every number on a line in a single row or column. temp must
+	 * have space for four times the length of the line.
+	 */
+	int *owner = temp, *size = temp + len, *lo = temp + 2*len, *hi = temp + 3*len;
+	int k, i, l;
+	bool error, ret = false;
 
-			ret++;
-			x += action;
+	sticks_line_reach(state, start, step, len, line, owner, size, lo, hi);
+
+	for (k = 0; k < len; k++)
+	{
+		i = start + k*step;
+		if (!(state->grid[i] & line) || state->numbers[i] == -1)
+			continue;
+
+		l = state->numbers[i];
+		error = owner[k] < 0 || size[k] > l ||
+			(size[k] < l && hi[k] - lo[k] + 1 < l);
+
+		if (error)
+		{
+			if (mark)
+				state->grid[i] |= F_ERROR;
+			ret = true;
 		}
 	}
 
 	return ret;
 }
 
-static int sticks_max_size_vertical(game_state *state, DSF *dsf, int *lengths, int idx)
+static bool sticks_block_error(const game_state *state, int i)
 {
+	/* Check the amount of lines connected to a numbered black cell */
 	int w = state->w, h = state->h;
-	int c, y, x = idx%w;
-	int ret = 1;
-	int action;
-
-	for (action = -1; action < 2; action += 2)
-	{
-		y = (idx / w) + action;
-		while (y >= 0 && y < h)
-		{
-			if (state->grid[y*w + x] & (F_BLOCK | F_HOR))
-				break;
-
-			c = dsf_canonify(dsf, y*w + x);
-			if (lengths[c] != -1 && lengths[c] != idx)
-				break;
+	int x = i%w, y = i/w;
+	int conn = 0;
+	int other = 0;
 
-			if (action == -1 && y > 1 && state->grid[(y - 1)*w + x] & F_VER)
-			{
-				int other = lengths[dsf_canonify(dsf, (y - 1)*w + x)];
-				if (other != -1 && other != idx)
-					break;
-			}
+	if (!(state->grid[i] & F_BLOCK) || state->numbers[i] == -1)
+		return false;
 
-			if (action == 1 && y < h - 1 && state->grid[(y + 1)*w + x] & F_VER)
-			{
-				int other = lengths[dsf_canonify(dsf, (y + 1)*w + x)];
-				if (other != -1 && other != idx)
-					break;
-			}
+	if (x == 0 || state->grid[i - 1] & (F_VER | F_BLOCK)) other++;
+	if (x == w - 1 || state->grid[i + 1] & (F_VER | F_BLOCK)) other++;
+	if (y == 0 || state->grid[i - w] & (F_HOR | F_BLOCK)) other++;
+	if (y == h - 1 || state->grid[i + w] & (F_HOR | F_BLOCK)) other++;
 
-			ret++;
-			y += action;
-		}
-	}
+	if (x != 0 && state->grid[i - 1] & F_HOR) conn++;
+	if (x != w - 1 && state->grid[i + 1] & F_HOR) conn++;
+	if (y != 0 && state->grid[i - w] & F_VER) conn++;
+	if (y != h - 1 && state->grid[i + w] & F_VER) conn++;
 
-	return ret;
+	return conn > state->numbers[i] || other > 4 - state->numbers[i];
 }
 
-static int sticks_validate(game_state *state, DSF *dsf, int *lengths)
+static int sticks_validate(game_state *state, int *temp)
 {
 	int w = state->w, h = state->h;
 	int x, y, i;
 
-	bool hastemp = dsf != NULL;
+	bool hastemp = temp != NULL;
 	if (!hastemp)
-	{
-		dsf = dsf_new_min(w*h);
-		lengths = snewn(w*h, int);
-	}
-	bool error;
+		temp = snewn(4*max(w, h), int);
 	char ret = STATUS_COMPLETE;
 
-	sticks_make_dsf(state, dsf, lengths);
-
-	for (y = 0; y < h; y++)
-	for (x = 0; x < w; x++)
+	for (i = 0; i < w*h; i++)
 	{
-		i = y*w + x;
 		state->grid[i] &= ~F_ERROR;
 
 		if (!state->grid[i])
-		{
-			if (ret == STATUS_COMPLETE)
-				ret = STATUS_UNFINISHED;
-			continue;
-		}
-
-		if (state->numbers[y*w + x] == -1) continue;
-
-		error = false;
-
-		if (state->grid[y*w + x] & F_BLOCK)
-		{
-			int conn = 0;
-			int other = 0;
-
-			if (x == 0 || state->grid[i - 1] & (F_VER | F_BLOCK)) other++;
-			if (x == w - 1 || state->grid[i + 1] & (F_VER | F_BLOCK)) other++;
-			if (y == 0 || state->grid[i - w] & (F_HOR | F_BLOCK)) other++;
-			if (y == h - 1 || state->grid[i + w] & (F_HOR | F_BLOCK)) other++;
-
-			if (x != 0 && state->grid[i - 1] & F_HOR) conn++;
-			if (x != w - 1 && state->grid[i + 1] & F_HOR) conn++;
-			if (y != 0 && state->grid[i - w] & F_VER) conn++;
-			if (y != h - 1 && state->grid[i + w] & F_VER) conn++;
-
-			if (conn > state->numbers[i] || other > 4 - state->numbers[i])
-				error = true;
-		}
-		else
-		{
-			int c = dsf_canonify(dsf, i);
-			if (lengths[c] < 0)
-				error = true;
-			else
-			{
-				int s = dsf_size(dsf, c);
-				int l = state->numbers[lengths[c]];
-
-				if (s > l)
-					error = true;
-				else if (s < l && state->grid[i] & F_HOR)
-				{
-					if (sticks_max_size_horizontal(state, dsf, lengths, i) < l)
-						error = true;
-				}
-				else if (s < l && state->grid[i] & F_VER)
-				{
-					if (sticks_max_size_vertical(state, dsf, lengths, i) < l)
-						error = true;
-				}
-			}
-		}
+			ret = STATUS_UNFINISHED;
+	}
 
-		if (error)
+	for (i = 0; i < w*h; i++)
+	{
+		if (sticks_block_error(state, i))
 		{
 			if (!hastemp)
 				state->grid[i] |= F_ERROR;
@@ -427,14 +418,42 @@ static int sticks_validate(game_state *state, DSF *dsf, int *lengths)
 		}
 	}
 
-	if (!hastemp)
+	for (y = 0; y < h; y++)
+	{
+		if (sticks_line_errors(state, y*w, 1, w, F_HOR, temp, !hastemp))
+			ret = STATUS_INVALID;
+	}
+	for (x = 0; x < w; x++)
 	{
-		dsf_free(dsf);
-		sfree(lengths);
+		if (sticks_line_errors(state, x, w, h, F_VER, temp, !hastemp))
+			ret = STATUS_INVALID;
 	}
+
+	if (!hastemp)
+		sfree(temp);
 	return ret;
 }
 
+static bool sticks_change_invalid(game_state *state, int i, int *temp)
+{
+	/*
+	 * Check if changing a single cell made a valid grid invalid. Only the
+	 * horizontal lines in its row, the vertical lines in its column and
+	 * the black cells next to it can be affected.
+	 */
+	int w = state->w, h = state->h;
+	int x = i%w, y = i/w;
+
+	if (x > 0 && sticks_block_error(state, i - 1)) return true;
+	if (x < w - 1 && sticks_block_error(state, i + 1)) return true;
+	if (y > 0 && sticks_block_error(state, i - w)) return true;
+	if (y < h - 1 && sticks_block_error(state, i + w)) return true;
+
+	if (sticks_line_errors(state, y*w, 1, w, F_HOR, temp, false))
+		return true;
+	return sticks_line_errors(state, x, w, h, F_VER, temp, false);
+}
+
 static const char *validate_desc(const game_params *params, const char *desc)
 {
 	int s = params->w * params->h;
@@ -545,7 +564,7 @@ static void free_game(game_state *state)
 	sfree(state);
 }
 
-static int sticks_try(game_state *state, DSF *dsf, int *lengths)
+static int sticks_try(game_state *state, int *temp)
 {
 	int s = state->w * state->h;
 	int i;
@@ -555,14 +574,14 @@ static int sticks_try(game_state *state, DSF *dsf, int *lengths)
 		if (state->grid[i]) continue;
 
 		state->grid[i] = F_HOR;
-		if (sticks_validate(state, dsf, lengths) == STATUS_INVALID)
+		if (sticks_change_invalid(state, i, temp))
 		{
 			state->grid[i] = F_VER;
 			return 1;
 		}
 
 		state->grid[i] = F_VER;
-		if (sticks_validate(state, dsf, lengths) == STATUS_INVALID)
+		if (sticks_change_invalid(state, i, temp))
 		{
 			state->grid[i] = F_HOR;
 			return 1;
@@ -580,8 +599,7 @@ static int sticks_solve_game(game_state *state)
 	int i;
 	int ret = STATUS_UNFINISHED;
 
-	DSF *dsf = dsf_new_min(s);
-	int *lengths = snewn(s, int);
+	int *temp = snewn(4*max(state->w, state->h), int);
 
 	for (i = 0; i < s; i++)
 	{
@@ -589,16 +607,15 @@ static int sticks_solve_game(game_state *state)
 			state->grid[i] = 0;
 	}
 
-	while ((ret = sticks_validate(state, dsf, lengths)) == STATUS_UNFINISHED)
+	while ((ret = sticks_validate(state, temp)) == STATUS_UNFINISHED)
 	{
-		if (sticks_try(state, dsf, lengths))
+		if (sticks_try(state, temp))
 			continue;
 		
 		break;
 	}
 
-	dsf_free(dsf);
-	sfree(lengths);
+	sfree(temp);
 	return ret;
 }
 
@@ -611,7 +628,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 
 	sticks_solve_game(solved);
 
-	result = sticks_validate(solved, NULL, NULL);
+	result = sticks_validate(solved, NULL);
 	
 	if (result != STATUS_INVALID) {
 		int s = solved->w*solved->h;
@@ -715,69 +732,157 @@ static void set_blacks(game_state *state, const game_params *params,
 		state->grid[w*(h / 2 + hodd - 1) + (w / 2 + wodd - 1)] |= F_BLOCK;
 }
 
+static void sticks_random_solution(game_state *state, DSF *dsf, random_state *rs)
+{
+	/* Fill the grid with random lines, and add a number to every line */
+	int w = state->w, h = state->h;
+	int i;
+
+	for (i = 0; i < w*h; i++)
+	{
+		if (!(state->grid[i] & F_BLOCK))
+			state->grid[i] = random_upto(rs, 2) ? F_HOR : F_VER;
+		else
+			state->grid[i] = F_BLOCK;
+	}
+
+	sticks_make_dsf(state, dsf, NULL);
+
+	for (i = 0; i < w*h; i++)
+		state->numbers[i] = -1;
+
+	for (i = 0; i < w*h; i++)
+	{
+		if (state->grid[i] & F_BLOCK)
+		{
+			int n = 0;
+			if (i%w > 0 && state->grid[i - 1] & F_HOR) n++;
+			if (i%w < w - 1 && state->grid[i + 1] & F_HOR) n++;
+			if (i / w > 0 && state->grid[i - w] & F_VER) n++;
+			if (i / w < h - 1 && state->grid[i + w] & F_VER) n++;
+			state->numbers[i] = n;
+		}
+		else if (dsf_minimal(dsf, i) == i)
+		{
+			int n = dsf_size(dsf, i);
+
+			if (n == 1)
+				state->numbers[i] = 1;
+			else if (state->grid[i] & F_HOR)
+				state->numbers[i + random_upto(rs, n)] = n;
+			else if (state->grid[i] & F_VER)
+				state->numbers[i + (w*random_upto(rs, n))] = n;
+		}
+	}
+}
+
+static int sticks_orbit(const game_params *params, int i, int *orbit)
+{
+	/*
+	 * Find the cells which set_blacks maps onto cell i. The cells are
+	 * stored in increasing order without duplicates, and the amount of
+	 * cells is returned.
+	 */
+	int w = params->w, h = params->h;
+	int x = i%w, y = i/w;
+	int xs[4], ys[4];
+	int j, k, c, n = 1, ret = 0;
+
+	xs[0] = x;
+	ys[0] = y;
+	switch (params->symm) {
+	case SYMM_ROT2:
+		xs[1] = w - 1 - x; ys[1] = h - 1 - y;
+		n = 2;
+		break;
+	case SYMM_REF2:
+		xs[1] = x; ys[1] = h - 1 - y;
+		n = 2;
+		break;
+	case SYMM_ROT4:
+		xs[1] = w - 1 - y; ys[1] = x;
+		xs[2] = w - 1 - x; ys[2] = h - 1 - y;
+		xs[3] = y; ys[3] = h - 1 - x;
+		n = 4;
+		break;
+	case SYMM_REF4:
+		xs[1] = w - 1 - x; ys[1] = y;
+		xs[2] = x; ys[2] = h - 1 - y;
+		xs[3] = w - 1 - x; ys[3] = h - 1 - y;
+		n = 4;
+		break;
+	}
+
+	for (j = 0; j < n; j++)
+	{
+		c = ys[j]*w + xs[j];
+		for (k = 0; k < ret && orbit[k] != c; k++);
+		if (k < ret) continue;
+
+		/* Insertion sort */
+		for (k = ret++; k > 0 && orbit[k-1] > c; k--)
+			orbit[k] = orbit[k-1];
+		orbit[k] = c;
+	}
+
+	return ret;
+}
+
+#ifdef STANDALONE_SOLVER
+/* Generator attempts, reported by --generate */
+static long gen_attempts;
+#endif
+
 static char *new_game_desc(const game_params *params, random_state *rs,
 			   char **aux, bool interactive)
 {
 	int w = params->w, h = params->h;
 	DSF *dsf = dsf_new_min(w*h);
 	int *spaces = snewn(w*h, int);
-	int i, j;
+	int orbit[4], saved[4];
+	int i, j, k, n, removed;
 	game_state *state = new_game(NULL, params, NULL);
 
 	set_blacks(state, params, rs);
 
 	do
 	{
-		for (i = 0; i < w*h; i++)
-		{
-			if (!(state->grid[i] & F_BLOCK))
-				state->grid[i] = random_upto(rs, 2) ? F_HOR : F_VER;
-			else
-				state->grid[i] = F_BLOCK;
-		}
-
-		sticks_make_dsf(state, dsf, NULL);
-
-		for (i = 0; i < w*h; i++)
-			state->numbers[i] = -1;
-
-		for (i = 0; i < w*h; i++)
-		{
-			if (state->grid[i] & F_BLOCK)
-			{
-				int n = 0;
-				if (i%w > 0 && state->grid[i - 1] & F_HOR) n++;
-				if (i%w < w - 1 && state->grid[i + 1] & F_HOR) n++;
-				if (i / w > 0 && state->grid[i - w] & F_VER) n++;
-				if (i / w < h - 1 && state->grid[i + w] & F_VER) n++;
-				state->numbers[i] = n;
-			}
-			else if (dsf_minimal(dsf, i) == i)
-			{
-				int n = dsf_size(dsf, i);
-
-				if (n == 1)
-					state->numbers[i] = 1;
-				else if (state->grid[i] & F_HOR)
-					state->numbers[i + random_upto(rs, n)] = n;
-				else if (state->grid[i] & F_VER)
-					state->numbers[i + (w*random_upto(rs, n))] = n;
-			}
-		}
+#ifdef STANDALONE_SOLVER
+		gen_attempts++;
+#endif
+		sticks_random_solution(state, dsf, rs);
 	} while (sticks_solve_game(state) != STATUS_COMPLETE);
 
 	for (i = 0; i < w*h; i++)
 		spaces[i] = i;
 	shuffle(spaces, w*h, sizeof(int), rs);
 
+	/*
+	 * Remove the numbers of each group of symmetric cells together, so
+	 * the clues follow the symmetry of the black cells and every group
+	 * needs only one check for uniqueness.
+	 */
 	for (j = 0; j < w*h; j++)
 	{
 		i = spaces[j];
-		int temp = state->numbers[i];
-		if (temp == -1) continue;
-		state->numbers[i] = -1;
+		n = sticks_orbit(params, i, orbit);
+		if (orbit[0] != i) continue;
+
+		removed = 0;
+		for (k = 0; k < n; k++)
+		{
+			saved[k] = state->numbers[orbit[k]];
+			if (saved[k] == -1) continue;
+			state->numbers[orbit[k]] = -1;
+			removed++;
+		}
+		if (!removed) continue;
+
 		if (sticks_solve_game(state) != STATUS_COMPLETE)
-			state->numbers[i] = temp;
+		{
+			for (k = 0; k < n; k++)
+				state->numbers[orbit[k]] = saved[k];
+		}
 	}
 
 	char *ret = snewn((w*h * 2) + 1, char);
@@ -1218,7 +1323,7 @@ static game_state *execute_move(const game_state *state, const char *move)
 			p++;
 	}
 
-	if (sticks_validate(ret, NULL, NULL) == STATUS_COMPLETE) ret->completed = true;
+	if (sticks_validate(ret, NULL) == STATUS_COMPLETE) ret->completed = true;
 	if(cheated) ret->cheated = ret->completed;
 	return ret;
 }
@@ -1464,6 +1569,9 @@ const struct game thegame = {
 #ifdef STANDALONE_SOLVER
 #include <time.h>
 
+#include "genbatch.h"
+#include "solvestream.h"
+
 /* Most of the standalone solver code was copied from unequal.c and singles.c */
 
 const char *quis;
@@ -1472,16 +1580,264 @@ static void usage_exit(const char *msg)
 {
 	if (msg)
 		fprintf(stderr, "%s: %s\n", quis, msg);
-	fprintf(stderr, "Usage: %s [-v] [--seed SEED] <params> | [game_id [game_id ...]]\n", quis);
+	fprintf(stderr, "Usage: %s [-v] [--seed SEED] [--check COUNT | --bench COUNT | --generate COUNT | --stream] <params> | [game_id [game_id ...]]\n", quis);
 	exit(1);
 }
 
+/*
+ * The reach tables replace a walk outward from every numbered cell,
+ * which is kept here to check the tables against.
+ */
+static int sticks_max_size_horizontal(game_state *state, DSF *dsf, int *lengths, int idx)
+{
+	int w = state->w;
+	int c, x, y = idx / w;
+	int ret = 1;
+	int action;
+
+	for (action = -1; action < 2; action += 2)
+	{
+		x = (idx%w) + action;
+		while (x >= 0 && x < w)
+		{
+			if (state->grid[y*w + x] & (F_BLOCK | F_VER))
+				break;
+
+			c = dsf_canonify(dsf, y*w + x);
+			if (lengths[c] != -1 && lengths[c] != idx)
+				break;
+
+			if (action == -1 && x > 1 && state->grid[y*w + x - 1] & F_HOR)
+			{
+				int other = lengths[dsf_canonify(dsf, y*w + x - 1)];
+				if (other != -1 && other != idx)
+					break;
+			}
+
+			if (action == 1 && x < w - 1 && state->grid[y*w + x + 1] & F_HOR)
+			{
+				int other = lengths[dsf_canonify(dsf, y*w + x + 1)];
+				if (other != -1 && other != idx)
+					break;
+			}
+
+			ret++;
+			x += action;
+		}
+	}
+
+	return ret;
+}
+
+static int sticks_max_size_vertical(game_state *state, DSF *dsf, int *lengths, int idx)
+{
+	int w = state->w, h = state->h;
+	int c, y, x = idx%w;
+	int ret = 1;
+	int action;
+
+	for (action = -1; action < 2; action += 2)
+	{
+		y = (idx / w) + action;
+		while (y >= 0 && y < h)
+		{
+			if (state->grid[y*w + x] & (F_BLOCK | F_HOR))
+				break;
+
+			c = dsf_canonify(dsf, y*w + x);
+			if (lengths[c] != -1 && lengths[c] != idx)
+				break;
+
+			if (action == -1 && y > 1 && state->grid[(y - 1)*w + x] & F_VER)
+			{
+				int other = lengths[dsf_canonify(dsf, (y - 1)*w + x)];
+				if (other != -1 && other != idx)
+					break;
+			}
+
+			if (action == 1 && y < h - 1 && state->grid[(y + 1)*w + x] & F_VER)
+			{
+				int other = lengths[dsf_canonify(dsf, (y + 1)*w + x)];
+				if (other != -1 && other != idx)
+					break;
+			}
+
+			ret++;
+			y += action;
+		}
+	}
+
+	return ret;
+}
+
+static void sticks_random_state(game_state *state, random_state *rs,
+	int emptypc, int numberpc)
+{
+	/* Fill a grid with a random mix of lines, black cells and numbers */
+	int w = state->w, h = state->h;
+	int i;
+
+	for (i = 0; i < w*h; i++)
+	{
+		state->numbers[i] = -1;
+		if (random_upto(rs, 100) < 15)
+			state->grid[i] = F_BLOCK;
+		else if (random_upto(rs, 100) < emptypc)
+			state->grid[i] = 0;
+		else
+			state->grid[i] = random_upto(rs, 2) ? F_HOR : F_VER;
+
+		if (random_upto(rs, 100) < numberpc)
+			state->numbers[i] = state->grid[i] & F_BLOCK ?
+				random_upto(rs, 5) : 1 + random_upto(rs, max(w, h));
+	}
+}
+
+static int sticks_check(game_params *params, random_state *rs, int count)
+{
+	/*
+	 * Compare the reach tables with the walking implementation on random
+	 * grids, and check that looking at a single changed cell gives the
+	 * same answer as validating the entire grid.
+	 */
+	int w = params->w, h = params->h, s = w*h;
+	game_state *state = new_game(NULL, params, NULL);
+	DSF *dsf = dsf_new_min(s);
+	int *lengths = snewn(s, int);
+	int *temp = snewn(4*max(w, h), int);
+	int *owner = temp, *lo = temp + 2*max(w, h), *hi = temp + 3*max(w, h);
+	int n, i, x, y, walked;
+	int queries = 0, changes = 0, errors = 0;
+	bool full, local;
+
+	for (n = 0; n < count; n++)
+	{
+		sticks_random_state(state, rs, 30, 25);
+		sticks_make_dsf(state, dsf, lengths);
+
+		for (y = 0; y < h; y++)
+		{
+			sticks_line_reach(state, y*w, 1, w, F_HOR, owner, temp + w, lo, hi);
+			for (x = 0; x < w; x++)
+			{
+				i = y*w + x;
+				if (!(state->grid[i] & F_HOR) || lengths[dsf_canonify(dsf, i)] != i)
+					continue;
+				walked = sticks_max_size_horizontal(state, dsf, lengths, i);
+				queries++;
+				if (walked != hi[x] - lo[x] + 1 && errors++ < 10)
+					printf("Grid %d, cell %d,%d: walked %d horizontally, table %d\n",
+						n, x, y, walked, hi[x] - lo[x] + 1);
+			}
+		}
+		for (x = 0; x < w; x++)
+		{
+			sticks_line_reach(state, x, w, h, F_VER, owner, temp + h, lo, hi);
+			for (y = 0; y < h; y++)
+			{
+				i = y*w + x;
+				if (!(state->grid[i] & F_VER) || lengths[dsf_canonify(dsf, i)] != i)
+					continue;
+				walked = sticks_max_size_vertical(state, dsf, lengths, i);
+				queries++;
+				if (walked != hi[y] - lo[y] + 1 && errors++ < 10)
+					printf("Grid %d, cell %d,%d: walked %d vertically, table %d\n",
+						n, x, y, walked, hi[y] - lo[y] + 1);
+			}
+		}
+
+		/* Change single cells of a partly filled grid which is still valid */
+		sticks_random_state(state, rs, 70, 5);
+		if (sticks_validate(state, temp) == STATUS_INVALID)
+			continue;
+		for (i = 0; i < s; i++)
+		{
+			if (state->grid[i])
+				continue;
+
+			state->grid[i] = random_upto(rs, 2) ? F_HOR : F_VER;
+			local = sticks_change_invalid(state, i, temp);
+			full = sticks_validate(state, temp) == STATUS_INVALID;
+			changes++;
+			if (local != full && errors++ < 10)
+				printf("Grid %d, cell %d,%d: changed cell %s, full grid %s\n",
+					n, i%w, i/w, local ? "invalid" : "valid", full ? "invalid" : "valid");
+			state->grid[i] = 0;
+		}
+	}
+
+	printf("%d grids, %d queries, %d changes, %d mismatches\n",
+		count, queries, changes, errors);
+
+	free_game(state);
+	dsf_free(dsf);
+	sfree(lengths);
+	sfree(temp);
+	return errors ? 1 : 0;
+}
+
+static void sticks_bench(game_params *params, random_state *rs, int count)
+{
+	/*
+	 * Solve random grids with a number on every line, which is what the
+	 * generator spends most of its time on.
+	 */
+	int w = params->w, h = params->h;
+	game_state *state = new_game(NULL, params, NULL);
+	DSF *dsf = dsf_new_min(w*h);
+	clock_t start, total = 0;
+	int i, solved = 0;
+
+	for (i = 0; i < count; i++)
+	{
+		set_blacks(state, params, rs);
+		sticks_random_solution(state, dsf, rs);
+
+		start = clock();
+		if (sticks_solve_game(state) == STATUS_COMPLETE)
+			solved++;
+		total += clock() - start;
+	}
+
+	printf("%d grids, %d solved, %.2f ms per grid\n", count, solved,
+		total * 1000.0 / CLOCKS_PER_SEC / count);
+
+	free_game(state);
+	dsf_free(dsf);
+}
+
+/*
+ * Whether the solver can finish a generated puzzle, for --generate.
+ * Sticks has no difficulty levels.
+ */
+static const char *sticks_grade(const game_params *params, const char *desc)
+{
+	game_state *state = new_game(NULL, params, desc);
+	int status = sticks_solve_game(state);
+	
+	free_game(state);
+	return status == STATUS_COMPLETE ? "Solved" : "Unsolved";
+}
+
+/* Solve one puzzle for --stream. Sticks has no difficulty levels. */
+static void sticks_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+	int status = sticks_solve_game(state);
+	
+	if (status == STATUS_COMPLETE)
+		res->status = "Solved";
+	else if (status == STATUS_INVALID)
+		res->status = "Invalid";
+}
+
 int main(int argc, char *argv[])
 {
 	random_state *rs;
 	time_t seed = time(NULL);
 	
 	game_params *params = NULL;
+	int check = 0, bench = 0, generate = 0;
+	bool stream = false;
 	
 	char *id = NULL, *desc = NULL;
 	const char *err;
@@ -1498,6 +1854,28 @@ int main(int argc, char *argv[])
 			seed = (time_t)atoi(*++argv);
 			argc--;
 		}
+		else if (!strcmp(p, "--check") || !strcmp(p, "--bench") ||
+			!strcmp(p, "--generate"))
+		{
+			if (argc == 0)
+				usage_exit("option needs an argument");
+			if (!strcmp(p, "--check"))
+				check = atoi(*++argv);
+			else if (!strcmp(p, "--bench"))
+				bench = atoi(*++argv);
+			else
+				generate = atoi(*++argv);
+			argc--;
+		}
+		else if (!strcmp(p, "--params"))
+		{
+			if (argc == 0)
+				usage_exit("--params needs an argument");
+			id = *++argv;
+			argc--;
+		}
+		else if (!strcmp(p, "--stream"))
+			stream = true;
 		else if(!strcmp(p, "-v"))
 			solver_verbose = true;
 		else if (*p == '-')
@@ -1522,7 +1900,30 @@ int main(int argc, char *argv[])
 		}
 	}
 	
-	if (!desc)
+	if (stream)
+	{
+		if (id)
+			usage_exit("--stream reads game IDs from stdin");
+		solvestream_run(stdin, sticks_stream_solve, NULL);
+	}
+	else if (generate)
+	{
+		if (desc)
+			usage_exit("--generate needs parameters, not a game ID");
+		if(!params) params = default_params();
+		genbatch_run(params, (unsigned long)seed, generate, &gen_attempts, sticks_grade);
+	}
+	else if (check || bench)
+	{
+		rs = random_new((void*)&seed, sizeof(time_t));
+		if(!params) params = default_params();
+		printf("Parameters %s\n", encode_params(params, true));
+		if (bench)
+			sticks_bench(params, rs, bench);
+		else
+			return sticks_check(params, rs, check);
+	}
+	else if (!desc)
 	{
 		rs = random_new((void*)&seed, sizeof(time_t));
 		if(!params) params = default_params();
@@ -76,8 +76,8 @@ static const struct
     {F_ADJ_DOWN, F_ADJ_UP, 0, 1, 'v', 'D'},
     {F_ADJ_LEFT, F_ADJ_RIGHT, -1, 0, '<', 'L'}};
 
-/* TODO: When other sizes are supported, read n instead of returning a constant */
-#define CELL_WIDTH(n) (2)
+/* The elements of a cell are drawn in two rows */
+#define CELL_WIDTH(n) (((n) + 1) / 2)
 #define CELL_HEIGHT(n) (2)
 
 struct game_params
@@ -107,13 +107,28 @@ static game_params *default_params(void)
     return ret;
 }
 
+static const struct game_params subsets_presets[] = {
+    {4, 2, 3},
+    {4, 4, 4},
+    {8, 4, 5},
+    {8, 8, 6},
+};
+
 static bool game_fetch_preset(int i, char **name, game_params **params)
 {
-    if (i != 0)
+    game_params *ret;
+    char buf[80];
+
+    if (i < 0 || i >= lenof(subsets_presets))
         return false;
 
-    *name = dupstr("4x4 Size 4");
-    *params = default_params();
+    ret = snew(game_params);
+    *ret = subsets_presets[i];
+
+    sprintf(buf, "%dx%d Size %d", ret->w, ret->h, ret->n);
+
+    *name = dupstr(buf);
+    *params = ret;
     return true;
 }
 
@@ -162,8 +177,12 @@ static char *encode_params(const game_params *params, bool full)
 
 static const char *validate_params(const game_params *params, bool full)
 {
-    if (params->w != 4 || params->h != 4 || params->n != 4)
-        return "Currently only 4x4 puzzles are supported";
+    int w = params->w, h = params->h, n = params->n;
+
+    if (n < 2 || n > 6)
+        return "Size must be between 2 and 6";
+    if (w < 1 || h < 1 || w > (1 << n) || h > (1 << n) || w * h != (1 << n))
+        return "Grid must contain exactly 2^n cells";
 
     return NULL;
 }
@@ -177,87 +196,80 @@ static void free_game(game_state *state)
     sfree(state);
 }
 
+/*
+ * Read the description in a single pass. Each cell is checked against
+ * its upper and left neighbours as soon as its flags are read, which
+ * covers every pair of adjacent cells exactly once.
+ */
 static const char *attempt_load_game(game_state *state, const char *desc)
 {
     const char *p = desc;
-    int w = state->w, h = state->w, n = state->n;
-    int i = 0, x, y;
-    unsigned int num;
+    int w = state->w, h = state->h, n = state->n;
+    int i, x, y;
+    unsigned int num, f;
 
-    while (*p)
+    for (i = 0; i < w * h; i++)
     {
-        if (i >= w * h)
-            return "Too much data to fill grid";
+        x = i % w;
+        y = i / w;
+
+        if (i > 0)
+        {
+            if (!*p)
+                return "Not enough data to fill grid";
+            if (*p != ',')
+                return "Missing separator";
+            p++;
+        }
 
         if (*p >= '0' && *p <= '9')
         {
-            num = (unsigned int)atoi(p);
-            if (num < 0 || num > ALL_BITS(n))
-                return "Out-of-range number in game description";
+            num = 0;
+            while (*p >= '0' && *p <= '9')
+            {
+                num = (num * 10) + (*p++ - '0');
+                if (num > ALL_BITS(n))
+                    return "Out-of-range number in game description";
+            }
 
             state->known[i] = num;
             state->mask[i] = num;
             state->immutable[i] = ALL_BITS(n);
-
-            while (*p >= '0' && *p <= '9')
-                p++; /* skip number */
         }
         else if (*p == '_')
             p++;
         else
             return "Expecting number in game description";
 
-        while (*p == 'U' || *p == 'R' || *p == 'D' || *p == 'L')
+        for (;; p++)
         {
-            switch (*p)
-            {
-            case 'U':
-                state->clues[i] |= F_ADJ_UP;
-                break;
-            case 'R':
-                state->clues[i] |= F_ADJ_RIGHT;
-                break;
-            case 'D':
-                state->clues[i] |= F_ADJ_DOWN;
+            if (*p == 'U')
+                f = F_ADJ_UP;
+            else if (*p == 'R')
+                f = F_ADJ_RIGHT;
+            else if (*p == 'D')
+                f = F_ADJ_DOWN;
+            else if (*p == 'L')
+                f = F_ADJ_LEFT;
+            else
                 break;
-            case 'L':
-                state->clues[i] |= F_ADJ_LEFT;
-                break;
-            default:
-                return "Expecting flag URDL in game description";
-            }
-            p++;
-        }
-        i++;
-        if (i < w * h && *p != ',')
-            return "Missing separator";
-        if (*p == ',')
-            p++;
-    }
-    if (i < w * h)
-        return "Not enough data to fill grid";
 
-    for (y = 0; y < h; y++)
-    {
-        for (x = 0; x < w; x++)
-        {
-            for (i = 0; i < 4; i++)
-            {
-                if (state->clues[y * w + x] & adjthan[i].f)
-                {
-                    int nx = x + adjthan[i].dx;
-                    int ny = y + adjthan[i].dy;
-                    /* a flag must not point us off the grid. */
-                    if (nx < 0 || ny < 0 || nx >= w || ny >= h)
-                        return "Flags go off grid";
-
-                    if (state->clues[ny * w + nx] & adjthan[i].fo)
-                        return "Flags contradicting each other";
-                }
-            }
+            /* a flag must not point us off the grid. */
+            if ((f == F_ADJ_UP && y == 0) || (f == F_ADJ_RIGHT && x == w - 1) ||
+                (f == F_ADJ_DOWN && y == h - 1) || (f == F_ADJ_LEFT && x == 0))
+                return "Flags go off grid";
+
+            state->clues[i] |= f;
         }
+
+        if ((y > 0 && (state->clues[i] & F_ADJ_UP) && (state->clues[i - w] & F_ADJ_DOWN)) ||
+            (x > 0 && (state->clues[i] & F_ADJ_LEFT) && (state->clues[i - 1] & F_ADJ_RIGHT)))
+            return "Flags contradicting each other";
     }
 
+    if (*p)
+        return "Too much data to fill grid";
+
     return NULL;
 }
 
@@ -537,13 +549,63 @@ static char subsets_validate(const game_state *state, unsigned int *flags, int *
 /* ****** *
  * Solver *
  * ****** */
-static void subsets_sync_cube(const game_state *state, bool *cube)
+
+/*
+ * The cube holds every set which is still possible for every cell. Each
+ * technique only looks at cells which changed since its previous pass,
+ * because the other cells will not give it anything new. The solver
+ * counts steps, and records at which step each cell's known bits, mask
+ * or possible sets last changed.
+ */
+enum
+{
+    TECH_ARROWS,
+    TECH_DISJOINT,
+    TECH_BITS,
+    TECH_ADVANCED,
+    TECH_COUNT
+};
+
+struct subsets_solver
+{
+    int *counts;
+    bool *cube;
+
+    int step;
+    int *changed;
+    int since[TECH_COUNT];
+
+    /* The known bits and masks which the cube was last synchronised with */
+    unsigned int *known, *mask;
+
+    /* Values which were removed from the cube for all other cells */
+    bool *placed;
+};
+
+static int subsets_solver_begin(struct subsets_solver *solver, int tech)
+{
+    /* Start a pass of a technique, and return the first step it must look at */
+    int ret = solver->since[tech];
+
+    solver->since[tech] = ++solver->step;
+    return ret;
+}
+
+static void subsets_sync_cube(const game_state *state, struct subsets_solver *solver)
 {
     const int s = state->w * state->h, n = state->n, n2 = 1 << n;
+    bool *cube = solver->cube;
     int i, nj;
 
     for (i = 0; i < s; i++)
     {
+        if (state->known[i] == solver->known[i] && state->mask[i] == solver->mask[i])
+            continue;
+
+        solver->known[i] = state->known[i];
+        solver->mask[i] = state->mask[i];
+        solver->changed[i] = solver->step;
+
         for (nj = 0; nj < n2; nj++)
         {
             if (!cube[i * n2 + nj])
@@ -564,15 +626,18 @@ static void subsets_sync_cube(const game_state *state, bool *cube)
     }
 }
 
-static void subsets_cube_single_count(const game_state *state, const int *counts, bool *cube)
+static void subsets_cube_single_count(const game_state *state, struct subsets_solver *solver)
 {
     const int s = state->w * state->h, n = state->n, n2 = 1 << n;
+    bool *cube = solver->cube;
     int j, ni;
 
     for (ni = 0; ni < n2; ni++)
     {
-        if (counts[ni] != 1)
+        /* Once a value is placed, it stays placed */
+        if (solver->counts[ni] != 1 || solver->placed[ni])
             continue;
+        solver->placed[ni] = true;
 
         for (j = 0; j < s; j++)
         {
@@ -584,13 +649,15 @@ static void subsets_cube_single_count(const game_state *state, const int *counts
 
             solver_printf("\x1B[0;36mRemoving possibility %d from space %d due to being located elsewhere\x1B[0m\n", ni, j);
             cube[j * n2 + ni] = false;
+            solver->changed[j] = solver->step;
         }
     }
 }
 
-static int subsets_solve_apply_arrows(game_state *state)
+static int subsets_solve_apply_arrows(game_state *state, struct subsets_solver *solver)
 {
-    const int w = state->w, h = state->h, n = state->n;
+    const int w = state->w, h = state->h;
+    const int since = subsets_solver_begin(solver, TECH_ARROWS);
     int x, y, d, i1, i2, prev;
     int ret = 0;
 
@@ -604,12 +671,15 @@ static int subsets_solve_apply_arrows(game_state *state)
                 if (!(state->clues[i1] & adjthan[d].f))
                     continue;
                 i2 = i1 + (adjthan[d].dy * w) + adjthan[d].dx;
+                if (solver->changed[i1] < since && solver->changed[i2] < since)
+                    continue;
 
                 prev = state->known[i1];
                 state->known[i1] |= state->known[i2];
                 if (prev != state->known[i1])
                 {
                     solver_printf("\x1B[0;33mArrow pointing to %d confirms bits at %d\x1B[0m\n", i2, i1);
+                    solver->changed[i1] = solver->step;
                     ret++;
                 }
 
@@ -618,6 +688,7 @@ static int subsets_solve_apply_arrows(game_state *state)
                 if (prev != state->mask[i2])
                 {
                     solver_printf("\x1B[0;33mArrow pointing from %d removes bits at %d\x1B[0m\n", i1, i2);
+                    solver->changed[i2] = solver->step;
                     ret++;
                 }
             }
@@ -627,15 +698,16 @@ static int subsets_solve_apply_arrows(game_state *state)
     return ret;
 }
 
-static int subsets_solve_single_position(game_state *state, const int *counts, const bool *cube)
+static int subsets_solve_single_position(game_state *state, struct subsets_solver *solver)
 {
     const int s = state->w * state->h, n = state->n, n2 = 1 << n;
+    const bool *cube = solver->cube;
     int i, nj, found;
     int ret = 0;
 
     for (nj = 0; nj < n2; nj++)
     {
-        if (counts[nj] != 0)
+        if (solver->counts[nj] != 0)
             continue;
 
         found = -1;
@@ -652,19 +724,25 @@ static int subsets_solve_single_position(game_state *state, const int *counts, c
         solver_printf("\x1B[0;33mSpace %d must be %d\x1B[0m\n", found, nj);
         state->known[found] = nj;
         state->mask[found] = nj;
+        solver->changed[found] = solver->step;
         ret++;
     }
     return ret;
 }
 
-static int subsets_bits_from_cube(game_state *state, const bool *cube)
+static int subsets_bits_from_cube(game_state *state, struct subsets_solver *solver)
 {
     const int s = state->w * state->h, n = state->n, n2 = 1 << n;
+    const int since = subsets_solver_begin(solver, TECH_BITS);
+    const bool *cube = solver->cube;
     int i, prev, nj, newmask, newknown;
     int ret = 0;
 
     for (i = 0; i < s; i++)
     {
+        if (solver->changed[i] < since)
+            continue;
+
         newmask = 0;
         newknown = ~0;
 
@@ -682,6 +760,7 @@ static int subsets_bits_from_cube(game_state *state, const bool *cube)
         if (prev != state->known[i])
         {
             solver_printf("\x1B[0;33mPossibilities at %d confirms bits\x1B[0m\n", i);
+            solver->changed[i] = solver->step;
             ret++;
         }
 
@@ -690,15 +769,18 @@ static int subsets_bits_from_cube(game_state *state, const bool *cube)
         if (prev != state->mask[i])
         {
             solver_printf("\x1B[0;33mPossibilities at %d removes bits\x1B[0m\n", i);
+            solver->changed[i] = solver->step;
             ret++;
         }
     }
     return ret;
 }
 
-static int subsets_solve_apply_arrows_advanced(const game_state *state, bool *cube)
+static int subsets_solve_apply_arrows_advanced(const game_state *state, struct subsets_solver *solver)
 {
     const int w = state->w, h = state->h, n = state->n, n2 = 1 << n;
+    const int since = subsets_solver_begin(solver, TECH_ADVANCED);
+    bool *cube = solver->cube;
     int x, y, d, i1, i2, super, sub;
     bool found;
     int ret = 0;
@@ -713,6 +795,8 @@ static int subsets_solve_apply_arrows_advanced(const game_state *state, bool *cu
                 if (!(state->clues[i1] & adjthan[d].f))
                     continue;
                 i2 = i1 + (adjthan[d].dy * w) + adjthan[d].dx;
+                if (solver->changed[i1] < since && solver->changed[i2] < since)
+                    continue;
 
                 /* Remove options that don't contain the smaller set */
                 for (super = 0; super < n2; super++)
@@ -731,6 +815,7 @@ static int subsets_solve_apply_arrows_advanced(const game_state *state, bool *cu
                     {
                         solver_printf("\x1B[0;36mRemoving possibility %d from space %d due to not fitting subset at %d\x1B[0m\n", super, i1, i2);
                         cube[i1 * n2 + super] = false;
+                        solver->changed[i1] = solver->step;
                         ret++;
                     }
                 }
@@ -764,9 +849,11 @@ static int subsets_solve_apply_arrows_advanced(const game_state *state, bool *cu
     return ret;
 }
 
-static int subsets_disjoint(const game_state *state, bool *cube)
+static int subsets_disjoint(const game_state *state, struct subsets_solver *solver)
 {
     const int w = state->w, h = state->h, n = state->n, n2 = 1 << n;
+    const int since = subsets_solver_begin(solver, TECH_DISJOINT);
+    bool *cube = solver->cube;
     int x, y, d, i1, i2, opt;
     int ret = 0;
 
@@ -787,6 +874,8 @@ static int subsets_disjoint(const game_state *state, bool *cube)
                 i2 = i1 + (adjthan[d].dy * w) + adjthan[d].dx;
                 if (state->clues[i2] & adjthan[d].fo)
                     continue;
+                if (solver->changed[i1] < since && solver->changed[i2] < since)
+                    continue;
 
                 if (state->known[i1] != state->mask[i1])
                 {
@@ -796,6 +885,7 @@ static int subsets_disjoint(const game_state *state, bool *cube)
                         solver_printf("\x1B[0;33m%d is disjoint from %d, removing possibilities 0 and %d\x1B[0m\n", i1, i2, n2 - 1);
                         cube[i1 * n2] = false;
                         cube[i1 * n2 + (n2 - 1)] = false;
+                        solver->changed[i1] = solver->step;
                         ret++;
                     }
                 }
@@ -813,6 +903,7 @@ static int subsets_disjoint(const game_state *state, bool *cube)
 
                         solver_printf("\x1B[0;33mRemoving possibility %d from %d because it overlaps the set at %d \x1B[0m\n", opt, i2, i1);
                         cube[i2 * n2 + opt] = false;
+                        solver->changed[i2] = solver->step;
                         ret++;
                     }
                 }
@@ -828,46 +919,96 @@ static char subsets_solve_game(game_state *state)
     const int s = state->w * state->h, n = state->n, n2 = 1 << n;
     int i;
     char ret = STATUS_UNFINISHED;
-    int *counts = snewn(s, int);
-    bool *cube = snewn(s * n2, bool);
+    struct subsets_solver solver;
+
+    solver.counts = snewn(s, int);
+    solver.cube = snewn(s * n2, bool);
+    solver.changed = snewn(s, int);
+    solver.known = snewn(s, unsigned int);
+    solver.mask = snewn(s, unsigned int);
+    solver.placed = snewn(n2, bool);
+    solver.step = 0;
+    for (i = 0; i < TECH_COUNT; i++)
+        solver.since[i] = 0;
 
     for (i = 0; i < s; i++)
     {
-        if (state->immutable[i])
-            continue;
+        if (!state->immutable[i])
+        {
+            state->known[i] = 0;
+            state->mask[i] = ALL_BITS(n);
+        }
 
-        state->known[i] = 0;
-        state->mask[i] = ALL_BITS(n);
+        /* Every cell starts out changed, and the cube starts out full */
+        solver.changed[i] = 0;
+        solver.known[i] = 0;
+        solver.mask[i] = ALL_BITS(n);
     }
     for (i = 0; i < s * n2; i++)
-        cube[i] = true;
+        solver.cube[i] = true;
+    for (i = 0; i < n2; i++)
+        solver.placed[i] = false;
 
-    while ((ret = subsets_validate(state, NULL, counts)) == STATUS_UNFINISHED)
+    while ((ret = subsets_validate(state, NULL, solver.counts)) == STATUS_UNFINISHED)
     {
-        subsets_sync_cube(state, cube);
-        subsets_cube_single_count(state, counts, cube);
+        subsets_sync_cube(state, &solver);
+        subsets_cube_single_count(state, &solver);
 
-        if (subsets_solve_apply_arrows(state))
+        if (subsets_solve_apply_arrows(state, &solver))
             continue;
 
-        if (subsets_disjoint(state, cube))
+        if (subsets_disjoint(state, &solver))
             continue;
 
-        if (subsets_bits_from_cube(state, cube))
+        if (subsets_bits_from_cube(state, &solver))
             continue;
 
-        if (subsets_solve_single_position(state, counts, cube))
+        if (subsets_solve_single_position(state, &solver))
             continue;
 
-        if (subsets_solve_apply_arrows_advanced(state, cube))
+        if (subsets_solve_apply_arrows_advanced(state, &solver))
             continue;
 
         break;
     }
 
-    sfree(counts);
-    sfree(cube);
+    sfree(solver.counts);
+    sfree(solver.cube);
+    sfree(solver.changed);
+    sfree(solver.known);
+    sfree(solver.mask);
+    sfree(solver.placed);
+
+    return ret;
+}
+
+static char *encode_game_desc(const game_state *state)
+{
+    int s = state->w * state->h;
+    int i, d;
+    char *ret, *p;
+
+    /* Each cell takes at most two digits, four flags and a separator */
+    ret = snewn(s * 7, char);
+    p = ret;
+    for (i = 0; i < s; i++)
+    {
+        if (state->immutable[i])
+            p += sprintf(p, "%d", state->known[i]);
+        else
+            *p++ = '_';
+
+        for (d = 0; d < 4; d++)
+        {
+            if (state->clues[i] & adjthan[d].f)
+                *p++ = adjthan[d].enc;
+        }
+        *p++ = ',';
+    }
+
+    p[-1] = '\0';
 
+    ret = srealloc(ret, p - ret);
     return ret;
 }
 
@@ -878,7 +1019,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     const int n = state->n, n2 = 1 << n, w = state->w, h = state->h;
     int *spaces = snewn(w * h, int);
     int i, x, y, i2, value, d;
-    char *ret, *p;
+    char *ret;
 
     for (i = 0; i < n2; i++)
     {
@@ -926,29 +1067,11 @@ static char *new_game_desc(const game_params *params, random_state *rs,
         free_game(solved);
     }
 
-    ret = snewn(w * h * 6, char);
-    p = ret;
-    for (i = 0; i < w * h; i++)
-    {
-        if (state->immutable[i])
-            p += sprintf(p, "%d", state->known[i]);
-        else
-            *p++ = '_';
-
-        for (d = 0; d < 4; d++)
-        {
-            if (state->clues[i] & adjthan[d].f)
-                *p++ = adjthan[d].enc;
-        }
-        *p++ = ',';
-    }
-
-    p[-1] = '\0';
+    ret = encode_game_desc(state);
 
     free_game(state);
     sfree(spaces);
 
-    ret = srealloc(ret, p - ret);
     return ret;
 }
 
@@ -1089,6 +1212,8 @@ static char *interpret_move(const game_state *state, game_ui *ui,
 
     pos = celly * state->w + cellx;
     num = numy * cw + numx;
+    if (num >= n)
+        return NULL;
 
     if (state->immutable[pos] & (1 << num))
         return MOVE_NO_EFFECT;
@@ -1213,7 +1338,8 @@ static void game_compute_size(const game_params *params, int tilesize,
     *x = w * (CELL_WIDTH(n) + 1) * tilesize;
     *y = h * (CELL_HEIGHT(n) + 1) * tilesize;
 
-    *y += tilesize * (CELL_HEIGHT(n) + 1);
+    /* The list of sets takes one row per grid row, at 3/4 of the tile size */
+    *y += tilesize * max(CELL_HEIGHT(n) + 1, (3 * h + 3) / 4);
 }
 
 static void game_set_size(drawing *dr, game_drawstate *ds,
@@ -1500,8 +1626,9 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
 
             tx = x * (cw + 1) * tilesize;
             ty = y * 0.75 * tilesize;
-            tx += cw * tilesize * 0.75;
-            ty += (h + 2) * ch * tilesize;
+            /* The entry is two tiles wide, so keep it inside its column */
+            tx += max((int)(cw * tilesize * 0.75), tilesize);
+            ty += h * (ch + 1) * tilesize;
 
             for (cx = 0; cx < n; cx++)
                 buf[cx] = cn & (1 << cx) ? 'A' + cx : '_';
@@ -1622,6 +1749,9 @@ const struct game thegame = {
 #ifdef STANDALONE_SOLVER
 #include <time.h>
 
+#include "genbatch.h"
+#include "solvestream.h"
+
 /* Most of the standalone solver code was copied from unequal.c and singles.c */
 
 const char *quis;
@@ -1630,16 +1760,78 @@ static void usage_exit(const char *msg)
 {
     if (msg)
         fprintf(stderr, "%s: %s\n", quis, msg);
-    fprintf(stderr, "Usage: %s [-v] [--seed SEED] <params> | [game_id [game_id ...]]\n", quis);
+    fprintf(stderr, "Usage: %s [-v] [--seed SEED] [--bench COUNT] [--generate COUNT] [--stream] <params> | [game_id [game_id ...]]\n", quis);
     exit(1);
 }
 
+/*
+ * Generate a number of puzzles, and time how long it takes to generate
+ * them and to solve each of them from its description.
+ */
+static void subsets_bench(const game_params *params, random_state *rs, int count)
+{
+    char *desc, *aux;
+    game_state *input, *solved;
+    clock_t start, gentime = 0, solvetime = 0;
+    int i, rep;
+
+    for (i = 0; i < count; i++)
+    {
+        start = clock();
+        desc = new_game_desc(params, rs, &aux, false);
+        gentime += clock() - start;
+
+        input = new_game(NULL, params, desc);
+        start = clock();
+        for (rep = 0; rep < 100; rep++)
+        {
+            solved = dup_game(input);
+            subsets_solve_game(solved);
+            free_game(solved);
+        }
+        solvetime += clock() - start;
+
+        free_game(input);
+        sfree(desc);
+    }
+
+    printf("Generation: %.2f ms per puzzle\n", gentime * 1000.0 / CLOCKS_PER_SEC / count);
+    printf("Solving: %.3f ms per puzzle\n", solvetime * 10.0 / CLOCKS_PER_SEC / count);
+}
+
+/*
+ * Whether the solver can finish a generated puzzle, for --generate.
+ * Subsets has no difficulty levels, and the generator never retries,
+ * so there is no attempt count either.
+ */
+static const char *subsets_grade(const game_params *params, const char *desc)
+{
+    game_state *state = new_game(NULL, params, desc);
+    int status = subsets_solve_game(state);
+
+    free_game(state);
+    return status == STATUS_COMPLETE ? "Solved" : "Unsolved";
+}
+
+/* Solve one puzzle for --stream. Subsets has no difficulty levels. */
+static void subsets_stream_solve(game_state *state, void *ctx, struct solvestream_result *res)
+{
+    int status = subsets_solve_game(state);
+
+    if (status == STATUS_COMPLETE)
+        res->status = "Solved";
+    else if (status == STATUS_INVALID)
+        res->status = "Invalid";
+}
+
 int main(int argc, char *argv[])
 {
     random_state *rs;
     time_t seed = time(NULL);
 
     game_params *params = NULL;
+    int bench = 0, generate = 0;
+    bool stream = false;
 
     char *id = NULL, *desc = NULL;
     const char *err;
@@ -1656,6 +1848,29 @@ int main(int argc, char *argv[])
             seed = (time_t)atoi(*++argv);
             argc--;
         }
+        else if (!strcmp(p, "--bench"))
+        {
+            if (argc == 0)
+                usage_exit("--bench needs an argument");
+            bench = atoi(*++argv);
+            argc--;
+        }
+        else if (!strcmp(p, "--generate"))
+        {
+            if (argc == 0)
+                usage_exit("--generate needs an argument");
+            generate = atoi(*++argv);
+            argc--;
+        }
+        else if (!strcmp(p, "--params"))
+        {
+            if (argc == 0)
+                usage_exit("--params needs an argument");
+            id = *++argv;
+            argc--;
+        }
+        else if (!strcmp(p, "--stream"))
+            stream = true;
         else if (!strcmp(p, "-v"))
             solver_verbose = true;
         else if (*p == '-')
@@ -1681,7 +1896,29 @@ int main(int argc, char *argv[])
         }
     }
 
-    if (!desc)
+    if (stream)
+    {
+        if (id)
+            usage_exit("--stream reads game IDs from stdin");
+        solvestream_run(stdin, subsets_stream_solve, NULL);
+    }
+    else if (generate)
+    {
+        if (desc)
+            usage_exit("--generate needs parameters, not a game ID");
+        if (!params)
+            params = default_params();
+        genbatch_run(params, (unsigned long)seed, generate, NULL, subsets_grade);
+    }
+    else if (bench)
+    {
+        rs = random_new((void *)&seed, sizeof(time_t));
+        if (!params)
+            params = default_params();
+        printf("Generating %d puzzles with parameters %s\n", bench, encode_params(params, true));
+        subsets_bench(params, rs, bench);
+    }
+    else if (!desc)
     {
         rs = random_new((void *)&seed, sizeof(time_t));
         if (!params)
@@ -0,0 +1,126 @@
+/*
+ * trail.h: Undo trail for solvers which make trial moves.
+ * See LICENCE for licence details
+ *
+ * A solver which colours a cell and solves on from there, to see if it
+ * leads to a contradiction, must put the grid back afterwards. Instead
+ * of copying the whole grid before each trial, it can make its writes
+ * through a trail, which records the address and old value of every
+ * cell it changes. Rolling back to a mark undoes the writes made since,
+ * newest first, so marks can be nested to any depth.
+ *
+ * Writes which do not change a cell are not recorded. A NULL trail is
+ * allowed everywhere, and makes the setters plain writes, so the same
+ * solver code can be used with and without trial moves.
+ */
+
+#ifndef PUZZLES_TRAIL_H
+#define PUZZLES_TRAIL_H
+
+enum { TRAIL_CHAR, TRAIL_INT };
+
+struct trail_entry {
+	void *addr;
+	int old;
+	int type;
+};
+
+struct trail {
+	struct trail_entry *entries;
+	int len, size;
+};
+
+static inline struct trail *trail_new(void)
+{
+	struct trail *trail = snew(struct trail);
+	trail->entries = NULL;
+	trail->len = trail->size = 0;
+	return trail;
+}
+
+static inline void trail_free(struct trail *trail)
+{
+	if(!trail)
+		return;
+	sfree(trail->entries);
+	sfree(trail);
+}
+
+/* Returns a mark to roll back to. */
+static inline int trail_mark(const struct trail *trail)
+{
+	return trail ? trail->len : 0;
+}
+
+static inline void trail_push(struct trail *trail, void *addr, int old, int type)
+{
+	if(trail->len == trail->size)
+	{
+		trail->size = trail->size ? trail->size * 2 : 256;
+		trail->entries = sresize(trail->entries, trail->size, struct trail_entry);
+	}
+	trail->entries[trail->len].addr = addr;
+	trail->entries[trail->len].old = old;
+	trail->entries[trail->len].type = type;
+	trail->len++;
+}
+
+/* Undo every write made since the mark was taken. */
+static inline void trail_rollback(struct trail *trail, int mark)
+{
+	struct trail_entry *e;
+
+	if(!trail)
+		return;
+	while(trail->len > mark)
+	{
+		e = &trail->entries[--trail->len];
+		if(e->type == TRAIL_CHAR)
+			*(char *)e->addr = (char)e->old;
+		else
+			*(int *)e->addr = e->old;
+	}
+}
+
+/* Keep every write made since the mark, and forget how to undo them. */
+static inline void trail_commit(struct trail *trail, int mark)
+{
+	if(trail)
+		trail->len = mark;
+}
+
+static inline void trail_set_char(struct trail *trail, char *p, char v)
+{
+	if(*p == v)
+		return;
+	if(trail)
+		trail_push(trail, p, *p, TRAIL_CHAR);
+	*p = v;
+}
+
+static inline void trail_set_int(struct trail *trail, int *p, int v)
+{
+	if(*p == v)
+		return;
+	if(trail)
+		trail_push(trail, p, *p, TRAIL_INT);
+	*p = v;
+}
+
+static inline void trail_set_uint(struct trail *trail, unsigned int *p, unsigned int v)
+{
+	trail_set_int(trail, (int *)p, (int)v);
+}
+
+/* Helpers for cells which hold a bitmask of candidates. */
+static inline void trail_set_bits(struct trail *trail, int *p, int bits)
+{
+	trail_set_int(trail, p, *p | bits);
+}
+
+static inline void trail_clear_bits(struct trail *trail, int *p, int bits)
+{
+	trail_set_int(trail, p, *p & ~bits);
+}
+
+#endif
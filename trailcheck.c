@@ -0,0 +1,177 @@
+/*
+ * trailcheck.c: Standalone checks for the undo trail in trail.h.
+ * See LICENCE for licence details
+ *
+ * This file is not linked with a game. --check makes random writes
+ * through a trail at nested marks, and checks that every rollback
+ * restores the cells to the copy taken at its mark. --bench compares
+ * undoing a trial by rolling back the trail with copying the whole
+ * grid before and after, for a range of trial sizes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "puzzles.h"
+#include "trail.h"
+
+/* Cells in the grids used by both modes, as for a 30x30 puzzle */
+#define TRAIL_GRID_SIZE (30*30)
+#define TRAIL_BENCH_REPEATS 200000
+#define TRAIL_CHECK_DEPTH 8
+
+const char *quis;
+
+static void usage_exit(const char *msg)
+{
+	if (msg)
+		fprintf(stderr, "%s: %s\n", quis, msg);
+	fprintf(stderr, "Usage: %s [--seed SEED] (--check COUNT | --bench)\n", quis);
+	exit(1);
+}
+
+static void trail_bench(random_state *rs)
+{
+	static const int writes[] = { 1, 4, 8, 16, 64, 256 };
+	char grid[TRAIL_GRID_SIZE], copy[TRAIL_GRID_SIZE];
+	int cells[256];
+	struct trail *trail = trail_new();
+	clock_t start, trailtime, copytime;
+	int i, j, k, mark;
+
+	memset(grid, 0, sizeof(grid));
+	for(j = 0; j < lenof(writes); j++)
+	{
+		for(k = 0; k < writes[j]; k++)
+			cells[k] = random_upto(rs, TRAIL_GRID_SIZE);
+
+		start = clock();
+		for(i = 0; i < TRAIL_BENCH_REPEATS; i++)
+		{
+			mark = trail_mark(trail);
+			for(k = 0; k < writes[j]; k++)
+				trail_set_char(trail, &grid[cells[k]], 1 + (i & 1));
+			trail_rollback(trail, mark);
+		}
+		trailtime = clock() - start;
+
+		start = clock();
+		for(i = 0; i < TRAIL_BENCH_REPEATS; i++)
+		{
+			memcpy(copy, grid, sizeof(grid));
+			for(k = 0; k < writes[j]; k++)
+				grid[cells[k]] = 1 + (i & 1);
+			memcpy(grid, copy, sizeof(grid));
+		}
+		copytime = clock() - start;
+
+		printf("%d writes on 30x30: %.1f ns by rollback, %.1f ns by copying\n",
+			writes[j], trailtime * 1e9 / CLOCKS_PER_SEC / TRAIL_BENCH_REPEATS,
+			copytime * 1e9 / CLOCKS_PER_SEC / TRAIL_BENCH_REPEATS);
+	}
+
+	trail_free(trail);
+}
+
+static bool trail_check(random_state *rs, int count)
+{
+	char grid[TRAIL_GRID_SIZE];
+	char copies[TRAIL_CHECK_DEPTH][TRAIL_GRID_SIZE];
+	int marks[TRAIL_CHECK_DEPTH];
+	int ints[TRAIL_GRID_SIZE], intcopy[TRAIL_GRID_SIZE];
+	struct trail *trail = trail_new();
+	int i, k, depth, cell, writes;
+	bool ok = true;
+
+	for(i = 0; i < TRAIL_GRID_SIZE; i++)
+	{
+		grid[i] = random_upto(rs, 4);
+		ints[i] = random_upto(rs, 512);
+	}
+
+	for(i = 0; i < count && ok; i++)
+	{
+		memcpy(intcopy, ints, sizeof(ints));
+		depth = 0;
+		while(depth < TRAIL_CHECK_DEPTH)
+		{
+			memcpy(copies[depth], grid, sizeof(grid));
+			marks[depth++] = trail_mark(trail);
+			writes = random_upto(rs, 40);
+			for(k = 0; k < writes; k++)
+			{
+				cell = random_upto(rs, TRAIL_GRID_SIZE);
+				trail_set_char(trail, &grid[cell], random_upto(rs, 4));
+				trail_set_bits(trail, &ints[cell], 1 << random_upto(rs, 9));
+				trail_clear_bits(trail, &ints[cell], 1 << random_upto(rs, 9));
+			}
+			if(random_upto(rs, 3) == 0)
+				break;
+		}
+
+		/* Undo the inner levels one at a time, then the rest at once */
+		while(depth > 1 && ok)
+		{
+			depth--;
+			trail_rollback(trail, marks[depth]);
+			ok = !memcmp(grid, copies[depth], sizeof(grid));
+			if(random_upto(rs, 2) == 0)
+				break;
+		}
+		trail_rollback(trail, marks[0]);
+		if(memcmp(grid, copies[0], sizeof(grid)) || memcmp(ints, intcopy, sizeof(ints)) ||
+				trail->len != 0)
+			ok = false;
+	}
+
+	if(ok)
+		printf("%d nested trials undone correctly\n", count);
+	else
+		printf("Rollback failed on trial %d\n", i);
+
+	trail_free(trail);
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long seed = (unsigned long)time(NULL);
+	random_state *rs;
+	int check = 0;
+	bool bench = false, ok = true;
+
+	quis = argv[0];
+
+	while (--argc > 0)
+	{
+		char *p = *++argv;
+		if (!strcmp(p, "--seed") || !strcmp(p, "--check"))
+		{
+			if (argc <= 1)
+				usage_exit("option needs an argument");
+			argc--;
+			if (!strcmp(p, "--seed"))
+				seed = strtoul(*++argv, NULL, 10);
+			else
+				check = atoi(*++argv);
+		}
+		else if (!strcmp(p, "--bench"))
+			bench = true;
+		else
+			usage_exit("unrecognised option");
+	}
+
+	if (check <= 0 && !bench)
+		usage_exit(NULL);
+
+	rs = random_new((void *)&seed, sizeof(seed));
+	if (check > 0)
+		ok = trail_check(rs, check);
+	if (ok && bench)
+		trail_bench(rs);
+	random_free(rs);
+
+	return ok ? 0 : 1;
+}